@@ -0,0 +1,859 @@
+// Native benchmark harness for LibMP - a Feral module (loaded by benchmarks/native.fer) which calls
+// the FERAL_FUNC bodies of the library directly, in a tight loop, so that the numbers are those of
+// the library itself and not of the interpreter around it.
+//
+// The library source is compiled into this module as is (instead of being linked against), so that
+// the static helpers and the functions are all reachable, with the exact same code and flags.
+// Build it like the MP library itself, with the same include paths and libraries, for example
+// (all on one line):
+//   c++ -std=c++20 -O2 -shared -fPIC -I<feral>/include -Iinclude benchmarks/native/MPBench.cpp
+//       -lferalvm -lgmp -lmpfr -lmpc -o <feral lib dir>/mp/libferalMPBench.so
+
+#include "../../src/MP.cpp"
+
+namespace fer
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////// Allocation Counting ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The GMP memory functions in use before the counting ones were installed (the arena's, or GMP's
+// defaults), which the counting ones forward to.
+static void *(*baseAlloc)(size_t);
+static void *(*baseRealloc)(void *, size_t, size_t);
+static void (*baseFree)(void *, size_t);
+
+// Allocations (and growing reallocations) made through GMP, and their bytes - which also covers
+// MPFR and MPC, since they allocate through GMP.
+static std::atomic<size_t> gmpAllocs;
+static std::atomic<size_t> gmpAllocBytes;
+
+static void *countingAlloc(size_t sz)
+{
+    gmpAllocs.fetch_add(1, std::memory_order_relaxed);
+    gmpAllocBytes.fetch_add(sz, std::memory_order_relaxed);
+    return baseAlloc(sz);
+}
+static void *countingRealloc(void *ptr, size_t oldSz, size_t newSz)
+{
+    if(newSz > oldSz) {
+        gmpAllocs.fetch_add(1, std::memory_order_relaxed);
+        gmpAllocBytes.fetch_add(newSz - oldSz, std::memory_order_relaxed);
+    }
+    return baseRealloc(ptr, oldSz, newSz);
+}
+static void countingFree(void *ptr, size_t sz) { baseFree(ptr, sz); }
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// Bench Cases ///////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Operand sizes (in limbs) the cases are run at - MPFlt / MPComplex operands have the precision of
+// that many limbs.
+// Size 0 is the small size class instead: MPInts of BENCH_SMALL_BITS bits, which are kept inline
+// as an int64, and MPFlts / MPComplexes of 53 bits, which the array kernels compute with doubles.
+static constexpr size_t BENCH_SIZES[] = {0, 1, 16, 256, 4096, 65536, 1 << 20};
+static constexpr size_t BENCH_LIMBS_ALL = BENCH_SIZES[std::size(BENCH_SIZES) - 1];
+static constexpr size_t BENCH_SMALL_BITS = 62;
+// Number of elements of the array operands, and of the values of the parallel operations.
+static constexpr size_t BENCH_ARRAY_LEN = 256;
+static constexpr size_t BENCH_PARALLEL_LEN = 64;
+
+// Number of bits of the MPInt operands of size `limbs`.
+static inline size_t benchIntBits(size_t limbs)
+{
+    return limbs == 0 ? BENCH_SMALL_BITS : limbs * GMP_NUMB_BITS;
+}
+// Precision of the MPFlt / MPComplex operands of size `limbs`.
+static inline mpfr_prec_t benchPrec(size_t limbs)
+{
+    return limbs == 0 ? 53 : limbs * GMP_NUMB_BITS;
+}
+
+// Makes the operands of the benchmarked functions, and holds them for the whole run.
+class BenchEnv
+{
+    gmp_randstate_t rand;
+    Vector<Var *> held;
+    Vector<String> tmpPaths;
+
+public:
+    VirtualMachine &vm;
+    ModuleLoc loc;
+    const Map<String, size_t> &assnArgs;
+
+    BenchEnv(VirtualMachine &vm, ModuleLoc loc, const Map<String, size_t> &assnArgs)
+        : vm(vm), loc(loc), assnArgs(assnArgs)
+    {
+        // A fixed seed, so that every run uses the same operands.
+        gmp_randinit_default(rand);
+        gmp_randseed_ui(rand, 42);
+    }
+    ~BenchEnv()
+    {
+        for(Var *var : held) {
+            vm.decVarRef(var);
+            vm.decVarRef(var);
+        }
+        for(auto &path : tmpPaths) remove(path.c_str());
+        gmp_randclear(rand);
+    }
+
+    // Holds two references to `var`, so that the functions never take it for a temporary whose
+    // storage can be reused for their result.
+    Var *hold(Var *var)
+    {
+        vm.incVarRef(var);
+        vm.incVarRef(var);
+        held.push_back(var);
+        return var;
+    }
+
+    // Writes a random value of exactly benchIntBits(`limbs`) bits to `res`.
+    void randLimbs(mpz_ptr res, size_t limbs)
+    {
+        size_t bits = benchIntBits(limbs);
+        mpz_urandomb(res, rand, bits);
+        mpz_setbit(res, bits - 1);
+    }
+
+    // Calls `fn` on `args` (`self` first) and holds its result, or returns nullptr if it failed.
+    Var *call(MPNativeFn fn, Vector<Var *> args)
+    {
+        Var *res = fn(vm, loc, Span<Var *>(args.data(), args.size()), assnArgs);
+        return res ? hold(res) : nullptr;
+    }
+    // Returns the path of a new empty temporary file, which is removed along with the operands.
+    String tmpPath()
+    {
+        char path[] = "/tmp/libmp_bench_XXXXXX";
+        int fd      = mkstemp(path);
+        if(fd >= 0) close(fd);
+        tmpPaths.push_back(path);
+        return path;
+    }
+
+    Var *makeInt(int64_t val) { return hold(vm.makeVar<VarInt>(loc, val)); }
+    Var *makeStr(const String &val) { return hold(vm.makeVar<VarStr>(loc, val)); }
+    Var *makeMPInt(mpz_srcptr val) { return hold(vm.makeVar<VarMPInt>(loc, val)); }
+    Var *makeVec(const Vector<Var *> &elems)
+    {
+        VarVec *res = vm.makeVar<VarVec>(loc, elems.size(), false);
+        for(Var *e : elems) {
+            vm.incVarRef(e);
+            res->getVal().push_back(e);
+        }
+        return hold(res);
+    }
+    Var *randMPInt(size_t limbs)
+    {
+        mpz_t val;
+        mpz_init(val);
+        randLimbs(val, limbs);
+        Var *res = makeMPInt(val);
+        mpz_clear(val);
+        return res;
+    }
+    // A random value in [1, 2), so that it is never 0.
+    Var *randMPFlt(size_t limbs)
+    {
+        VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, benchPrec(limbs));
+        mpfr_urandomb(res->getPtr(), rand);
+        mpfr_add_ui(res->getPtr(), res->getPtr(), 1, MPFR_RNDN);
+        return hold(res);
+    }
+    Var *randMPIntArray(size_t limbs, size_t len)
+    {
+        VarMPIntArray *res = vm.makeVar<VarMPIntArray>(loc);
+        mpz_t val;
+        mpz_init(val);
+        for(size_t i = 0; i < len; ++i) {
+            randLimbs(val, limbs);
+            res->push(val);
+        }
+        mpz_clear(val);
+        return hold(res);
+    }
+    // Values in [1, 2), like randMPFlt().
+    Var *randMPFltArray(size_t limbs, size_t len)
+    {
+        VarMPFltArray *res = vm.makeVar<VarMPFltArray>(loc, benchPrec(limbs));
+        mpfr_t val;
+        mpfr_init2(val, benchPrec(limbs));
+        for(size_t i = 0; i < len; ++i) {
+            mpfr_urandomb(val, rand);
+            mpfr_add_ui(val, val, 1, MPFR_RNDN);
+            res->push(val);
+        }
+        mpfr_clear(val);
+        return hold(res);
+    }
+    Var *randMPComplex(size_t limbs)
+    {
+        VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, benchPrec(limbs));
+        mpfr_urandomb(mpc_realref(res->getPtr()), rand);
+        mpfr_urandomb(mpc_imagref(res->getPtr()), rand);
+        mpc_add_ui(res->getPtr(), res->getPtr(), 1, MPC_RNDNN);
+        return hold(res);
+    }
+};
+
+// Fills `args` with the operands of a case (`self` first) of `limbs` limbs.
+using BenchArgsFn = void (*)(BenchEnv &env, size_t limbs, Vector<Var *> &args);
+
+static void argsInt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPInt(limbs)};
+}
+static void argsIntInt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPInt(limbs), env.randMPInt(limbs)};
+}
+// Divisions - by a divisor of half the size, so that the quotient is not trivial.
+static void argsIntHalf(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPInt(limbs), env.randMPInt((limbs + 1) / 2)};
+}
+// Powers and roots.
+static void argsIntThree(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPInt(limbs), env.makeInt(3)};
+}
+static void argsIntShift(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPInt(limbs), env.makeInt(GMP_NUMB_BITS * 3 + 5)};
+}
+static void argsIntIntInt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPInt(limbs), env.randMPInt(limbs), env.randMPInt(limbs)};
+}
+// An exact division - of a product by one of its factors.
+static void argsIntDivExact(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    mpz_t a, b;
+    mpz_inits(a, b, NULL);
+    env.randLimbs(a, limbs);
+    env.randLimbs(b, (limbs + 1) / 2);
+    mpz_mul(a, a, b);
+    args = {env.makeMPInt(a), env.makeMPInt(b)};
+    mpz_clears(a, b, NULL);
+}
+// A value and an odd modulus which are coprime, so that inverses and Jacobi symbols exist.
+static void argsIntCoprime(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    mpz_t a, m, g;
+    mpz_inits(a, m, g, NULL);
+    env.randLimbs(m, limbs);
+    mpz_setbit(m, 0);
+    do {
+        env.randLimbs(a, limbs);
+        mpz_gcd(g, a, m);
+    } while(mpz_cmp_ui(g, 1) != 0);
+    args = {env.makeMPInt(a), env.makeMPInt(m)};
+    mpz_clears(a, m, g, NULL);
+}
+// Modular powers - with an exponent and an odd modulus of the same size.
+static void argsIntPowm(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    mpz_t m;
+    mpz_init(m);
+    env.randLimbs(m, limbs);
+    mpz_setbit(m, 0);
+    args = {env.randMPInt(limbs), env.randMPInt(limbs), env.makeMPInt(m)};
+    mpz_clear(m);
+}
+static void argsFlt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPFlt(limbs)};
+}
+static void argsFltFlt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPFlt(limbs), env.randMPFlt(limbs)};
+}
+static void argsFltThree(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPFlt(limbs), env.makeInt(3)};
+}
+static void argsFltFltFlt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPFlt(limbs), env.randMPFlt(limbs), env.randMPFlt(limbs)};
+}
+static void argsComplex(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPComplex(limbs)};
+}
+static void argsComplexComplex(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPComplex(limbs), env.randMPComplex(limbs)};
+}
+static void argsComplexThree(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPComplex(limbs), env.makeInt(3)};
+}
+static void argsComplexComplexComplex(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPComplex(limbs), env.randMPComplex(limbs), env.randMPComplex(limbs)};
+}
+// Parsing - the decimal digits of a value of `limbs` limbs.
+static void argsIntDigits(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    mpz_t val;
+    mpz_init(val);
+    env.randLimbs(val, limbs);
+    String digits;
+    intToStr(val, 10, digits);
+    args = {env.vm.getNil(), env.makeStr(digits), env.makeInt(10)};
+    mpz_clear(val);
+}
+// Decoding - the binary encoding of an MPInt of `limbs` limbs.
+static void argsIntBytes(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    Var *val      = env.randMPInt(limbs);
+    Var *fnArgs[] = {val};
+    Var *bytes    = mpToBytes(env.vm, env.loc, Span<Var *>(fnArgs, 1), env.assnArgs);
+    args          = {env.vm.getNil(), env.hold(bytes)};
+}
+// Random numbers - below a bound of `limbs` limbs, with the default state.
+static void argsIntRandom(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.vm.getNil(), env.randMPInt(limbs), env.vm.getNil()};
+}
+static void argsFltRandom(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.vm.getNil(), env.randMPFlt(limbs), env.vm.getNil()};
+}
+// 64 random numbers of `limbs` limbs each, on one thread.
+static void argsRandomBits(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.vm.getNil(), env.makeInt(64), env.makeInt(benchIntBits(limbs)),
+            env.vm.getNil(), env.makeInt(1)};
+}
+// An irange over values of `limbs` limbs, long enough to never run out - and for the small size
+// class, one which stays within int64.
+static void argsIntRange(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    mpz_t end, step;
+    mpz_init(end);
+    mpz_init_set_ui(step, 1);
+    Var *start = env.randMPInt(limbs);
+    mpz_add_ui(end, as<VarMPInt>(start)->getSrcPtr(), (unsigned long)1 << 40);
+    args = {env.vm.getNil(), start, env.makeMPInt(end), env.makeMPInt(step)};
+    mpz_clears(end, step, NULL);
+}
+// A 64 x 48 grid of the whole set, with 64 iterations, at the precision of `limbs` limbs.
+static void argsMandelbrot(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    Var *x0 = env.hold(env.vm.makeVar<VarFlt>(env.loc, -2.0));
+    Var *y0 = env.hold(env.vm.makeVar<VarFlt>(env.loc, -1.0));
+    Var *dx = env.hold(env.vm.makeVar<VarFlt>(env.loc, 2.5 / 64));
+    Var *dy = env.hold(env.vm.makeVar<VarFlt>(env.loc, 2.0 / 48));
+    args    = {env.vm.getNil(), x0,
+               y0,              dx,
+               dy,              env.makeInt(64),
+               env.makeInt(48), env.makeInt(64),
+               env.makeInt(benchPrec(limbs))};
+}
+
+// Element-wise array operations.
+static void argsIntArray(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPIntArray(limbs, BENCH_ARRAY_LEN)};
+}
+static void argsIntArrayIntArray(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPIntArray(limbs, BENCH_ARRAY_LEN), env.randMPIntArray(limbs, BENCH_ARRAY_LEN)};
+}
+static void argsFltArray(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPFltArray(limbs, BENCH_ARRAY_LEN)};
+}
+static void argsFltArrayFltArray(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.randMPFltArray(limbs, BENCH_ARRAY_LEN), env.randMPFltArray(limbs, BENCH_ARRAY_LEN)};
+}
+// The lazy expression a * b + c, which is evaluated (into a new value, or the fourth operand).
+static void argsExprInt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    Var *nil = env.vm.getNil();
+    Var *a   = env.call(mpLazy, {nil, env.randMPInt(limbs)});
+    Var *ab  = env.call(mpExprMul, {a, env.randMPInt(limbs)});
+    args     = {env.call(mpExprAdd, {ab, env.randMPInt(limbs)}), env.randMPInt(limbs)};
+}
+static void argsExprFlt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    Var *nil = env.vm.getNil();
+    Var *a   = env.call(mpLazy, {nil, env.randMPFlt(limbs)});
+    Var *ab  = env.call(mpExprMul, {a, env.randMPFlt(limbs)});
+    args     = {env.call(mpExprAdd, {ab, env.randMPFlt(limbs)}), env.randMPFlt(limbs)};
+}
+// Products of many values - n! for n of `limbs` limbs' worth of bits, and the product of an array.
+static void argsFactorial(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.vm.getNil(), env.makeInt(benchIntBits(limbs))};
+}
+static void argsProductOf(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.vm.getNil(), env.randMPIntArray(limbs, BENCH_ARRAY_LEN)};
+}
+// A context for an odd modulus of `limbs` limbs, with two residues - or a residue and an
+// exponent of `limbs` limbs.
+static void argsModContext(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    mpz_t m;
+    mpz_init(m);
+    env.randLimbs(m, limbs);
+    mpz_setbit(m, 0);
+    Var *ctx = env.call(mpModContextNew, {env.vm.getNil(), env.makeMPInt(m)});
+    Var *a   = env.call(mpModContextToResidue, {ctx, env.randMPInt(limbs)});
+    Var *b   = env.call(mpModContextToResidue, {ctx, env.randMPInt(limbs)});
+    args     = {ctx, a, b};
+    mpz_clear(m);
+}
+// Parallel operations over BENCH_PARALLEL_LEN values of `limbs` limbs.
+static void argsParallel(BenchEnv &env, size_t limbs, Vector<Var *> &args, const char *op)
+{
+    Vector<Var *> values;
+    for(size_t i = 0; i < BENCH_PARALLEL_LEN; ++i) values.push_back(env.randMPInt(limbs));
+    args = {env.vm.getNil(), env.makeVec(values), env.makeStr(op)};
+}
+static void argsParallelMapSqr(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    argsParallel(env, limbs, args, "sqr");
+    args.push_back(env.makeVec({}));
+}
+static void argsParallelReduceMul(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    argsParallel(env, limbs, args, "mul");
+}
+// Streams - a writer which discards what it writes.
+static void argsWriterInt(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    args = {env.call(mpWriterNew, {env.vm.getNil(), env.makeStr("/dev/null")}),
+            env.randMPInt(limbs)};
+}
+// An MPIntStore of BENCH_ARRAY_LEN values of `limbs` limbs, and an index into it.
+static void argsIntStore(BenchEnv &env, size_t limbs, Vector<Var *> &args)
+{
+    Var *nil    = env.vm.getNil();
+    Var *path   = env.makeStr(env.tmpPath());
+    Var *writer = env.call(mpIntStoreWriterNew, {nil, path});
+    env.call(mpIntStoreWriterPush, {writer, env.randMPIntArray(limbs, BENCH_ARRAY_LEN)});
+    env.call(mpIntStoreWriterClose, {writer});
+    args = {env.call(mpIntStoreOpen, {nil, path}), env.makeInt(BENCH_ARRAY_LEN / 2)};
+}
+
+// Runs the async function `fn` and waits for its result - the whole round trip through the
+// worker pool.
+template<MPNativeFn fn>
+static Var *benchAsyncWait(VirtualMachine &vm, ModuleLoc loc, Span<Var *> args,
+                           const Map<String, size_t> &assnArgs)
+{
+    Var *future = fn(vm, loc, args, assnArgs);
+    if(!future) return nullptr;
+    Var *waitArgs[] = {future};
+    Var *res        = mpFutureWait(vm, loc, Span<Var *>(waitArgs, 1), assnArgs);
+    vm.incVarRef(future);
+    vm.decVarRef(future);
+    return res;
+}
+
+// How a case uses the operands made for it.
+enum class BenchMode
+{
+    Call,
+    // The function updates `self` in place - it is restored to its original value (with an O(n)
+    // copy, which is included in the timings) before each call, so that it does not drift.
+    InPlace,
+    // `self` is an irange (made by the function) whose next() is benchmarked.
+    IterNext,
+    // Same as IterNext, with the iterator in place mode.
+    IterNextInPlace,
+};
+
+struct BenchCase
+{
+    const char *name;
+    MPNativeFn fn;
+    BenchArgsFn makeArgs;
+    // Largest size (in limbs) the case is run at - for those which would take too long.
+    size_t maxLimbs;
+    BenchMode mode;
+};
+
+static const BenchCase benchCases[] = {
+    // MPInt
+    {"MPInt _copy_", mpIntCopy, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt +", mpIntAdd, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt -", mpIntSub, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt *", mpIntMul, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt /", mpIntDiv, argsIntHalf, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt %", mpIntMod, argsIntHalf, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt <<", mpIntLShift, argsIntShift, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt >>", mpIntRShift, argsIntShift, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt +=", mpIntAssnAdd, argsIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt -=", mpIntAssnSub, argsIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt *=", mpIntAssnMul, argsIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt /=", mpIntAssnDiv, argsIntHalf, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt %=", mpIntAssnMod, argsIntHalf, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt <<=", mpIntAssnLShift, argsIntShift, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt >>=", mpIntAssnRShift, argsIntShift, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt **", mpIntPow, argsIntThree, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt //", mpIntRoot, argsIntThree, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt ++x", mpIntPreInc, argsInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt x++", mpIntPostInc, argsInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt --x", mpIntPreDec, argsInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt x--", mpIntPostDec, argsInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt u-", mpIntUSub, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt <", mpIntLT, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt >", mpIntGT, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt <=", mpIntLE, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt >=", mpIntGE, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt ==", mpIntEQ, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt !=", mpIntNE, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt &", mpIntBAnd, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt |", mpIntBOr, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt ^", mpIntBXOr, argsIntInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt ~", mpIntBNot, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt &=", mpIntAssnBAnd, argsIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt |=", mpIntAssnBOr, argsIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt ^=", mpIntAssnBXOr, argsIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt popcnt", mpIntPopCnt, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt addmul", mpIntAddMul, argsIntIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt submul", mpIntSubMul, argsIntIntInt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPInt sqr", mpIntSqr, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt powm", mpIntPowm, argsIntPowm, 256, BenchMode::Call},
+    {"MPInt powmSec", mpIntPowmSec, argsIntPowm, 256, BenchMode::Call},
+    {"MPInt invert", mpIntInvert, argsIntCoprime, 65536, BenchMode::Call},
+    {"MPInt gcd", mpIntGcd, argsIntInt, 65536, BenchMode::Call},
+    {"MPInt gcdext", mpIntGcdExt, argsIntInt, 65536, BenchMode::Call},
+    {"MPInt lcm", mpIntLcm, argsIntInt, 65536, BenchMode::Call},
+    {"MPInt nextPrime", mpIntNextPrime, argsInt, 16, BenchMode::Call},
+    {"MPInt sqrtrem", mpIntSqrtRem, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt divexact", mpIntDivExact, argsIntDivExact, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt isProbablePrime", mpIntIsProbablePrime, argsInt, 4096, BenchMode::Call},
+    {"MPInt jacobi", mpIntJacobi, argsIntCoprime, 65536, BenchMode::Call},
+    {"MPInt int", mpIntToInt, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt str", mpIntToStr, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt hex", mpIntToHex, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPInt toBytes", mpToBytes, argsInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"intFromStr", mpIntFromStrNative, argsIntDigits, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"fromBytes", mpFromBytes, argsIntBytes, BENCH_LIMBS_ALL, BenchMode::Call},
+    // MPFlt
+    {"MPFlt _copy_", mpFltCopy, argsFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt +", mpFltAdd, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt -", mpFltSub, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt *", mpFltMul, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt /", mpFltDiv, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt +=", mpFltAssnAdd, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt -=", mpFltAssnSub, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt *=", mpFltAssnMul, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt /=", mpFltAssnDiv, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt ++x", mpFltPreInc, argsFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt x++", mpFltPostInc, argsFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt --x", mpFltPreDec, argsFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt x--", mpFltPostDec, argsFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt u-", mpFltUSub, argsFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt round", mpFltRound, argsFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt **", mpFltPow, argsFltThree, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt ** MPFlt", mpFltPow, argsFltFlt, 4096, BenchMode::Call},
+    {"MPFlt //", mpFltRoot, argsFltThree, 4096, BenchMode::Call},
+    {"MPFlt addmul", mpFltAddMul, argsFltFltFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt submul", mpFltSubMul, argsFltFltFlt, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPFlt fma", mpFltFMA, argsFltFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt fms", mpFltFMS, argsFltFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt sqr", mpFltSqr, argsFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt <", mpFltLT, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt >", mpFltGT, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt <=", mpFltLE, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt >=", mpFltGE, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt ==", mpFltEQ, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt !=", mpFltNE, argsFltFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt flt", mpFltToFlt, argsFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPFlt str", mpFltToStr, argsFlt, 65536, BenchMode::Call},
+    {"MPFlt toBytes", mpToBytes, argsFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    // MPComplex
+    {"MPComplex _copy_", mpComplexCopy, argsComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex +", mpComplexAdd, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex -", mpComplexSub, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex *", mpComplexMul, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex /", mpComplexDiv, argsComplexComplex, 65536, BenchMode::Call},
+    {"MPComplex +=", mpComplexAssnAdd, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex -=", mpComplexAssnSub, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex *=", mpComplexAssnMul, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex /=", mpComplexAssnDiv, argsComplexComplex, 65536, BenchMode::InPlace},
+    {"MPComplex ==", mpComplexEQ, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex !=", mpComplexNE, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex <", mpComplexLT, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex <=", mpComplexLE, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex >", mpComplexGT, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex >=", mpComplexGE, argsComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex ++x", mpComplexPreInc, argsComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex x++", mpComplexPostInc, argsComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex --x", mpComplexPreDec, argsComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex x--", mpComplexPostDec, argsComplex, BENCH_LIMBS_ALL, BenchMode::InPlace},
+    {"MPComplex u-", mpComplexUSub, argsComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex **", mpComplexPow, argsComplexThree, 4096, BenchMode::Call},
+    {"MPComplex fma", mpComplexFMA, argsComplexComplexComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex sqr", mpComplexSqr, argsComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPComplex abs", mpComplexAbs, argsComplex, 65536, BenchMode::Call},
+    {"MPComplex toBytes", mpToBytes, argsComplex, BENCH_LIMBS_ALL, BenchMode::Call},
+    // Iteration, random numbers and the Mandelbrot kernel
+    {"irange next", mpIntRange, argsIntRange, BENCH_LIMBS_ALL, BenchMode::IterNext},
+    {"irange next (in place)", mpIntRange, argsIntRange, BENCH_LIMBS_ALL,
+     BenchMode::IterNextInPlace},
+    {"getRandomInt", mpIntRngGet, argsIntRandom, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"getRandomFlt", mpFltRngGet, argsFltRandom, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"randomBits x64", mpRandomBitsNative, argsRandomBits, 4096, BenchMode::Call},
+    {"mandelbrotGrid 64x48", mpMandelbrotGrid, argsMandelbrot, 16, BenchMode::Call},
+    // MPIntArray / MPFltArray (of BENCH_ARRAY_LEN elements) - the small size class of MPFltArray
+    // uses the double kernels
+    {"MPIntArray +", mpIntArrayAdd, argsIntArrayIntArray, 4096, BenchMode::Call},
+    {"MPIntArray *", mpIntArrayMul, argsIntArrayIntArray, 4096, BenchMode::Call},
+    {"MPIntArray &", mpIntArrayBAnd, argsIntArrayIntArray, 4096, BenchMode::Call},
+    {"MPIntArray sum", mpIntArraySum, argsIntArray, 4096, BenchMode::Call},
+    {"MPIntArray product", mpIntArrayProduct, argsIntArray, 4096, BenchMode::Call},
+    {"MPFltArray +", mpFltArrayAdd, argsFltArrayFltArray, 4096, BenchMode::Call},
+    {"MPFltArray *", mpFltArrayMul, argsFltArrayFltArray, 4096, BenchMode::Call},
+    {"MPFltArray /", mpFltArrayDiv, argsFltArrayFltArray, 4096, BenchMode::Call},
+    {"MPFltArray sum", mpFltArraySum, argsFltArray, 4096, BenchMode::Call},
+    {"MPFltArray dot", mpFltArrayDot, argsFltArrayFltArray, 4096, BenchMode::Call},
+    {"MPFltArray sqrt", mpFltArraySqrt, argsFltArray, 4096, BenchMode::Call},
+    {"MPFltArray exp", mpFltArrayExp, argsFltArray, 16, BenchMode::Call},
+    // Lazy expressions
+    {"MPExpr eval int a*b+c", mpExprEval, argsExprInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPExpr into int a*b+c", mpExprInto, argsExprInt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPExpr eval flt a*b+c", mpExprEval, argsExprFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    {"MPExpr into flt a*b+c", mpExprInto, argsExprFlt, BENCH_LIMBS_ALL, BenchMode::Call},
+    // Products
+    {"factorial", mpFactorial, argsFactorial, 4096, BenchMode::Call},
+    {"productOf", mpProductOf, argsProductOf, 4096, BenchMode::Call},
+    // MPModContext
+    {"MPModContext mul", mpModContextMul, argsModContext, 65536, BenchMode::Call},
+    {"MPModContext sqr", mpModContextSqr, argsModContext, 65536, BenchMode::Call},
+    {"MPModContext pow", mpModContextPow, argsModContext, 16, BenchMode::Call},
+    // Parallel operations (over BENCH_PARALLEL_LEN values) and async ones
+    {"parallelMap sqr", mpParallelMapNative, argsParallelMapSqr, 4096, BenchMode::Call},
+    {"parallelReduce mul", mpParallelReduceNative, argsParallelReduceMul, 4096, BenchMode::Call},
+    {"MPInt mulAsync + wait", benchAsyncWait<mpIntMulAsync>, argsIntInt, BENCH_LIMBS_ALL,
+     BenchMode::Call},
+    {"MPInt strAsync + wait", benchAsyncWait<mpIntToStrAsync>, argsInt, 65536, BenchMode::Call},
+    // Streams and stores
+    {"MPWriter write", mpWriterWrite, argsWriterInt, 65536, BenchMode::Call},
+    {"MPIntStore at", mpIntStoreAt, argsIntStore, 4096, BenchMode::Call},
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// Bench Runner //////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Saved value of the `self` of an in place case, which it is restored to before each call.
+class BenchSaved
+{
+    mpz_t intVal;
+    mpfr_t fltVal;
+    mpc_t complexVal;
+    Var *var;
+
+public:
+    BenchSaved(Var *_var) : var(_var)
+    {
+        if(var->is<VarMPInt>()) {
+            mpz_init_set(intVal, as<VarMPInt>(var)->getSrcPtr());
+        } else if(var->is<VarMPFlt>()) {
+            mpfr_init2(fltVal, as<VarMPFlt>(var)->getPrec());
+            mpfr_set(fltVal, as<VarMPFlt>(var)->getSrcPtr(), MPFR_RNDN);
+        } else {
+            mpc_init2(complexVal, as<VarMPComplex>(var)->getPrec());
+            mpc_set(complexVal, as<VarMPComplex>(var)->getSrcPtr(), MPC_RNDNN);
+        }
+    }
+    ~BenchSaved()
+    {
+        if(var->is<VarMPInt>()) mpz_clear(intVal);
+        else if(var->is<VarMPFlt>()) mpfr_clear(fltVal);
+        else mpc_clear(complexVal);
+    }
+
+    inline void restore()
+    {
+        if(var->is<VarMPInt>()) {
+            mpz_set(as<VarMPInt>(var)->getPtr(), intVal);
+            as<VarMPInt>(var)->normalize();
+        } else if(var->is<VarMPFlt>()) {
+            mpfr_set(as<VarMPFlt>(var)->getPtr(), fltVal, MPFR_RNDN);
+        } else {
+            mpc_set(as<VarMPComplex>(var)->getPtr(), complexVal, MPC_RNDNN);
+        }
+    }
+};
+
+struct BenchResult
+{
+    size_t iters;
+    double nsPerOp;
+    double gmpAllocsPerOp;
+    double gmpBytesPerOp;
+    double newVarsPerOp;
+};
+
+// Calls `fn` on `args`, and releases its result. Returns 1 if the result is a new Var (one which
+// nothing holds a reference to yet), 0 if not, or -1 if the call failed.
+static inline int benchCall(BenchEnv &env, MPNativeFn fn, Vector<Var *> &args)
+{
+    Var *res = fn(env.vm, env.loc, Span<Var *>(args.data(), args.size()), env.assnArgs);
+    if(!res) return -1;
+    int isNew = res->getRef() == 0;
+    env.vm.incVarRef(res);
+    env.vm.decVarRef(res);
+    return isNew;
+}
+
+// Runs `bench` on `args` in batches of doubling size until at least `minTimeNs` have passed (and
+// at least once). Returns false if any call failed.
+static bool benchRun(BenchEnv &env, const BenchCase &bench, Vector<Var *> &args,
+                     uint64_t minTimeNs, BenchResult &res)
+{
+    using Clock = std::chrono::steady_clock;
+
+    MPNativeFn fn = bench.fn;
+    std::unique_ptr<BenchSaved> saved;
+    if(bench.mode == BenchMode::InPlace) saved.reset(new BenchSaved(args[0]));
+    if(bench.mode == BenchMode::IterNext || bench.mode == BenchMode::IterNextInPlace) {
+        Var *iter = fn(env.vm, env.loc, Span<Var *>(args.data(), args.size()), env.assnArgs);
+        if(!iter) return false;
+        if(bench.mode == BenchMode::IterNextInPlace) {
+            as<VarMPIntIterator>(iter)->setInPlace(env.vm, env.loc);
+        }
+        args = {env.hold(iter)};
+        fn   = getMPIntIteratorNext;
+    }
+
+    size_t iters = 0, newVars = 0;
+    uint64_t elapsed = 0;
+    size_t allocsBefore = gmpAllocs.load(), bytesBefore = gmpAllocBytes.load();
+    for(size_t batch = 1; iters == 0 || elapsed < minTimeNs; batch *= 2) {
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < batch; ++i) {
+            if(saved) saved->restore();
+            int isNew = benchCall(env, fn, args);
+            if(isNew < 0) return false;
+            newVars += isNew;
+        }
+        elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+                       .count();
+        iters += batch;
+    }
+    res.iters          = iters;
+    res.nsPerOp        = (double)elapsed / iters;
+    res.gmpAllocsPerOp = (double)(gmpAllocs.load() - allocsBefore) / iters;
+    res.gmpBytesPerOp  = (double)(gmpAllocBytes.load() - bytesBefore) / iters;
+    res.newVarsPerOp   = (double)newVars / iters;
+    return true;
+}
+
+static void jsonStr(String &out, const char *str)
+{
+    out += '"';
+    for(; *str; ++str) {
+        if(*str == '"' || *str == '\\') out += '\\';
+        out += *str;
+    }
+    out += '"';
+}
+
+static void jsonNum(String &out, double val)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", val);
+    out += buf;
+}
+
+FERAL_FUNC(benchRunNative, 3, false,
+           "  fn(filter, minTimeMs, maxLimbs) -> Str\n"
+           "Runs the benchmark cases whose names contain `filter`, at each of the sizes up to "
+           "`maxLimbs` limbs, for at least `minTimeMs` milliseconds each, and returns the results "
+           "as a JSON Str.")
+{
+    EXPECT(VarStr, args[1], "filter");
+    EXPECT(VarInt, args[2], "minimum time");
+    EXPECT(VarInt, args[3], "maximum size");
+    const String &filter = as<VarStr>(args[1])->getVal();
+    uint64_t minTimeNs   = std::max(as<VarInt>(args[2])->getVal(), (int64_t)0) * 1000000;
+    int64_t maxLimbs     = as<VarInt>(args[3])->getVal();
+
+    mp_get_memory_functions(&baseAlloc, &baseRealloc, &baseFree);
+    mp_set_memory_functions(countingAlloc, countingRealloc, countingFree);
+
+    String out = "{\n  \"library\": \"MP\",\n  \"gmp\": ";
+    jsonStr(out, gmp_version);
+    out += ",\n  \"mpfr\": ";
+    jsonStr(out, mpfr_get_version());
+    out += ",\n  \"mpc\": ";
+    jsonStr(out, mpc_get_version());
+    out += ",\n  \"arena\": ";
+    out += arena.isInstalled() ? "true" : "false";
+    out += ",\n  \"mulThreads\": ";
+    out += std::to_string(getMulThreads());
+    out += ",\n  \"minTimeMs\": ";
+    out += std::to_string(minTimeNs / 1000000);
+    out += ",\n  \"results\": [";
+    bool first = true;
+    {
+        BenchEnv env(vm, loc, assnArgs);
+        for(const BenchCase &bench : benchCases) {
+            if(strstr(bench.name, filter.c_str()) == nullptr) continue;
+            for(size_t limbs : BENCH_SIZES) {
+                if((int64_t)limbs > maxLimbs || limbs > bench.maxLimbs) break;
+                Vector<Var *> fnArgs;
+                bench.makeArgs(env, limbs, fnArgs);
+                BenchResult res;
+                // making the operands calls library functions too, which may have failed
+                bool ok = std::find(fnArgs.begin(), fnArgs.end(), nullptr) == fnArgs.end() &&
+                          benchRun(env, bench, fnArgs, minTimeNs, res);
+                out += first ? "\n    {\"name\": " : ",\n    {\"name\": ";
+                first = false;
+                jsonStr(out, bench.name);
+                out += ", \"limbs\": ";
+                out += std::to_string(limbs);
+                if(!ok) {
+                    out += ", \"error\": true}";
+                    break;
+                }
+                out += ", \"iters\": ";
+                out += std::to_string(res.iters);
+                out += ", \"nsPerOp\": ";
+                jsonNum(out, res.nsPerOp);
+                out += ", \"opsPerSec\": ";
+                jsonNum(out, 1e9 / res.nsPerOp);
+                out += ", \"gmpAllocsPerOp\": ";
+                jsonNum(out, res.gmpAllocsPerOp);
+                out += ", \"gmpBytesPerOp\": ";
+                jsonNum(out, res.gmpBytesPerOp);
+                out += ", \"newVarsPerOp\": ";
+                jsonNum(out, res.newVarsPerOp);
+                out += '}';
+            }
+        }
+    }
+    out += "\n  ]\n}";
+
+    mp_set_memory_functions(baseAlloc, baseRealloc, baseFree);
+    return vm.makeVar<VarStr>(loc, out);
+}
+
+INIT_DLL(MPBench)
+{
+    // Sets up the library code compiled into this module the same way as the MP module is.
+    if(!InitMP(vm, loc)) return false;
+    vm.addLocal(loc, "runNative", benchRunNative);
+    return true;
+}
+
+DEINIT_DLL(MPBench)
+{
+    // Tears down the library code compiled into this module the same way as well.
+    DeinitMP(vm);
+}
+
+} // namespace fer
@@ -1,41 +1,342 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <gmp.h>
+#include <memory>
 #include <mpc.h>
 #include <mpfr.h>
+#include <mutex>
+#include <thread>
 #include <VM/VM.hpp>
 
 namespace fer
 {
 
-extern gmp_randstate_t rngstate;
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// MPPool class /////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Recycles initialized mpz_t / mpfr_t / mpc_t values (along with their limbs) so that short lived
+// MP values don't have to go through the allocator each time.
+// Floats and complexes are bucketed by precision since that decides the size of their limbs.
+// Values retrieved from the pool hold garbage and must be set by the caller.
+class MPPool
+{
+    Vector<__mpz_struct> ints;
+    Map<mpfr_prec_t, Vector<__mpfr_struct>> flts;
+    Map<mpfr_prec_t, Vector<__mpc_struct>> complexes;
+    size_t hits;
+    size_t misses;
+
+public:
+    MPPool();
+    ~MPPool();
+
+    void initInt(mpz_ptr val);
+    void clearInt(mpz_ptr val);
+    void initFlt(mpfr_ptr val, mpfr_prec_t prec);
+    void clearFlt(mpfr_ptr val);
+    void initComplex(mpc_ptr val, mpfr_prec_t prec);
+    void clearComplex(mpc_ptr val);
+
+    // Releases all the pooled values.
+    void clear();
+
+    inline size_t getHits() { return hits; }
+    inline size_t getMisses() { return misses; }
+    inline void resetStats() { hits = misses = 0; }
+};
+
+// One pool per thread, and therefore per VM, so that it never needs any locking.
+extern thread_local MPPool pool;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// MPArena class ////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Size class (slab) allocator which can be installed as the GMP memory functions (and therefore
+// is also used by MPFR and MPC) for limb storage.
+// Small blocks (up to MAX_BLOCK bytes) are carved out of large chunks and recycled through per
+// size class free lists, with a per-thread cache in front so that the common case takes no lock.
+// Larger blocks are passed through to malloc.
+// Since GMP always provides the size of the block being freed/reallocated, no block headers are
+// needed.
+class MPArena
+{
+public:
+    static constexpr size_t CLASS_COUNT = 8; // 16, 32, ..., 2048 bytes
+    static constexpr size_t MIN_BLOCK   = 16;
+    static constexpr size_t MAX_BLOCK   = MIN_BLOCK << (CLASS_COUNT - 1);
+    static constexpr size_t CHUNK_SIZE  = 256 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+private:
+    std::mutex mtx;
+    Vector<void *> chunks;
+    char *chunkCurr;
+    char *chunkEnd;
+    FreeBlock *freeLists[CLASS_COUNT];
+    std::atomic<size_t> bytesInUse;
+    std::atomic<size_t> peakBytes;
+    bool installed;
+    // GMP memory functions which were in use before install().
+    void *(*prevAlloc)(size_t);
+    void *(*prevRealloc)(void *, size_t, size_t);
+    void (*prevFree)(void *, size_t);
+
+    void *carve(size_t cls);
+    void addUsage(size_t sz);
+
+public:
+    MPArena();
+    // Chunks are never released since GMP values may outlive the arena (static destruction).
+
+    // Must be called before GMP allocates anything, as blocks allocated by some other allocator
+    // cannot be freed by the arena.
+    void install();
+    // Restores the GMP memory functions replaced by install(). Only done (returning true) when no
+    // block allocated through the arena is in use, as those cannot be freed by another allocator.
+    bool uninstall();
+
+    void *alloc(size_t sz);
+    void *realloc(void *ptr, size_t oldSz, size_t newSz);
+    void free(void *ptr, size_t sz);
+
+    // Moves up to `count` blocks of size class `cls` from the global free list to `into`.
+    size_t take(size_t cls, FreeBlock *&into, size_t count);
+    // Returns the blocks in the `list` (which ends at `last`) to the global free list of `cls`.
+    void give(size_t cls, FreeBlock *list, FreeBlock *last);
+
+    inline bool isInstalled() { return installed; }
+    inline size_t getBytesInUse() { return bytesInUse.load(std::memory_order_relaxed); }
+    inline size_t getPeakBytes() { return peakBytes.load(std::memory_order_relaxed); }
+    inline void resetPeak() { peakBytes.store(getBytesInUse(), std::memory_order_relaxed); }
+
+    static inline size_t getClass(size_t sz)
+    {
+        return sz <= MIN_BLOCK ? 0 : (64 - __builtin_clzll(sz - 1)) - 4;
+    }
+};
+
+extern MPArena arena;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// MPWorkerPool class ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Library owned pool of worker threads for the parallel (and background) operations.
+// Each worker has a queue of its own, which it takes tasks from the back of, and once that runs dry
+// it steals from the front of the other workers' queues, so that uneven tasks still keep all the
+// workers busy.
+// Workers are only started on first use, and each has its own (thread_local) MPPool as scratch.
+class MPWorkerPool
+{
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Queue
+    {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    Vector<std::unique_ptr<Queue>> queues;
+    Vector<std::thread> workers;
+    std::once_flag startFlag;
+    std::mutex sleepMtx;
+    std::condition_variable wake;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> nextQueue;
+    bool stopping;
+
+    void start();
+    void work(size_t idx);
+    // Runs one task, from the back of queue `idx` (of the worker `idx`), or else stolen from the
+    // front of another queue. Returns false if there was none.
+    bool runTask(size_t idx);
+
+public:
+    MPWorkerPool();
+    ~MPWorkerPool();
+
+    // Finishes the queued tasks and joins the workers. The pool cannot be used afterwards.
+    void stop();
+
+    // Queues `task` to run on one of the workers.
+    void submit(Task &&task);
+    // Splits [0, `count`) into (up to) `chunks` ranges and runs `fn(chunk, begin, end)` on each of
+    // them across the workers (with the calling thread taking chunks too, but no other tasks),
+    // returning once all of them are done.
+    void run(size_t count, size_t chunks,
+             const std::function<void(size_t, size_t, size_t)> &fn);
+
+    size_t getThreadCount();
+};
+
+extern MPWorkerPool workerPool;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// MPProfiler class ////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Signature of the native functions registered by the module (the FERAL_FUNCs).
+using MPNativeFn = Var *(*)(VirtualMachine &, ModuleLoc, Span<Var *>, const Map<String, size_t> &);
+
+// Opt-in per operation profiler of the functions registered by the module.
+// Each function is registered through a trampoline which only checks isEnabled() while the
+// profiler is disabled. While enabled, it records the number of calls, the time spent, a histogram
+// of the size of the largest MP operand and the new values returned by each operation, along with
+// the number of new values of each type.
+class MPProfiler
+{
+public:
+    // Bucket 0 counts the calls without MP operands, bucket i the ones whose largest MP operand
+    // has [2^(i-1), 2^i) limbs, and the last bucket also counts everything larger.
+    static constexpr size_t LIMB_BUCKETS = 22;
+
+    // Types of the new values returned by the operations.
+    enum class ValType
+    {
+        Int,
+        Flt,
+        Complex,
+        IntArray,
+        FltArray,
+        Other, // non MP values, like Str / Int / Vec
+
+        Count,
+    };
+
+    struct Op
+    {
+        String name;
+        std::atomic<uint64_t> calls;
+        std::atomic<uint64_t> ns;
+        std::atomic<uint64_t> newVals;
+        std::atomic<uint64_t> limbs[LIMB_BUCKETS];
+
+        Op(String &&name);
+    };
+
+private:
+    Vector<std::unique_ptr<Op>> ops;
+    std::atomic<uint64_t> newVals[(size_t)ValType::Count];
+    std::atomic<bool> enabled;
+
+public:
+    MPProfiler();
+
+    // Adds an operation named `name` - only meant to be called while registering the functions.
+    Op *addOp(String &&name);
+
+    // Calls `fn` and records it in `op`.
+    Var *call(Op &op, MPNativeFn fn, VirtualMachine &vm, ModuleLoc loc, Span<Var *> args,
+              const Map<String, size_t> &assnArgs);
+
+    void reset();
+
+    // Returns the recorded data as a Map of 'ops' (a Map of the name of each called operation to
+    // its data) and 'newVals' (a Map of each type to its number of new values).
+    Var *getStats(VirtualMachine &vm, ModuleLoc loc);
+    // Writes the recorded data to `out` as JSON, in the layout of getStats().
+    void toJson(String &out);
+
+    inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    inline void setEnabled(bool _enabled) { enabled.store(_enabled, std::memory_order_relaxed); }
+};
+
+extern MPProfiler profiler;
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////// MPInt class //////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Values which fit in an int64_t are stored inline in `small` and `val` is not touched until the
+// value overflows (or someone asks for a mutable mpz_ptr), at which point it is promoted.
+// Once initialized, `val` is kept around (even if the value becomes small again) so that its limbs
+// can be reused.
+// A value can also be a read-only view of limbs owned by another Var (like an MPIntStore), in which
+// case `val` is an mpz_roinit_n() view of them, which is copied into limbs of its own the first
+// time a mutable mpz_ptr is asked for.
 class VarMPInt : public Var
 {
     mpz_t val;
+    // read-only view of `small`, used by getSrcPtr() so that GMP functions can read small values
+    mpz_t view;
+    mp_limb_t viewLimb;
+    int64_t small;
+    // View mode only - the Var which owns the limbs viewed by `val`, and the VM which holds a
+    // reference to it for this value.
+    Var *owner;
+    VirtualMachine *vm;
+    bool isSmallVal;
+    bool isValInit;
+    bool isViewVal;
 
     bool onSet(VirtualMachine &vm, Var *from) override;
 
+    void promote();
+    // Replaces the view in `val` by a copy of its value.
+    void detach();
+    // Drops the reference to `owner` (if any), once `val` no longer views its limbs.
+    void releaseOwner();
+
 public:
     VarMPInt(ModuleLoc loc, int64_t _val);
     VarMPInt(ModuleLoc loc, mpz_srcptr _val);
     VarMPInt(ModuleLoc loc, mpfr_srcptr _val);
     VarMPInt(ModuleLoc loc, const char *_val);
+    // Read-only view of the `size` limbs (negated for negative values) at `limbs`, which are owned
+    // by `owner` - it is kept alive for as long as this value exists.
+    VarMPInt(ModuleLoc loc, VirtualMachine &vm, Var *owner, const mp_limb_t *limbs,
+             mp_size_t size);
     ~VarMPInt();
 
-    inline mpz_ptr getPtr() { return val; }
+    // Demotes the value to the inline representation if it fits in an int64_t.
+    void normalize();
+    void setSmall(int64_t _val);
+
+    // Returns the value truncated to a long, like mpz_get_si().
+    inline long getSi() { return isSmallVal ? small : mpz_get_si(val); }
+
+    inline bool isSmall() { return isSmallVal; }
+    inline int64_t getSmall() { return small; }
+
+    inline bool isView() { return isViewVal; }
+
+    // Promotes the value to the mpz_t representation (of its own) if required.
+    inline mpz_ptr getPtr()
+    {
+        if(isSmallVal) promote();
+        else if(isViewVal) detach();
+        return val;
+    }
     // mpz_srcptr is basically 'const mpz_ptr'
-    inline mpz_srcptr getSrcPtr() { return val; }
+    // Does not promote - returns a read-only view for small values.
+    inline mpz_srcptr getSrcPtr()
+    {
+        if(!isSmallVal) return val;
+        viewLimb = small < 0 ? -(uint64_t)small : (uint64_t)small;
+        return mpz_roinit_n(view, &viewLimb, small < 0 ? -1 : small > 0);
+    }
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////// MPFlt class //////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
+// A `prec` of 0 means the default precision (mpfr_get_default_prec()), except when constructing
+// from an mpfr_srcptr, in which case it means the precision of that value.
 class VarMPFlt : public Var
 {
     mpfr_t val;
@@ -43,12 +344,14 @@ class VarMPFlt : public Var
     bool onSet(VirtualMachine &vm, Var *from) override;
 
 public:
-    VarMPFlt(ModuleLoc loc, double _val);
-    VarMPFlt(ModuleLoc loc, mpfr_srcptr _val);
-    VarMPFlt(ModuleLoc loc, mpz_srcptr _val);
-    VarMPFlt(ModuleLoc loc, const char *_val);
+    VarMPFlt(ModuleLoc loc, double _val, mpfr_prec_t prec = 0);
+    VarMPFlt(ModuleLoc loc, mpfr_srcptr _val, mpfr_prec_t prec = 0);
+    VarMPFlt(ModuleLoc loc, mpz_srcptr _val, mpfr_prec_t prec = 0);
+    VarMPFlt(ModuleLoc loc, const char *_val, mpfr_prec_t prec = 0);
     ~VarMPFlt();
 
+    inline mpfr_prec_t getPrec() { return mpfr_get_prec(val); }
+
     inline mpfr_ptr getPtr() { return val; }
     // mpfr_srcptr is basically 'const mpfr_ptr'
     inline mpfr_srcptr getSrcPtr() { return val; }
@@ -58,6 +361,9 @@ public:
 ///////////////////////////////////////// MPComplex class ////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
+// A `prec` of 0 means the default precision (mpc_get_default_prec()), except when constructing
+// from an mpc_srcptr, in which case it means the precision of that value.
+// Both the real and imaginary parts always have the same precision.
 class VarMPComplex : public Var
 {
     mpc_t val;
@@ -65,22 +371,448 @@ class VarMPComplex : public Var
     bool onSet(VirtualMachine &vm, Var *from) override;
 
 public:
-    VarMPComplex(ModuleLoc loc);
-    VarMPComplex(ModuleLoc loc, int64_t real, int64_t imag);
-    VarMPComplex(ModuleLoc loc, double real, double imag);
-    VarMPComplex(ModuleLoc loc, mpfr_srcptr real, mpfr_srcptr imag);
-    VarMPComplex(ModuleLoc loc, mpz_srcptr real, mpz_srcptr imag);
-    VarMPComplex(ModuleLoc loc, mpc_srcptr _val);
-    VarMPComplex(ModuleLoc loc, const char *_val);
+    VarMPComplex(ModuleLoc loc, mpfr_prec_t prec = 0);
+    VarMPComplex(ModuleLoc loc, int64_t real, int64_t imag, mpfr_prec_t prec = 0);
+    VarMPComplex(ModuleLoc loc, double real, double imag, mpfr_prec_t prec = 0);
+    VarMPComplex(ModuleLoc loc, mpfr_srcptr real, mpfr_srcptr imag, mpfr_prec_t prec = 0);
+    VarMPComplex(ModuleLoc loc, mpz_srcptr real, mpz_srcptr imag, mpfr_prec_t prec = 0);
+    VarMPComplex(ModuleLoc loc, mpc_srcptr _val, mpfr_prec_t prec = 0);
+    VarMPComplex(ModuleLoc loc, const char *_val, mpfr_prec_t prec = 0);
     ~VarMPComplex();
 
-    void initBase();
+    void initBase(mpfr_prec_t prec);
+
+    inline mpfr_prec_t getPrec() { return mpfr_get_prec(mpc_realref(val)); }
 
     inline mpc_ptr getPtr() { return val; }
     // mpc_srcptr is basically 'const mpc_ptr'
     inline mpc_srcptr getSrcPtr() { return val; }
 };
 
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// MPIntArray class ////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Array of big ints whose limbs are all stored back to back in a single buffer, so that bulk
+// operations run over the whole array in one native call, without a Var (or an mpz_t) per element.
+// Each element is an offset into `limbs` along with a GMP style signed size - the sign of the size
+// is the sign of the value, and a size of 0 means the value is 0.
+class VarMPIntArray : public Var
+{
+public:
+    struct Elem
+    {
+        size_t offset;
+        int size;
+    };
+
+private:
+    Vector<mp_limb_t> limbs;
+    Vector<Elem> elems;
+
+    bool onSet(VirtualMachine &vm, Var *from) override;
+
+    // Appends `count` limbs from `src` (which may point into `limbs` itself) to the buffer and
+    // returns their offset.
+    size_t append(const mp_limb_t *src, size_t count);
+
+public:
+    VarMPIntArray(ModuleLoc loc);
+    VarMPIntArray(ModuleLoc loc, VarMPIntArray *from);
+
+    void reserve(size_t count, size_t limbCount);
+    void push(mpz_srcptr val);
+    // Overwrites the element in place if it fits, otherwise moves it to the end of the buffer.
+    void set(size_t idx, mpz_srcptr val);
+    // Rebuilds the buffer with the elements in the order given by `order`, dropping any unused
+    // limbs left behind by set().
+    void reorder(const Vector<size_t> &order);
+    void clear();
+
+    // Appends `count` zeros, each with room for `limbCount` limbs, which can then be overwritten
+    // with setInPlace() - by several threads at once, as long as they use different elements.
+    void addSlots(size_t count, size_t limbCount);
+    // Overwrites the element at `idx` with `val`, which must fit in the room of the element.
+    inline void setInPlace(size_t idx, mpz_srcptr val)
+    {
+        Elem &e      = elems[idx];
+        size_t count = mpz_size(val);
+        if(count > 0) {
+            memcpy(limbs.data() + e.offset, mpz_limbs_read(val), count * sizeof(mp_limb_t));
+        }
+        e.size = mpz_sgn(val) < 0 ? -(int)count : (int)count;
+    }
+
+    // Returns a read-only view of the element at `idx` in `view`.
+    // The view is invalidated by any modification of the array.
+    inline mpz_srcptr get(size_t idx, mpz_ptr view)
+    {
+        const Elem &e = elems[idx];
+        return mpz_roinit_n(view, limbs.data() + e.offset, e.size);
+    }
+
+    inline size_t size() { return elems.size(); }
+    inline size_t getLimbCount() { return limbs.size(); }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// MPFltArray class ////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Array of big floats which all share a single precision, stored in a single buffer.
+// At exactly 53 bits, the values are stored as plain doubles (as long as they fit in one), since
+// IEEE-754 binary64 arithmetic then gives the same results as MPFR does with MPFR_RNDN, which lets
+// the element-wise operations run as simple loops that the compiler can vectorize.
+// Otherwise, the significands are stored back to back in `limbs` (using MPFR's custom interface),
+// with `vals` holding the mpfr_t for each of them.
+class VarMPFltArray : public Var
+{
+    Vector<double> dbls;
+    Vector<mp_limb_t> limbs;
+    Vector<__mpfr_struct> vals;
+    mpfr_prec_t prec;
+    bool isDbl;
+
+    bool onSet(VirtualMachine &vm, Var *from) override;
+
+    // Grows `limbs` by `count` values, and moves `vals` along if the buffer is reallocated.
+    void grow(size_t count);
+
+public:
+    VarMPFltArray(ModuleLoc loc, mpfr_prec_t prec);
+    VarMPFltArray(ModuleLoc loc, VarMPFltArray *from);
+
+    // Switches the array from doubles to the MPFR storage.
+    void toMPFR();
+    // Writes all the values as MPFR values to `outLimbs` and `outVals`, using the same layout as
+    // the MPFR storage.
+    void copyTo(Vector<mp_limb_t> &outLimbs, Vector<__mpfr_struct> &outVals);
+
+    // Appends `count` zeros.
+    void addZeros(size_t count);
+    void push(mpfr_srcptr val);
+    void set(size_t idx, mpfr_srcptr val);
+
+    // Returns the value at `idx` - either from the array itself, or, when the array stores
+    // doubles, from `scratch` (which must have a precision of at least 53 bits) after writing it
+    // there.
+    mpfr_srcptr get(size_t idx, mpfr_ptr scratch);
+
+    inline size_t size() { return isDbl ? dbls.size() : vals.size(); }
+    inline mpfr_prec_t getPrec() { return prec; }
+    inline bool isDouble() { return isDbl; }
+    // Only valid when the array stores doubles.
+    inline double *getDoubles() { return dbls.data(); }
+    // Only valid when the array uses the MPFR storage.
+    inline mpfr_ptr getPtr(size_t idx) { return &vals[idx]; }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// RandState class /////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A random number generator state which can be passed around explicitly.
+// A RandState must not be used by multiple threads at once - each thread should use its own,
+// for example by using split() on a common one.
+class VarRandState : public Var
+{
+public:
+    enum class Algo
+    {
+        MT, // Mersenne Twister
+        LC, // Linear congruential, with a 128 bit modulus
+    };
+
+private:
+    gmp_randstate_t state;
+    Algo algo;
+
+    bool onSet(VirtualMachine &vm, Var *from) override;
+
+public:
+    VarRandState(ModuleLoc loc, Algo algo);
+    VarRandState(ModuleLoc loc, VarRandState *from);
+    ~VarRandState();
+
+    inline Algo getAlgo() { return algo; }
+    inline __gmp_randstate_struct *getPtr() { return state; }
+};
+
+// Initializes `state` with `algo`.
+void randInit(gmp_randstate_t state, VarRandState::Algo algo);
+// Seeds the (initialized) `child` with random bits from `parent`, so that it produces a stream of
+// numbers independent from that of `parent` (and of any other child of it).
+void randSplit(__gmp_randstate_struct *child, __gmp_randstate_struct *parent);
+
+// The (Mersenne Twister) random state of the current thread, used when no RandState is given.
+__gmp_randstate_struct *getDefaultRandState();
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// MPExpr class //////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A node of an MP arithmetic expression which is evaluated lazily (see mp.lazy()) - only when its
+// value is needed, at which point the whole expression is evaluated at once, using fused GMP /
+// MPFR / MPC operations where possible and a few reused scratch values.
+// The operands are either other expressions (so an expression forms a DAG) or MP values of the
+// expression's type, which are referenced by the node and read at evaluation time.
+class VarMPExpr : public Var
+{
+public:
+    enum class Kind
+    {
+        Int,
+        Flt,
+        Complex,
+    };
+    enum class Op
+    {
+        Val, // `lhs` itself
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Neg,
+    };
+
+private:
+    // The VM holding the references to `lhs` and `rhs`.
+    VirtualMachine *vm;
+    Var *lhs;
+    Var *rhs;
+    // Longest path from this node to a value.
+    size_t depth;
+    Kind kind;
+    Op op;
+
+public:
+    VarMPExpr(ModuleLoc loc, VirtualMachine &vm, Kind kind, Op op, Var *lhs, Var *rhs);
+    ~VarMPExpr();
+
+    inline Kind getKind() { return kind; }
+    inline Op getOp() { return op; }
+    inline Var *getLHS() { return lhs; }
+    inline Var *getRHS() { return rhs; }
+    inline size_t getDepth() { return depth; }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////// MPWriter / MPReader class //////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Writes a stream of MP values to a file, in the binary format of toBytes(), with each value
+// prefixed by its size.
+class VarMPWriter : public Var
+{
+    FILE *file;
+    // Reused for the encoding of each value.
+    String buf;
+
+public:
+    VarMPWriter(ModuleLoc loc, FILE *file);
+    ~VarMPWriter();
+
+    // Returns false if the data could not be written.
+    bool close();
+
+    inline FILE *getFile() { return file; }
+    inline String &getBuf() { return buf; }
+};
+
+// Reads the stream of MP values written by an MPWriter from a file.
+class VarMPReader : public Var
+{
+    FILE *file;
+    // Reused for the encoding of each value.
+    String buf;
+
+public:
+    VarMPReader(ModuleLoc loc, FILE *file);
+    ~VarMPReader();
+
+    void close();
+
+    inline FILE *getFile() { return file; }
+    inline String &getBuf() { return buf; }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// MPIntStore classes ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Layout of an MPIntStore file: the header, followed by the limbs of all the values back to back,
+// followed by the index - an IntStoreElem per value.
+// The limbs (and so the whole file) are in the native format of the host which wrote the file, so
+// that they can be used in place - a file is rejected by hosts with another limb size or byte
+// order.
+struct IntStoreHeader
+{
+    char magic[8];
+    uint32_t limbBytes;
+    uint32_t byteOrder;
+    uint64_t count;
+    uint64_t limbCount;
+};
+struct IntStoreElem
+{
+    // In limbs, from the start of the limbs.
+    uint64_t offset;
+    // Number of limbs, negated for negative values.
+    int64_t size;
+};
+
+// Read-only store of big ints in a file, which is memory-mapped (shared, so that all the processes
+// using the file share its pages) and read in place - its elements are MPInt views of the mapped
+// limbs, so that accessing them costs no more than the page faults.
+class VarMPIntStore : public Var
+{
+    void *data;
+    size_t dataSize;
+    const mp_limb_t *limbs;
+    const IntStoreElem *index;
+    size_t count;
+    size_t limbCount;
+
+public:
+    // `data` must be a valid (see openIntStore()) mapping of `dataSize` bytes, which is unmapped
+    // when the store is destroyed.
+    VarMPIntStore(ModuleLoc loc, void *data, size_t dataSize);
+    ~VarMPIntStore();
+
+    // Returns false if the index entry of the element at `idx` is invalid.
+    bool get(size_t idx, const mp_limb_t *&elemLimbs, mp_size_t &elemSize);
+
+    inline size_t size() { return count; }
+};
+
+// Writes an MPIntStore file. The file is only valid once the writer is closed.
+class VarMPIntStoreWriter : public Var
+{
+    FILE *file;
+    Vector<IntStoreElem> index;
+    uint64_t limbCount;
+
+public:
+    VarMPIntStoreWriter(ModuleLoc loc, FILE *file);
+    ~VarMPIntStoreWriter();
+
+    // Returns false if the value could not be written.
+    bool push(mpz_srcptr val);
+    // Writes the index and the header, and closes the file. Returns false if any of it fails.
+    bool close();
+
+    inline bool isOpen() { return file != nullptr; }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// MPModContext class ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Arithmetic modulo a fixed (positive) modulus `mod`, on residues of values modulo it - each of
+// which is in [0, `mod`).
+// For odd moduli of up to MOD_MONTGOMERY_LIMBS limbs, residues are in Montgomery form (x * R mod
+// `mod`, with R = 2 ^ (GMP_NUMB_BITS * limbs of `mod`)), so that products are reduced with a
+// Montgomery reduction (REDC) instead of a division. Otherwise, residues are the reduced values
+// themselves.
+class VarMPModContext : public Var
+{
+    mpz_t mod;
+    // Montgomery form only - R ^ 2 mod `mod`, for converting values to it.
+    mpz_t rSqr;
+    // Montgomery form only - -(`mod` ^ -1) mod 2 ^ GMP_NUMB_BITS.
+    mp_limb_t modInv;
+    size_t limbCount;
+    bool isMontgomeryVal;
+
+    // Copies `val` (which must be a residue) to `limbs`, padded with zeros to `limbCount` limbs.
+    void getLimbs(mp_limb_t *limbs, mpz_srcptr val);
+    // Writes `t` * R ^ -1 mod `mod` to `r`, where `t` is the 2 * `limbCount` limbs (a value
+    // below `mod` * R) at `t`, which are overwritten.
+    void redc(mpz_ptr r, mp_limb_t *t);
+
+public:
+    VarMPModContext(ModuleLoc loc, mpz_srcptr _mod);
+    ~VarMPModContext();
+
+    // Writes the residue of any `val` to `r`.
+    void toResidue(mpz_ptr r, mpz_srcptr val);
+    // Writes the value (in [0, `mod`)) of the residue `a` to `r`.
+    void fromResidue(mpz_ptr r, mpz_srcptr a);
+
+    // These operate on the residues `a` and `b`, and write the residue of the result to `r` -
+    // which can also be `a` or `b`.
+    void add(mpz_ptr r, mpz_srcptr a, mpz_srcptr b);
+    void sub(mpz_ptr r, mpz_srcptr a, mpz_srcptr b);
+    void mul(mpz_ptr r, mpz_srcptr a, mpz_srcptr b);
+    // `exp` can be negative, in which case this returns false (leaving `r` untouched) if `a` is not
+    // invertible.
+    bool pow(mpz_ptr r, mpz_srcptr a, mpz_srcptr exp);
+
+    inline bool isResidue(mpz_srcptr a) { return mpz_sgn(a) >= 0 && mpz_cmp(a, mod) < 0; }
+
+    inline mpz_srcptr getMod() { return mod; }
+    inline size_t getLimbCount() { return limbCount; }
+    inline bool isMontgomery() { return isMontgomeryVal; }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// MPFuture class /////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Result of an operation which runs in the background on the worker pool (see powAsync() and co.).
+// The operation works on copies of its operands, so that they can be used (and modified) while it
+// runs, and its result is only turned into a Var on the VM thread, by wait().
+class VarMPFuture : public Var
+{
+public:
+    enum class Status
+    {
+        Queued,
+        Running,
+        Done,
+        Cancelled,
+    };
+
+    // The operation and its result, which is shared with the queued task so that it stays alive
+    // until the task is done, even if the future is destroyed before that.
+    struct Op
+    {
+        std::mutex mtx;
+        std::condition_variable doneCond;
+        Status status = Status::Queued;
+
+        virtual ~Op() = default;
+        // Computes the result - runs on a worker.
+        virtual void run() = 0;
+        // Returns a new Var with the result - only called on the VM thread, once it is done.
+        virtual Var *getResult(VirtualMachine &vm, ModuleLoc loc) = 0;
+    };
+
+private:
+    std::shared_ptr<Op> op;
+
+public:
+    // Queues `_op` on the worker pool.
+    VarMPFuture(ModuleLoc loc, std::shared_ptr<Op> _op);
+    // Cancels the operation if it is still queued, since nothing can get its result anymore.
+    ~VarMPFuture();
+
+    // Returns true if wait() would not block - the operation is done or cancelled.
+    bool isReady();
+    // Cancels the operation, returning false if it is already done.
+    // A running operation cannot be interrupted (GMP / MPFR have no way of doing that), so it
+    // keeps its worker busy until it is done, but its result is dropped.
+    bool cancel();
+    // Waits for the operation to be done or cancelled, for at most `timeoutMs` milliseconds if it
+    // is not negative, and returns its status.
+    Status wait(int64_t timeoutMs);
+
+    inline Op *getOp() { return op.get(); }
+};
+
 mpc_rnd_t mpc_get_default_rounding_mode();
+// Like the MPFR default precision, this is per thread.
+mpfr_prec_t mpc_get_default_prec();
+void mpc_set_default_prec(mpfr_prec_t prec);
 
 } // namespace fer
\ No newline at end of file
@@ -1,1485 +1,7881 @@
 #include "MP.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cfloat>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
 namespace fer
 {
 
-gmp_randstate_t rngstate;
+thread_local MPPool pool;
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////// VarMPInt /////////////////////////////////////////////
+///////////////////////////////////////////// MPPool /////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
-VarMPInt::VarMPInt(ModuleLoc loc, int64_t _val) : Var(loc, 0) { mpz_init_set_si(val, _val); }
-VarMPInt::VarMPInt(ModuleLoc loc, mpz_srcptr _val) : Var(loc, 0) { mpz_init_set(val, _val); }
-VarMPInt::VarMPInt(ModuleLoc loc, mpfr_srcptr _val) : Var(loc, 0)
-{
-    mpz_init(val);
-    mpfr_get_z(val, _val, mpfr_get_default_rounding_mode());
-}
-VarMPInt::VarMPInt(ModuleLoc loc, const char *_val) : Var(loc, 0)
+// Max number of values kept per pool bucket.
+static constexpr size_t POOL_BUCKET_MAX = 256;
+// Ints with more limbs than this are freed instead of being pooled, so that a few huge numbers
+// don't keep their memory pinned for the lifetime of the pool.
+static constexpr int POOL_INT_MAX_LIMBS = 64;
+
+MPPool::MPPool() : hits(0), misses(0) {}
+MPPool::~MPPool() { clear(); }
+
+void MPPool::initInt(mpz_ptr val)
 {
-    mpz_init_set_str(val, _val, 0);
+    if(ints.empty()) {
+        ++misses;
+        mpz_init(val);
+        return;
+    }
+    ++hits;
+    *val = ints.back();
+    ints.pop_back();
 }
-VarMPInt::~VarMPInt() { mpz_clear(val); }
-
-bool VarMPInt::onSet(VirtualMachine &vm, Var *from)
+void MPPool::clearInt(mpz_ptr val)
 {
-    mpz_set(val, as<VarMPInt>(from)->getPtr());
-    return true;
+    if(ints.size() >= POOL_BUCKET_MAX || val->_mp_alloc > POOL_INT_MAX_LIMBS) {
+        mpz_clear(val);
+        return;
+    }
+    ints.push_back(*val);
 }
-
-//////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////// VarMPFlt /////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////
-
-VarMPFlt::VarMPFlt(ModuleLoc loc, double _val) : Var(loc, 0)
+void MPPool::initFlt(mpfr_ptr val, mpfr_prec_t prec)
 {
-    mpfr_init_set_ld(val, _val, mpfr_get_default_rounding_mode());
+    auto loc = flts.find(prec);
+    if(loc == flts.end() || loc->second.empty()) {
+        ++misses;
+        mpfr_init2(val, prec);
+        return;
+    }
+    ++hits;
+    *val = loc->second.back();
+    loc->second.pop_back();
 }
-VarMPFlt::VarMPFlt(ModuleLoc loc, mpfr_srcptr _val) : Var(loc, 0)
+void MPPool::clearFlt(mpfr_ptr val)
 {
-    mpfr_init_set(val, _val, mpfr_get_default_rounding_mode());
+    Vector<__mpfr_struct> &bucket = flts[mpfr_get_prec(val)];
+    if(bucket.size() >= POOL_BUCKET_MAX) {
+        mpfr_clear(val);
+        return;
+    }
+    bucket.push_back(*val);
 }
-VarMPFlt::VarMPFlt(ModuleLoc loc, mpz_srcptr _val) : Var(loc, 0)
+void MPPool::initComplex(mpc_ptr val, mpfr_prec_t prec)
 {
-    mpfr_init_set_z(val, _val, mpfr_get_default_rounding_mode());
+    auto loc = complexes.find(prec);
+    if(loc == complexes.end() || loc->second.empty()) {
+        ++misses;
+        mpc_init2(val, prec);
+        return;
+    }
+    ++hits;
+    *val = loc->second.back();
+    loc->second.pop_back();
 }
-VarMPFlt::VarMPFlt(ModuleLoc loc, const char *_val) : Var(loc, 0)
+void MPPool::clearComplex(mpc_ptr val)
 {
-    mpfr_init_set_str(val, _val, 0, mpfr_get_default_rounding_mode());
+    // Complexes are only ever initialized by the pool with the same precision for both parts.
+    Vector<__mpc_struct> &bucket = complexes[mpc_get_prec(val)];
+    if(bucket.size() >= POOL_BUCKET_MAX) {
+        mpc_clear(val);
+        return;
+    }
+    bucket.push_back(*val);
 }
-VarMPFlt::~VarMPFlt() { mpfr_clear(val); }
 
-bool VarMPFlt::onSet(VirtualMachine &vm, Var *from)
+void MPPool::clear()
 {
-    mpfr_set(val, as<VarMPFlt>(from)->getPtr(), mpfr_get_default_rounding_mode());
-    return true;
+    for(auto &i : ints) mpz_clear(&i);
+    ints.clear();
+    for(auto &bucket : flts) {
+        for(auto &f : bucket.second) mpfr_clear(&f);
+    }
+    flts.clear();
+    for(auto &bucket : complexes) {
+        for(auto &c : bucket.second) mpc_clear(&c);
+    }
+    complexes.clear();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////// VarMPComplex ///////////////////////////////////////////
+///////////////////////////////////////////// MPArena ////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
-VarMPComplex::VarMPComplex(ModuleLoc loc) : Var(loc, 0) { initBase(); }
-VarMPComplex::VarMPComplex(ModuleLoc loc, int64_t real, int64_t imag) : Var(loc, 0)
+MPArena arena;
+
+// Number of blocks moved from the arena to a thread cache at a time.
+static constexpr size_t ARENA_CACHE_REFILL = 32;
+// Max number of free blocks (per size class) that a thread cache holds on to.
+static constexpr size_t ARENA_CACHE_MAX = 128;
+
+// Per thread cache in front of the arena's global free lists.
+// It is trivially destructible on purpose, because GMP values may be freed during thread/static
+// destruction after the cache would have been destroyed. Instead, MPArenaCacheFlusher returns the
+// blocks to the arena when the thread exits and marks the cache as dead, after which the blocks
+// go directly to the arena.
+struct MPArenaCache
 {
-    initBase();
-    mpc_set_si_si(val, real, imag, mpc_get_default_rounding_mode());
-}
-VarMPComplex::VarMPComplex(ModuleLoc loc, double real, double imag) : Var(loc, 0)
+    MPArena::FreeBlock *lists[MPArena::CLASS_COUNT];
+    size_t counts[MPArena::CLASS_COUNT];
+    bool dead;
+};
+struct MPArenaCacheFlusher
 {
-    initBase();
-    mpc_set_ld_ld(val, real, imag, mpc_get_default_rounding_mode());
-}
-VarMPComplex::VarMPComplex(ModuleLoc loc, mpfr_srcptr real, mpfr_srcptr imag) : Var(loc, 0)
+    bool active = false;
+    ~MPArenaCacheFlusher();
+};
+
+static thread_local MPArenaCache arenaCache;
+static thread_local MPArenaCacheFlusher arenaCacheFlusher;
+
+MPArenaCacheFlusher::~MPArenaCacheFlusher()
 {
-    initBase();
-    mpc_set_fr_fr(val, real, imag, mpc_get_default_rounding_mode());
+    for(size_t cls = 0; cls < MPArena::CLASS_COUNT; ++cls) {
+        MPArena::FreeBlock *list = arenaCache.lists[cls];
+        if(!list) continue;
+        MPArena::FreeBlock *last = list;
+        while(last->next) last = last->next;
+        arena.give(cls, list, last);
+        arenaCache.lists[cls]  = nullptr;
+        arenaCache.counts[cls] = 0;
+    }
+    arenaCache.dead = true;
 }
-VarMPComplex::VarMPComplex(ModuleLoc loc, mpz_srcptr real, mpz_srcptr imag) : Var(loc, 0)
+
+static void *arenaAlloc(size_t sz) { return arena.alloc(sz); }
+static void *arenaRealloc(void *ptr, size_t oldSz, size_t newSz)
 {
-    initBase();
-    mpc_set_z_z(val, real, imag, mpc_get_default_rounding_mode());
+    return arena.realloc(ptr, oldSz, newSz);
 }
-VarMPComplex::VarMPComplex(ModuleLoc loc, mpc_srcptr _val) : Var(loc, 0)
+static void arenaFree(void *ptr, size_t sz) { arena.free(ptr, sz); }
+
+static void *arenaMalloc(void *ptr, size_t sz)
 {
-    initBase();
-    mpc_set(val, _val, mpc_get_default_rounding_mode());
+    ptr = ptr ? ::realloc(ptr, sz) : ::malloc(sz);
+    if(!ptr) {
+        fprintf(stderr, "MP arena: cannot allocate memory (size=%zu)\n", sz);
+        abort();
+    }
+    return ptr;
 }
-VarMPComplex::VarMPComplex(ModuleLoc loc, const char *_val) : Var(loc, 0)
+
+MPArena::MPArena()
+    : chunkCurr(nullptr), chunkEnd(nullptr), freeLists{}, bytesInUse(0), peakBytes(0),
+      installed(false), prevAlloc(nullptr), prevRealloc(nullptr), prevFree(nullptr)
+{}
+
+void MPArena::install()
 {
-    initBase();
-    mpc_set_str(val, _val, 0, mpc_get_default_rounding_mode());
+    mp_get_memory_functions(&prevAlloc, &prevRealloc, &prevFree);
+    mp_set_memory_functions(arenaAlloc, arenaRealloc, arenaFree);
+    installed = true;
 }
-VarMPComplex::~VarMPComplex() { mpc_clear(val); }
 
-void VarMPComplex::initBase() { mpc_init2(val, 256); }
-
-bool VarMPComplex::onSet(VirtualMachine &vm, Var *from)
+bool MPArena::uninstall()
 {
-    mpc_set(val, as<VarMPComplex>(from)->getPtr(), mpc_get_default_rounding_mode());
+    if(!installed || getBytesInUse() > 0) return false;
+    mp_set_memory_functions(prevAlloc, prevRealloc, prevFree);
+    installed = false;
     return true;
 }
 
-mpc_rnd_t mpc_get_default_rounding_mode() { return MPC_RNDNN; }
-
-//////////////////////////////////////////////////////////////////////////////////////////////////
-/////////////////////////////////////////// Functions ////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////
+void *MPArena::carve(size_t cls)
+{
+    size_t blockSz = MIN_BLOCK << cls;
+    if(chunkCurr + blockSz > chunkEnd) {
+        chunkCurr = (char *)arenaMalloc(nullptr, CHUNK_SIZE);
+        chunkEnd  = chunkCurr + CHUNK_SIZE;
+        chunks.push_back(chunkCurr);
+    }
+    void *res = chunkCurr;
+    chunkCurr += blockSz;
+    return res;
+}
 
-FERAL_FUNC(rngSeed, 1, false,
-           "  fn(seed) -> Nil\n"
-           "Provides a `seed` number to the random number generator.")
+size_t MPArena::take(size_t cls, FreeBlock *&into, size_t count)
 {
-    EXPECT(VarMPInt, args[1], "seed value");
-    gmp_randseed(rngstate, as<VarMPInt>(args[1])->getPtr());
-    return vm.getNil();
+    std::lock_guard<std::mutex> lock(mtx);
+    for(size_t i = 0; i < count; ++i) {
+        FreeBlock *block = freeLists[cls];
+        if(block) freeLists[cls] = block->next;
+        else block = (FreeBlock *)carve(cls);
+        block->next = into;
+        into        = block;
+    }
+    return count;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////// Int Functions //////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////
+void MPArena::give(size_t cls, FreeBlock *list, FreeBlock *last)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    last->next     = freeLists[cls];
+    freeLists[cls] = list;
+}
 
-FERAL_FUNC(mpIntNewNative, 1, false,
-           "  fn(value) -> MPInt\n"
-           "Creates and returns a new MPInt with `value`.\n"
-           "Here `value` can be any of Int / Str / MPInt / MPFlt")
+void MPArena::addUsage(size_t sz)
 {
-    EXPECT4(VarInt, VarStr, VarMPInt, VarMPFlt, args[1], "initial value");
-    if(args[1]->is<VarInt>()) { return vm.makeVar<VarMPInt>(loc, as<VarInt>(args[1])->getVal()); }
-    if(args[1]->is<VarStr>()) {
-        return vm.makeVar<VarMPInt>(loc, as<VarStr>(args[1])->getVal().c_str());
-    }
-    if(args[1]->is<VarMPInt>()) {
-        return vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[1])->getPtr());
-    }
-    return vm.makeVar<VarMPInt>(loc, as<VarMPFlt>(args[1])->getSrcPtr());
+    size_t inUse = bytesInUse.fetch_add(sz, std::memory_order_relaxed) + sz;
+    size_t peak  = peakBytes.load(std::memory_order_relaxed);
+    while(inUse > peak &&
+          !peakBytes.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+    {}
 }
 
-FERAL_FUNC(mpIntCopy, 1, false,
-           "  var.fn() -> MPInt\n"
-           "Creates a new instance of `var` and returns it.")
+void *MPArena::alloc(size_t sz)
 {
-    return vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
+    addUsage(sz);
+    if(sz > MAX_BLOCK) return arenaMalloc(nullptr, sz);
+
+    size_t cls          = getClass(sz);
+    MPArenaCache &cache = arenaCache;
+    if(!cache.lists[cls]) {
+        if(cache.dead) {
+            FreeBlock *block = nullptr;
+            take(cls, block, 1);
+            return block;
+        }
+        arenaCacheFlusher.active = true; // ensures the flusher is constructed for this thread
+        cache.counts[cls] += take(cls, cache.lists[cls], ARENA_CACHE_REFILL);
+    }
+    FreeBlock *block = cache.lists[cls];
+    cache.lists[cls] = block->next;
+    --cache.counts[cls];
+    return block;
 }
 
-#define ARITHI_FUNC(fn, name)                                                                  \
-    FERAL_FUNC(mpInt##fn, 1, false,                                                            \
-               "  var.fn(other) -> MPInt\n"                                                    \
-               "Applies arithmetic-" STRINGIFY(                                                \
-                   name) " on `var` and `other` and returns a new MPInt with the result.")     \
-    {                                                                                          \
-        EXPECT2(VarMPInt, VarMPFlt, args[1], "big int " STRINGIFY(name));                      \
-        if(args[1]->is<VarMPInt>()) {                                                          \
-            VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());     \
-            mpz_##name(res->getPtr(), res->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());   \
-            return res;                                                                        \
-        }                                                                                      \
-        VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());         \
-        mpz_t tmp;                                                                             \
-        mpz_init(tmp);                                                                         \
-        mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode()); \
-        mpz_##name(res->getPtr(), res->getSrcPtr(), tmp);                                      \
-        mpz_clear(tmp);                                                                        \
-        return res;                                                                            \
+void *MPArena::realloc(void *ptr, size_t oldSz, size_t newSz)
+{
+    if(oldSz > MAX_BLOCK && newSz > MAX_BLOCK) {
+        bytesInUse.fetch_sub(oldSz, std::memory_order_relaxed);
+        addUsage(newSz);
+        return arenaMalloc(ptr, newSz);
+    }
+    if(oldSz <= MAX_BLOCK && newSz <= MAX_BLOCK && getClass(oldSz) == getClass(newSz)) {
+        if(newSz > oldSz) addUsage(newSz - oldSz);
+        else bytesInUse.fetch_sub(oldSz - newSz, std::memory_order_relaxed);
+        return ptr;
     }
+    void *res = alloc(newSz);
+    memcpy(res, ptr, oldSz < newSz ? oldSz : newSz);
+    free(ptr, oldSz);
+    return res;
+}
 
-#define ARITHI_ASSN_FUNC(fn, name)                                                             \
-    FERAL_FUNC(mpIntAssn##fn, 1, false,                                                        \
-               "  var.fn(other) -> var\n"                                                      \
-               "Applies arithmetic-" STRINGIFY(                                                \
-                   name) " on `var` with `other` and returns the updated `var`.")              \
-    {                                                                                          \
-        EXPECT_NO_CONST(args[0], "var");                                                       \
-        EXPECT2(VarMPInt, VarMPFlt, args[1], "big int " STRINGIFY(name) "-assn");              \
-        if(args[1]->is<VarMPInt>()) {                                                          \
-            mpz_##name(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),    \
-                       as<VarMPInt>(args[1])->getSrcPtr());                                    \
-            return args[0];                                                                    \
-        }                                                                                      \
-        mpz_t tmp;                                                                             \
-        mpz_init(tmp);                                                                         \
-        mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode()); \
-        mpz_##name(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), tmp);  \
-        mpz_clear(tmp);                                                                        \
-        return args[0];                                                                        \
+void MPArena::free(void *ptr, size_t sz)
+{
+    bytesInUse.fetch_sub(sz, std::memory_order_relaxed);
+    if(sz > MAX_BLOCK) {
+        ::free(ptr);
+        return;
     }
 
-#define LOGICI_FUNC(fn, name, sym)                                                             \
-    FERAL_FUNC(mpInt##fn, 1, false,                                                            \
-               "  var.fn(other) -> Bool\n"                                                     \
-               "Applies logical '" STRINGIFY(                                                  \
-                   name) "' between `var` and `other` and returns the resulting Bool.")        \
-    {                                                                                          \
-        EXPECT(VarMPInt, args[1], "big int logical " STRINGIFY(name));                         \
-        return mpz_cmp(as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr()) \
-                       sym 0                                                                   \
-                   ? vm.getTrue()                                                              \
-                   : vm.getFalse();                                                            \
+    size_t cls          = getClass(sz);
+    FreeBlock *block    = (FreeBlock *)ptr;
+    MPArenaCache &cache = arenaCache;
+    if(cache.dead) {
+        give(cls, block, block);
+        return;
     }
+    // a thread may only ever free blocks (allocated by other threads), so this must ensure the
+    // flusher is constructed as well
+    arenaCacheFlusher.active = true;
+    block->next      = cache.lists[cls];
+    cache.lists[cls] = block;
+    if(++cache.counts[cls] <= ARENA_CACHE_MAX) return;
+    // return half of the cached blocks to the arena
+    FreeBlock *last = block;
+    for(size_t i = 1; i < ARENA_CACHE_MAX / 2; ++i) last = last->next;
+    cache.lists[cls] = last->next;
+    cache.counts[cls] -= ARENA_CACHE_MAX / 2;
+    give(cls, block, last);
+}
 
-ARITHI_FUNC(Add, add)
-ARITHI_FUNC(Sub, sub)
-ARITHI_FUNC(Mul, mul)
-ARITHI_FUNC(Mod, mod)
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// MPWorkerPool //////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
 
-ARITHI_ASSN_FUNC(Add, add)
-ARITHI_ASSN_FUNC(Sub, sub)
-ARITHI_ASSN_FUNC(Mul, mul)
-ARITHI_ASSN_FUNC(Mod, mod)
+MPWorkerPool workerPool;
 
-LOGICI_FUNC(LT, lt, <)
-LOGICI_FUNC(GT, gt, >)
-LOGICI_FUNC(LE, le, <=)
-LOGICI_FUNC(GE, ge, >=)
+MPWorkerPool::MPWorkerPool() : queued(0), nextQueue(0), stopping(false) {}
+MPWorkerPool::~MPWorkerPool() { stop(); }
 
-FERAL_FUNC(mpIntEQ, 1, false,
-           "  var.fn(other) -> Bool\n"
-           "Returns `true` if `var` and `other` are equal.")
+void MPWorkerPool::stop()
 {
-    if(args[1]->is<VarMPInt>()) {
-        return mpz_cmp(as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr()) == 0
-                   ? vm.getTrue()
-                   : vm.getFalse();
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx);
+        stopping = true;
     }
-    return vm.getFalse();
+    wake.notify_all();
+    for(auto &w : workers) w.join();
+    workers.clear();
 }
 
-FERAL_FUNC(mpIntNE, 1, false,
-           "  var.fn(other) -> Bool\n"
-           "Returns `true` if `var` and `other` are not equal.")
+void MPWorkerPool::start()
 {
-    if(args[1]->is<VarMPInt>()) {
-        return mpz_cmp(as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr()) != 0
-                   ? vm.getTrue()
-                   : vm.getFalse();
+    size_t count = std::max(1u, std::thread::hardware_concurrency());
+    for(size_t i = 0; i < count; ++i) queues.emplace_back(new Queue);
+    for(size_t i = 0; i < count; ++i) workers.emplace_back(&MPWorkerPool::work, this, i);
+}
+
+void MPWorkerPool::work(size_t idx)
+{
+    while(true) {
+        if(runTask(idx)) continue;
+        std::unique_lock<std::mutex> lock(sleepMtx);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if(stopping && queued.load() == 0) return;
     }
-    return vm.getTrue();
 }
 
-FERAL_FUNC(mpIntDiv, 1, false,
-           "  var.fn(other) -> MPInt\n"
-           "Divides `var` by `other` and returns a new MPInt with the result.")
+bool MPWorkerPool::runTask(size_t idx)
 {
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int division");
-    if(args[1]->is<VarMPInt>()) {
-        // rhs == 0
-        if(mpz_get_ui(as<VarMPInt>(args[1])->getSrcPtr()) == 0) {
-            vm.fail(loc, "division by zero");
-            return nullptr;
+    for(size_t i = 0; i < queues.size(); ++i) {
+        Queue &q = *queues[(idx + i) % queues.size()];
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(q.mtx);
+            if(q.tasks.empty()) continue;
+            if(i == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
         }
-        VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-        mpz_div(res->getPtr(), res->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());
-        return res;
-    }
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    // rhs == 0
-    if(mpz_get_ui(tmp) == 0) {
-        vm.fail(loc, "division by zero");
-        mpz_clear(tmp);
-        return nullptr;
+        queued.fetch_sub(1);
+        task();
+        return true;
     }
-    mpz_div(res->getPtr(), res->getSrcPtr(), tmp);
-    mpz_clear(tmp);
-    return res;
+    return false;
 }
 
-FERAL_FUNC(mpIntAssnDiv, 1, false,
-           "  var.fn(other) -> var\n"
-           "Divides `var` by `other` and returns the updated `var`.")
+void MPWorkerPool::submit(Task &&task)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int division");
-    if(args[1]->is<VarMPInt>()) {
-        // rhs == 0
-        if(mpz_get_ui(as<VarMPInt>(args[1])->getSrcPtr()) == 0) {
-            vm.fail(loc, "division by zero");
-            return nullptr;
-        }
-        mpz_div(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                as<VarMPInt>(args[1])->getSrcPtr());
-        return args[0];
+    std::call_once(startFlag, &MPWorkerPool::start, this);
+    // Counted before it is queued so that the count never drops below 0, and under the lock so
+    // that a worker which is about to sleep either sees it or gets woken up.
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx);
+        queued.fetch_add(1);
     }
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    // rhs == 0
-    if(mpz_get_ui(tmp) == 0) {
-        vm.fail(loc, "division by zero");
-        mpz_clear(tmp);
-        return nullptr;
+    Queue &q = *queues[nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(q.mtx);
+        q.tasks.push_back(std::move(task));
     }
-    mpz_div(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), tmp);
-    mpz_clear(tmp);
-    return args[0];
+    wake.notify_one();
 }
 
-FERAL_FUNC(mpIntBAnd, 1, false,
-           "  var.fn(other) -> MPInt\n"
-           "Applies bitwise AND operation between `var` and `other` and returns a new MPInt with "
-           "the result.")
+void MPWorkerPool::run(size_t count, size_t chunks,
+                       const std::function<void(size_t, size_t, size_t)> &fn)
 {
-    EXPECT(VarMPInt, args[1], "big int bitwise AND");
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_and(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());
-    return res;
+    chunks = std::min(chunks, count);
+    if(chunks <= 1) {
+        if(count > 0) fn(0, 0, count);
+        return;
+    }
+    // The chunks are claimed (in order) by the caller and by the tasks submitted for them, so the
+    // caller only ever runs chunks of its own, and never some other queued task (like a long
+    // background operation) while the workers are busy. Tasks which only start after all the
+    // chunks were claimed (and the caller may have returned) do nothing, which is why the state
+    // is shared with them.
+    struct RunState
+    {
+        std::atomic<size_t> next;
+        size_t left;
+        std::mutex mtx;
+        std::condition_variable done;
+    };
+    auto state  = std::make_shared<RunState>();
+    state->next = 0;
+    state->left = chunks;
+    auto runChunks = [state, count, chunks, fn = &fn]() {
+        for(size_t i; (i = state->next.fetch_add(1)) < chunks;) {
+            (*fn)(i, i * count / chunks, (i + 1) * count / chunks);
+            std::lock_guard<std::mutex> lock(state->mtx);
+            if(--state->left == 0) state->done.notify_one();
+        }
+    };
+    for(size_t i = 1; i < chunks; ++i) submit(runChunks);
+    runChunks();
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->done.wait(lock, [&]() { return state->left == 0; });
 }
 
-FERAL_FUNC(mpIntBOr, 1, false,
-           "  var.fn(other) -> MPInt\n"
-           "Applies bitwise OR operation between `var` and `other` and returns a new MPInt with "
-           "the result.")
+size_t MPWorkerPool::getThreadCount()
 {
-    EXPECT(VarMPInt, args[1], "big int bitwise OR");
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_ior(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());
-    return res;
+    std::call_once(startFlag, &MPWorkerPool::start, this);
+    return workers.size();
 }
 
-FERAL_FUNC(mpIntBXOr, 1, false,
-           "  var.fn(other) -> MPInt\n"
-           "Applies bitwise XOR operation between `var` and `other` and returns a new MPInt with "
-           "the result.")
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// MPProfiler ///////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+MPProfiler profiler;
+
+static const char *PROFILER_VAL_TYPE_NAMES[] = {"MPInt",      "MPFlt",      "MPComplex",
+                                                "MPIntArray", "MPFltArray", "Other"};
+
+MPProfiler::Op::Op(String &&name) : name(std::move(name)), calls(0), ns(0), newVals(0)
 {
-    EXPECT(VarMPInt, args[1], "big int bitwise XOR");
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_xor(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());
-    return res;
+    for(auto &count : limbs) count.store(0, std::memory_order_relaxed);
 }
 
-FERAL_FUNC(mpIntBNot, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Applies bitwise NOT operation on `var` and returns a new MPInt with the result.")
+MPProfiler::MPProfiler() : enabled(false)
 {
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_com(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr());
-    return res;
+    for(auto &count : newVals) count.store(0, std::memory_order_relaxed);
 }
 
-FERAL_FUNC(mpIntAssnBAnd, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies bitwise AND operation between `var` and `other` and returns the updated `var`.")
+MPProfiler::Op *MPProfiler::addOp(String &&name)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT(VarMPInt, args[1], "big int bitwise AND-assn");
-    mpz_and(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-            as<VarMPInt>(args[1])->getSrcPtr());
-    return args[0];
+    ops.emplace_back(new Op(std::move(name)));
+    return ops.back().get();
 }
 
-FERAL_FUNC(mpIntAssnBOr, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies bitwise OR operation between `var` and `other` and returns the updated `var`.")
+// Returns the number of limbs of `var` if it is an MP value (the limbs of its precision for floats
+// and complexes), or 0 if it is not.
+static size_t getProfiledLimbs(Var *var)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT(VarMPInt, args[1], "big int bitwise OR-assn");
-    mpz_ior(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-            as<VarMPInt>(args[1])->getSrcPtr());
-    return args[0];
+    mpfr_prec_t prec;
+    if(var->is<VarMPInt>()) {
+        VarMPInt *val = as<VarMPInt>(var);
+        return val->isSmall() ? 1 : std::max<size_t>(mpz_size(val->getSrcPtr()), 1);
+    } else if(var->is<VarMPFlt>()) {
+        prec = mpfr_get_prec(as<VarMPFlt>(var)->getSrcPtr());
+    } else if(var->is<VarMPComplex>()) {
+        prec = mpfr_get_prec(mpc_realref(as<VarMPComplex>(var)->getSrcPtr()));
+    } else {
+        return 0;
+    }
+    return (prec + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
 }
 
-FERAL_FUNC(mpIntAssnBXOr, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies bitwise XOR operation between `var` and `other` and returns the updated `var`.")
+static MPProfiler::ValType getProfiledValType(Var *var)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT(VarMPInt, args[1], "big int bitwise XOR-assn");
-    mpz_xor(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-            as<VarMPInt>(args[1])->getSrcPtr());
-    return args[0];
+    if(var->is<VarMPInt>()) return MPProfiler::ValType::Int;
+    if(var->is<VarMPFlt>()) return MPProfiler::ValType::Flt;
+    if(var->is<VarMPComplex>()) return MPProfiler::ValType::Complex;
+    if(var->is<VarMPIntArray>()) return MPProfiler::ValType::IntArray;
+    if(var->is<VarMPFltArray>()) return MPProfiler::ValType::FltArray;
+    return MPProfiler::ValType::Other;
 }
 
-FERAL_FUNC(mpIntAssnBNot, 0, false,
-           "  var.fn(other) -> var\n"
-           "Applies bitwise NOT operation on `var` and returns the updated `var`.")
+Var *MPProfiler::call(Op &op, MPNativeFn fn, VirtualMachine &vm, ModuleLoc loc, Span<Var *> args,
+                      const Map<String, size_t> &assnArgs)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    mpz_com(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr());
-    return args[0];
+    // Measured before the call, since in place operations modify their operands.
+    size_t maxLimbs = 0;
+    for(size_t i = 0; i < args.size(); ++i) {
+        maxLimbs = std::max(maxLimbs, getProfiledLimbs(args[i]));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Var *res   = fn(vm, loc, args, assnArgs);
+    auto ns    = std::chrono::steady_clock::now() - start;
+
+    size_t bucket = 0;
+    if(maxLimbs > 0) bucket = std::min<size_t>(64 - __builtin_clzll(maxLimbs), LIMB_BUCKETS - 1);
+    op.calls.fetch_add(1, std::memory_order_relaxed);
+    op.ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(ns).count(),
+                    std::memory_order_relaxed);
+    op.limbs[bucket].fetch_add(1, std::memory_order_relaxed);
+    // New Vars come without any references, unlike the operands returned by in place operations
+    // (and nil / true / false).
+    if(res && res->getRef() == 0) {
+        op.newVals.fetch_add(1, std::memory_order_relaxed);
+        newVals[(size_t)getProfiledValType(res)].fetch_add(1, std::memory_order_relaxed);
+    }
+    return res;
 }
 
-FERAL_FUNC(
-    mpIntLShift, 1, false,
-    "  var.fn(other) -> MPInt\n"
-    "Applies left shift operation on `var` using `other` and returns a new MPInt with the result.")
+void MPProfiler::reset()
 {
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int left-shift");
-    if(args[1]->is<VarMPInt>()) {
-        VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-        mpz_mul_2exp(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                     mpz_get_si(as<VarMPInt>(args[1])->getSrcPtr()));
-        return res;
+    for(auto &op : ops) {
+        op->calls.store(0, std::memory_order_relaxed);
+        op->ns.store(0, std::memory_order_relaxed);
+        op->newVals.store(0, std::memory_order_relaxed);
+        for(auto &count : op->limbs) count.store(0, std::memory_order_relaxed);
     }
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    mpz_mul_2exp(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), mpz_get_si(tmp));
-    mpz_clear(tmp);
-    return res;
+    for(auto &count : newVals) count.store(0, std::memory_order_relaxed);
 }
 
-FERAL_FUNC(
-    mpIntRShift, 1, false,
-    "  var.fn(other) -> MPInt\n"
-    "Applies right shift operation on `var` using `other` and returns a new MPInt with the result.")
+// Inserts `val` into `map` as `key`, taking a reference to it.
+static void profilerMapInsert(VirtualMachine &vm, VarMap *map, const String &key, Var *val)
 {
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int right-shift");
-    if(args[1]->is<VarMPInt>()) {
-        VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-        mpz_div_2exp(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                     mpz_get_si(as<VarMPInt>(args[1])->getSrcPtr()));
-        return res;
+    vm.incVarRef(val);
+    map->getVal().insert({key, val});
+}
+
+Var *MPProfiler::getStats(VirtualMachine &vm, ModuleLoc loc)
+{
+    VarMap *opsMap = vm.makeVar<VarMap>(loc, ops.size(), false);
+    for(auto &op : ops) {
+        uint64_t calls = op->calls.load(std::memory_order_relaxed);
+        if(calls == 0) continue;
+        VarVec *limbsVec = vm.makeVar<VarVec>(loc, LIMB_BUCKETS, false);
+        for(auto &count : op->limbs) {
+            Var *val = vm.makeVar<VarInt>(loc, (int64_t)count.load(std::memory_order_relaxed));
+            vm.incVarRef(val);
+            limbsVec->getVal().push_back(val);
+        }
+        VarMap *opMap = vm.makeVar<VarMap>(loc, 4, false);
+        profilerMapInsert(vm, opMap, "calls", vm.makeVar<VarInt>(loc, (int64_t)calls));
+        profilerMapInsert(vm, opMap, "ns",
+                          vm.makeVar<VarInt>(loc, (int64_t)op->ns.load(std::memory_order_relaxed)));
+        profilerMapInsert(
+            vm, opMap, "newVals",
+            vm.makeVar<VarInt>(loc, (int64_t)op->newVals.load(std::memory_order_relaxed)));
+        profilerMapInsert(vm, opMap, "limbs", limbsVec);
+        profilerMapInsert(vm, opsMap, op->name, opMap);
     }
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    mpz_div_2exp(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), mpz_get_si(tmp));
-    mpz_clear(tmp);
+    VarMap *newValsMap = vm.makeVar<VarMap>(loc, (size_t)ValType::Count, false);
+    for(size_t i = 0; i < (size_t)ValType::Count; ++i) {
+        Var *val = vm.makeVar<VarInt>(loc, (int64_t)newVals[i].load(std::memory_order_relaxed));
+        profilerMapInsert(vm, newValsMap, PROFILER_VAL_TYPE_NAMES[i], val);
+    }
+    VarMap *res = vm.makeVar<VarMap>(loc, 2, false);
+    profilerMapInsert(vm, res, "ops", opsMap);
+    profilerMapInsert(vm, res, "newVals", newValsMap);
     return res;
 }
 
-FERAL_FUNC(mpIntAssnLShift, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies left shift operation on `var` using `other` and returns the updated `var`.")
+void MPProfiler::toJson(String &out)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int left-shift-assn");
-    if(args[1]->is<VarMPInt>()) {
-        mpz_mul_2exp(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                     mpz_get_si(as<VarMPInt>(args[1])->getSrcPtr()));
-        return args[0];
+    out += "{\"ops\": {";
+    bool first = true;
+    for(auto &op : ops) {
+        uint64_t calls = op->calls.load(std::memory_order_relaxed);
+        if(calls == 0) continue;
+        out += first ? "\n  \"" : ",\n  \"";
+        first = false;
+        for(char c : op->name) {
+            if(c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        out += "\": {\"calls\": " + std::to_string(calls);
+        out += ", \"ns\": " + std::to_string(op->ns.load(std::memory_order_relaxed));
+        out += ", \"newVals\": " + std::to_string(op->newVals.load(std::memory_order_relaxed));
+        out += ", \"limbs\": [";
+        for(size_t i = 0; i < LIMB_BUCKETS; ++i) {
+            if(i > 0) out += ", ";
+            out += std::to_string(op->limbs[i].load(std::memory_order_relaxed));
+        }
+        out += "]}";
     }
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    mpz_mul_2exp(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                 mpz_get_si(tmp));
-    mpz_clear(tmp);
-    return args[0];
+    out += first ? "},\n\"newVals\": {" : "\n},\n\"newVals\": {";
+    for(size_t i = 0; i < (size_t)ValType::Count; ++i) {
+        if(i > 0) out += ", ";
+        out += "\"";
+        out += PROFILER_VAL_TYPE_NAMES[i];
+        out += "\": " + std::to_string(newVals[i].load(std::memory_order_relaxed));
+    }
+    out += "}}";
 }
 
-FERAL_FUNC(mpIntAssnRShift, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies right shift operation on `var` using `other` and returns the updated `var`.")
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// VarMPInt /////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+VarMPInt::VarMPInt(ModuleLoc loc, int64_t _val)
+    : Var(loc, 0), small(_val), owner(nullptr), vm(nullptr), isSmallVal(true), isValInit(false),
+      isViewVal(false)
+{}
+VarMPInt::VarMPInt(ModuleLoc loc, mpz_srcptr _val)
+    : Var(loc, 0), small(0), owner(nullptr), vm(nullptr), isSmallVal(true), isValInit(false),
+      isViewVal(false)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int right-shift-assn");
-    if(args[1]->is<VarMPInt>()) {
-        mpz_div_2exp(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                     mpz_get_si(as<VarMPInt>(args[1])->getSrcPtr()));
-        return args[0];
+    if(mpz_fits_slong_p(_val)) {
+        small = mpz_get_si(_val);
+        return;
     }
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    mpz_div_2exp(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(),
-                 mpz_get_si(tmp));
-    mpz_clear(tmp);
-    return args[0];
+    pool.initInt(val);
+    mpz_set(val, _val);
+    isSmallVal = false;
+    isValInit  = true;
 }
-
-FERAL_FUNC(mpIntPreInc, 0, false,
-           "  var.fn() -> var\n"
-           "Applies pre-increment on `var` and returns `var` itself.")
+VarMPInt::VarMPInt(ModuleLoc loc, mpfr_srcptr _val)
+    : Var(loc, 0), small(0), owner(nullptr), vm(nullptr), isSmallVal(false), isValInit(true),
+      isViewVal(false)
 {
-    mpz_add_ui(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), 1);
-    return args[0];
+    pool.initInt(val);
+    mpfr_get_z(val, _val, mpfr_get_default_rounding_mode());
+    normalize();
 }
-
-FERAL_FUNC(mpIntPostInc, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Applies post-increment on `var` and returns a new MPInt with `var` - 1 as the result.")
+VarMPInt::VarMPInt(ModuleLoc loc, const char *_val)
+    : Var(loc, 0), small(0), owner(nullptr), vm(nullptr), isSmallVal(false), isValInit(true),
+      isViewVal(false)
 {
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_add_ui(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), 1);
-    return res;
+    pool.initInt(val);
+    mpz_set_str(val, _val, 0);
+    normalize();
 }
-
-FERAL_FUNC(mpIntPreDec, 0, false,
-           "  var.fn() -> var\n"
-           "Applies pre-decrement on `var` and returns `var` itself.")
+VarMPInt::VarMPInt(ModuleLoc loc, VirtualMachine &vm, Var *owner, const mp_limb_t *limbs,
+                   mp_size_t size)
+    : Var(loc, 0), small(0), owner(nullptr), vm(nullptr), isSmallVal(false), isValInit(false),
+      isViewVal(true)
 {
-    mpz_sub_ui(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), 1);
-    return args[0];
+    mpz_roinit_n(val, limbs, size);
+    normalize();
+    if(isSmallVal) {
+        isViewVal = false;
+        return;
+    }
+    this->owner = owner;
+    this->vm    = &vm;
+    vm.incVarRef(owner);
+}
+VarMPInt::~VarMPInt()
+{
+    if(isValInit) pool.clearInt(val);
+    if(owner) vm->decVarRef(owner);
 }
 
-FERAL_FUNC(mpIntPostDec, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Applies post-decrement on `var` and returns a new MPInt with `var` + 1 as the result.")
+void VarMPInt::promote()
 {
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_sub_ui(as<VarMPInt>(args[0])->getPtr(), as<VarMPInt>(args[0])->getSrcPtr(), 1);
-    return res;
+    if(!isValInit) {
+        pool.initInt(val);
+        isValInit = true;
+        isViewVal = false;
+        releaseOwner();
+    }
+    mpz_set_si(val, small);
+    isSmallVal = false;
 }
 
-FERAL_FUNC(mpIntUSub, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Returns the negative equivalent of `var` as a new MPInt.")
+void VarMPInt::detach()
 {
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_neg(res->getPtr(), res->getSrcPtr());
-    return res;
+    mpz_t copy;
+    pool.initInt(copy);
+    mpz_set(copy, val);
+    *val      = *copy;
+    isValInit = true;
+    isViewVal = false;
+    releaseOwner();
 }
 
-FERAL_FUNC(mpIntPow, 1, false,
-           "  var.fn(other) -> MPInt\n"
-           "Raises `var` to the power of `other` and returns a new MPInt with the result.")
+void VarMPInt::releaseOwner()
 {
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int power");
-    if(args[1]->is<VarMPInt>()) {
-        VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-        mpz_pow_ui(res->getPtr(), res->getSrcPtr(), mpz_get_ui(as<VarMPInt>(args[1])->getSrcPtr()));
-        return res;
-    }
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    mpz_pow_ui(res->getPtr(), res->getSrcPtr(), mpz_get_ui(tmp));
-    mpz_clear(tmp);
-    return res;
+    if(!owner) return;
+    vm->decVarRef(owner);
+    owner = nullptr;
+    vm    = nullptr;
 }
 
-FERAL_FUNC(mpIntRoot, 1, false,
-           "  var.fn(other) -> MPInt\n"
-           "Lowers `var` to the root of `other` and returns a new MPInt with the result.")
+void VarMPInt::normalize()
 {
-    EXPECT2(VarMPInt, VarMPFlt, args[1], "big int root");
-    if(args[1]->is<VarMPInt>()) {
-        VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-        mpz_root(res->getPtr(), res->getSrcPtr(), mpz_get_ui(as<VarMPInt>(args[1])->getSrcPtr()));
-        return res;
-    }
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpfr_get_z(tmp, as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    mpz_root(res->getPtr(), res->getSrcPtr(), mpz_get_ui(tmp));
-    mpz_clear(tmp);
-    return res;
+    if(isSmallVal || !mpz_fits_slong_p(val)) return;
+    small      = mpz_get_si(val);
+    isSmallVal = true;
 }
 
-FERAL_FUNC(mpIntPopCnt, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Returns the number of set bits in `var` as a new MPInt.")
+void VarMPInt::setSmall(int64_t _val)
 {
-    return vm.makeVar<VarMPInt>(loc, mpz_popcount(as<VarMPInt>(args[0])->getSrcPtr()));
+    small      = _val;
+    isSmallVal = true;
 }
 
-FERAL_FUNC(mpIntToInt, 0, false,
-           "  var.fn() -> Int\n"
-           "Converts `var` from MPInt to Int and returns the value.")
+bool VarMPInt::onSet(VirtualMachine &vm, Var *from)
 {
-    return vm.makeVar<VarMPInt>(loc, mpz_get_si(as<VarMPInt>(args[0])->getPtr()));
+    VarMPInt *f = as<VarMPInt>(from);
+    if(f->isSmall()) setSmall(f->getSmall());
+    else mpz_set(getPtr(), f->getSrcPtr());
+    return true;
 }
 
-FERAL_FUNC(mpIntToStr, 0, false,
-           "  var.fn() -> Str\n"
-           "Converts `var` from MPInt to Str and returns the value.")
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// VarMPFlt /////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+VarMPFlt::VarMPFlt(ModuleLoc loc, double _val, mpfr_prec_t prec) : Var(loc, 0)
+{
+    pool.initFlt(val, prec ? prec : mpfr_get_default_prec());
+    mpfr_set_ld(val, _val, mpfr_get_default_rounding_mode());
+}
+VarMPFlt::VarMPFlt(ModuleLoc loc, mpfr_srcptr _val, mpfr_prec_t prec) : Var(loc, 0)
+{
+    pool.initFlt(val, prec ? prec : mpfr_get_prec(_val));
+    mpfr_set(val, _val, mpfr_get_default_rounding_mode());
+}
+VarMPFlt::VarMPFlt(ModuleLoc loc, mpz_srcptr _val, mpfr_prec_t prec) : Var(loc, 0)
+{
+    pool.initFlt(val, prec ? prec : mpfr_get_default_prec());
+    mpfr_set_z(val, _val, mpfr_get_default_rounding_mode());
+}
+VarMPFlt::VarMPFlt(ModuleLoc loc, const char *_val, mpfr_prec_t prec) : Var(loc, 0)
 {
-    typedef void (*gmp_freefunc_t)(void *, size_t);
+    pool.initFlt(val, prec ? prec : mpfr_get_default_prec());
+    mpfr_set_str(val, _val, 0, mpfr_get_default_rounding_mode());
+}
+VarMPFlt::~VarMPFlt() { pool.clearFlt(val); }
 
-    char *_res  = mpz_get_str(NULL, 10, as<VarMPInt>(args[0])->getSrcPtr());
-    VarStr *res = vm.makeVar<VarStr>(loc, _res);
+bool VarMPFlt::onSet(VirtualMachine &vm, Var *from)
+{
+    mpfr_set(val, as<VarMPFlt>(from)->getPtr(), mpfr_get_default_rounding_mode());
+    return true;
+}
 
-    gmp_freefunc_t freefunc;
-    mp_get_memory_functions(NULL, NULL, &freefunc);
-    freefunc(_res, strlen(_res) + 1);
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// VarMPComplex ///////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
 
-    return res;
+VarMPComplex::VarMPComplex(ModuleLoc loc, mpfr_prec_t prec) : Var(loc, 0) { initBase(prec); }
+VarMPComplex::VarMPComplex(ModuleLoc loc, int64_t real, int64_t imag, mpfr_prec_t prec)
+    : Var(loc, 0)
+{
+    initBase(prec);
+    mpc_set_si_si(val, real, imag, mpc_get_default_rounding_mode());
+}
+VarMPComplex::VarMPComplex(ModuleLoc loc, double real, double imag, mpfr_prec_t prec)
+    : Var(loc, 0)
+{
+    initBase(prec);
+    mpc_set_ld_ld(val, real, imag, mpc_get_default_rounding_mode());
+}
+VarMPComplex::VarMPComplex(ModuleLoc loc, mpfr_srcptr real, mpfr_srcptr imag, mpfr_prec_t prec)
+    : Var(loc, 0)
+{
+    initBase(prec);
+    mpc_set_fr_fr(val, real, imag, mpc_get_default_rounding_mode());
+}
+VarMPComplex::VarMPComplex(ModuleLoc loc, mpz_srcptr real, mpz_srcptr imag, mpfr_prec_t prec)
+    : Var(loc, 0)
+{
+    initBase(prec);
+    mpc_set_z_z(val, real, imag, mpc_get_default_rounding_mode());
+}
+VarMPComplex::VarMPComplex(ModuleLoc loc, mpc_srcptr _val, mpfr_prec_t prec) : Var(loc, 0)
+{
+    initBase(prec ? prec : mpfr_get_prec(mpc_realref(_val)));
+    mpc_set(val, _val, mpc_get_default_rounding_mode());
 }
+VarMPComplex::VarMPComplex(ModuleLoc loc, const char *_val, mpfr_prec_t prec) : Var(loc, 0)
+{
+    initBase(prec);
+    mpc_set_str(val, _val, 0, mpc_get_default_rounding_mode());
+}
+VarMPComplex::~VarMPComplex() { pool.clearComplex(val); }
 
-// Iterator
+void VarMPComplex::initBase(mpfr_prec_t prec)
+{
+    pool.initComplex(val, prec ? prec : mpc_get_default_prec());
+}
 
-class VarMPIntIterator : public Var
+bool VarMPComplex::onSet(VirtualMachine &vm, Var *from)
 {
-    mpz_t begin, end, step, curr;
-    bool started;
-    bool reversed;
+    mpc_set(val, as<VarMPComplex>(from)->getPtr(), mpc_get_default_rounding_mode());
+    return true;
+}
 
-public:
-    VarMPIntIterator(ModuleLoc loc);
-    VarMPIntIterator(ModuleLoc loc, mpz_srcptr _begin, mpz_srcptr _end, mpz_srcptr _step);
-    ~VarMPIntIterator();
+static thread_local mpfr_prec_t mpcDefaultPrec = 256;
 
-    Var *copy(ModuleLoc loc);
-    void set(Var *from);
+mpc_rnd_t mpc_get_default_rounding_mode() { return MPC_RNDNN; }
+mpfr_prec_t mpc_get_default_prec() { return mpcDefaultPrec; }
+void mpc_set_default_prec(mpfr_prec_t prec) { mpcDefaultPrec = prec; }
 
-    bool next(mpz_ptr val);
+// Result precision of a binary operation - the max of its operands' precisions, so that no
+// operand loses precision, and an operation never silently uses more than what the operands have.
+static inline mpfr_prec_t resultPrec(mpfr_prec_t a, mpfr_prec_t b) { return a > b ? a : b; }
 
-    inline void setReversed(mpz_srcptr step) { reversed = mpz_cmp_si(step, 0) < 0; }
-    inline mpz_ptr getBegin() { return begin; }
-    inline mpz_ptr getEnd() { return end; }
-    inline mpz_ptr getStep() { return step; }
-    inline mpz_ptr getCurr() { return curr; }
-};
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// VarMPIntArray //////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
 
-VarMPIntIterator::VarMPIntIterator(ModuleLoc loc) : Var(loc, 0), started(false), reversed(false)
+VarMPIntArray::VarMPIntArray(ModuleLoc loc) : Var(loc, 0) {}
+VarMPIntArray::VarMPIntArray(ModuleLoc loc, VarMPIntArray *from)
+    : Var(loc, 0), limbs(from->limbs), elems(from->elems)
+{}
+
+size_t VarMPIntArray::append(const mp_limb_t *src, size_t count)
 {
-    mpz_init(begin);
-    mpz_init(end);
-    mpz_init(step);
-    mpz_init(curr);
+    size_t offset = limbs.size();
+    // resize() may move the buffer, so a source inside it must be located again afterwards.
+    bool isOwn       = src >= limbs.data() && src < limbs.data() + limbs.size();
+    size_t srcOffset = isOwn ? src - limbs.data() : 0;
+    limbs.resize(offset + count);
+    if(isOwn) src = limbs.data() + srcOffset;
+    if(count > 0) memcpy(limbs.data() + offset, src, count * sizeof(mp_limb_t));
+    return offset;
 }
-VarMPIntIterator::VarMPIntIterator(ModuleLoc loc, mpz_srcptr _begin, mpz_srcptr _end,
-                                   mpz_srcptr _step)
-    : Var(loc, 0), started(false), reversed(mpz_cmp_si(_step, 0) < 0)
+
+void VarMPIntArray::reserve(size_t count, size_t limbCount)
 {
-    mpz_init_set(begin, _begin);
-    mpz_init_set(end, _end);
-    mpz_init_set(step, _step);
-    mpz_init_set(curr, _begin);
+    elems.reserve(count);
+    limbs.reserve(limbCount);
 }
-VarMPIntIterator::~VarMPIntIterator() { mpz_clears(begin, end, step, curr, NULL); }
 
-Var *VarMPIntIterator::copy(ModuleLoc loc) { return new VarMPIntIterator(loc, begin, end, step); }
-void VarMPIntIterator::set(Var *from)
+void VarMPIntArray::push(mpz_srcptr val)
 {
-    VarMPIntIterator *f = as<VarMPIntIterator>(from);
-    mpz_set(begin, f->begin);
-    mpz_set(end, f->end);
-    mpz_set(step, f->step);
-    mpz_set(curr, f->curr);
-    started  = f->started;
-    reversed = f->reversed;
+    size_t count  = mpz_size(val);
+    size_t offset = append(mpz_limbs_read(val), count);
+    elems.push_back({offset, mpz_sgn(val) < 0 ? -(int)count : (int)count});
 }
 
-bool VarMPIntIterator::next(mpz_ptr val)
+void VarMPIntArray::set(size_t idx, mpz_srcptr val)
 {
-    if(reversed) {
-        if(mpz_cmp(curr, end) <= 0) return false;
-    } else {
-        if(mpz_cmp(curr, end) >= 0) return false;
-    }
-    if(!started) {
-        mpz_init(val);
-        mpz_set(val, curr);
-        started = true;
-        return true;
-    }
-    mpz_t tmp;
-    mpz_init(tmp);
-    mpz_add(tmp, curr, step);
-    if(reversed) {
-        if(mpz_cmp(tmp, end) <= 0) {
-            mpz_clear(tmp);
-            return false;
-        }
+    size_t count = mpz_size(val);
+    Elem &e      = elems[idx];
+    if(count <= (size_t)(e.size < 0 ? -e.size : e.size)) {
+        memmove(limbs.data() + e.offset, mpz_limbs_read(val), count * sizeof(mp_limb_t));
     } else {
-        if(mpz_cmp(tmp, end) >= 0) {
-            mpz_clear(tmp);
-            return false;
-        }
+        e.offset = append(mpz_limbs_read(val), count);
     }
-    mpz_set(curr, tmp);
-    mpz_init(val);
-    mpz_set(val, curr);
-    mpz_clear(tmp);
-    return true;
+    e.size = mpz_sgn(val) < 0 ? -(int)count : (int)count;
 }
 
-FERAL_FUNC(mpIntRange, 1, true,
-           "  fn(start, end, step) -> MPIntIterator\n"
-           "Creates an iterator which starts at `start`, ends at `end` (exclusive), and "
-           "increments/decrements by `step`.\n"
-           "If `end` and `step` are not provided, `start` becomes 0, `end` becomes the provided "
-           "`start`, and `step` becomes 1.")
+void VarMPIntArray::reorder(const Vector<size_t> &order)
 {
-    Var *lhsBase  = args[1];
-    Var *rhsBase  = args.size() > 2 ? args[2] : nullptr;
-    Var *stepBase = args.size() > 3 ? args[3] : nullptr;
-
-    EXPECT(VarMPInt, lhsBase, "range start");
-    if(rhsBase) { EXPECT(VarMPInt, rhsBase, "range end"); }
-    if(stepBase) { EXPECT(VarMPInt, stepBase, "range step"); }
-
-    mpz_t begin, end, step;
-    mpz_inits(begin, end, step, NULL);
-    if(args.size() > 2) mpz_set(begin, as<VarMPInt>(lhsBase)->getSrcPtr());
-    else mpz_set_si(begin, 0);
-    if(rhsBase) mpz_set(end, as<VarMPInt>(rhsBase)->getSrcPtr());
-    else mpz_set(end, as<VarMPInt>(lhsBase)->getSrcPtr());
-    if(stepBase) mpz_set(step, as<VarMPInt>(stepBase)->getSrcPtr());
-    else mpz_set_si(step, 1);
-    VarMPIntIterator *res = vm.makeVar<VarMPIntIterator>(loc, begin, end, step);
-    mpz_clears(begin, end, step, NULL);
-    return res;
+    Vector<mp_limb_t> newLimbs;
+    Vector<Elem> newElems;
+    newLimbs.reserve(limbs.size());
+    newElems.reserve(order.size());
+    for(size_t idx : order) {
+        const Elem &e = elems[idx];
+        auto begin    = limbs.begin() + e.offset;
+        newElems.push_back({newLimbs.size(), e.size});
+        newLimbs.insert(newLimbs.end(), begin, begin + (e.size < 0 ? -e.size : e.size));
+    }
+    limbs.swap(newLimbs);
+    elems.swap(newElems);
 }
 
-FERAL_FUNC(getMPIntIteratorNext, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Fetch the next MPInt from the MPIntIterator `var`.\n"
-           "This function is mainly used by for-in loop.")
+void VarMPIntArray::clear()
 {
-    VarMPIntIterator *it = as<VarMPIntIterator>(args[0]);
-    mpz_t _res;
-    if(!it->next(_res)) { return vm.getNil(); }
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, _res);
-    mpz_clear(_res);
-    res->setLoadAsRef();
-    return res;
+    limbs.clear();
+    elems.clear();
 }
 
-// RNG
+void VarMPIntArray::addSlots(size_t count, size_t limbCount)
+{
+    size_t offset = limbs.size();
+    limbs.resize(offset + count * limbCount);
+    elems.reserve(elems.size() + count);
+    for(size_t i = 0; i < count; ++i) elems.push_back({offset + i * limbCount, 0});
+}
 
-FERAL_FUNC(mpIntRngGet, 1, false,
-           "  fn(upto) -> MPInt\n"
-           "Returns a random number between [0, `upto`).")
+bool VarMPIntArray::onSet(VirtualMachine &vm, Var *from)
 {
-    EXPECT(VarMPInt, args[1], "upper limit");
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
-    mpz_urandomm(res->getPtr(), rngstate, as<VarMPInt>(args[1])->getPtr());
-    return res;
+    VarMPIntArray *f = as<VarMPIntArray>(from);
+    limbs            = f->limbs;
+    elems            = f->elems;
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////// Float Functions /////////////////////////////////////////
+///////////////////////////////////////// VarMPFltArray //////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
-FERAL_FUNC(mpFltNewNative, 1, false,
-           "  fn(value) -> MPFlt\n"
-           "Creates and returns a new MPFlt with `value`.\n"
-           "Here `value` can be any of Flt / Str / MPInt / MPFlt")
+// Number of limbs used by the significand of a value of precision `prec` in the MPFR storage.
+static inline size_t fltLimbCount(mpfr_prec_t prec)
 {
-    EXPECT4(VarFlt, VarStr, VarMPInt, VarMPFlt, args[1], "initial value");
-    if(args[1]->is<VarFlt>()) { return vm.makeVar<VarMPFlt>(loc, as<VarFlt>(args[1])->getVal()); }
-    if(args[1]->is<VarStr>()) {
-        return vm.makeVar<VarMPFlt>(loc, as<VarStr>(args[1])->getVal().c_str());
-    }
-    if(args[1]->is<VarMPInt>()) {
-        return vm.makeVar<VarMPFlt>(loc, as<VarMPInt>(args[1])->getPtr());
-    }
-    return vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[1])->getSrcPtr());
+    return (mpfr_custom_get_size(prec) + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t);
 }
 
-FERAL_FUNC(mpFltCopy, 1, false,
-           "  var.fn() -> MPFlt\n"
-           "Creates a new instance of `var` and returns it.")
+// Points each of `vals` to its significand in `limbs`, after `limbs` has been reallocated.
+static void moveFltVals(Vector<mp_limb_t> &limbs, Vector<__mpfr_struct> &vals, mpfr_prec_t prec)
 {
-    return vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getSrcPtr());
+    size_t count = fltLimbCount(prec);
+    for(size_t i = 0; i < vals.size(); ++i) mpfr_custom_move(&vals[i], limbs.data() + i * count);
 }
 
-#define ARITHF_FUNC(fn, name, namez)                                                       \
-    FERAL_FUNC(mpFlt##fn, 1, false,                                                        \
-               "  var.fn(other) -> MPFlt\n"                                                \
-               "Applies arithmetic-" STRINGIFY(                                            \
-                   name) " on `var` and `other` and returns a new MPFlt with the result.") \
-    {                                                                                      \
-        EXPECT2(VarMPInt, VarMPFlt, args[1], "big float " STRINGIFY(name));                \
-        if(args[1]->is<VarMPInt>()) {                                                      \
-            VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());    \
-            mpfr_##namez(res->getPtr(), res->getSrcPtr(), as<VarMPInt>(args[1])->getPtr(), \
-                         mpfr_get_default_rounding_mode());                                \
-            return res;                                                                    \
-        }                                                                                  \
-        VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());        \
-        mpfr_##name(res->getPtr(), res->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),   \
-                    mpfr_get_default_rounding_mode());                                     \
-        return res;                                                                        \
+// Writes `val`, rounded to 53 bits, to `res` if that can be stored in a double as is - which is
+// the case for zeros, infinities, NaNs, and values in the range of normal doubles.
+static bool fltToDouble(mpfr_srcptr val, double &res)
+{
+    if(!mpfr_regular_p(val)) {
+        res = mpfr_get_d(val, MPFR_RNDN);
+        return true;
     }
+    // Both MPFR and <cfloat> define the exponent for a significand in [0.5, 1).
+    mpfr_exp_t exp = mpfr_get_exp(val);
+    if(exp < DBL_MIN_EXP || exp > DBL_MAX_EXP) return false;
+    res = mpfr_get_d(val, mpfr_get_default_rounding_mode());
+    return std::isnormal(res);
+}
 
-#define ARITHF_ASSN_FUNC(fn, name, namez)                                                     \
-    FERAL_FUNC(mpFltAssn##fn, 1, false,                                                       \
-               "  var.fn(other) -> var\n"                                                     \
-               "Applies arithmetic-" STRINGIFY(                                               \
-                   name) " on `var` with `other` and returns the updated `var`.")             \
-    {                                                                                         \
-        EXPECT_NO_CONST(args[0], "var");                                                      \
-        EXPECT2(VarMPInt, VarMPFlt, args[1], "big float " STRINGIFY(name) "-assn");           \
-        if(args[1]->is<VarMPInt>()) {                                                         \
-            mpfr_##namez(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), \
-                         as<VarMPInt>(args[1])->getPtr(), mpfr_get_default_rounding_mode());  \
-            return args[0];                                                                   \
-        }                                                                                     \
-        mpfr_##name(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(),      \
-                    as<VarMPFlt>(args[1])->getSrcPtr(), mpfr_get_default_rounding_mode());    \
-        return args[0];                                                                       \
-    }
+VarMPFltArray::VarMPFltArray(ModuleLoc loc, mpfr_prec_t prec)
+    : Var(loc, 0), prec(prec), isDbl(prec == 53)
+{}
+VarMPFltArray::VarMPFltArray(ModuleLoc loc, VarMPFltArray *from)
+    : Var(loc, 0), dbls(from->dbls), limbs(from->limbs), vals(from->vals), prec(from->prec),
+      isDbl(from->isDbl)
+{
+    moveFltVals(limbs, vals, prec);
+}
 
-#define LOGICF_FUNC(fn, name, checksym)                                                         \
-    FERAL_FUNC(mpFlt##fn, 1, false,                                                             \
-               "  var.fn(other) -> Bool\n"                                                      \
-               "Applies logical '" STRINGIFY(                                                   \
-                   name) "' between `var` and `other` and returns the resulting Bool.")         \
-    {                                                                                           \
-        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1],                                    \
-                "big float logical " STRINGIFY(name));                                          \
-        if(args[1]->is<VarInt>()) {                                                             \
-            return mpfr_cmp_si(as<VarMPFlt>(args[0])->getPtr(), as<VarInt>(args[1])->getVal())  \
-                           checksym 0                                                           \
-                       ? vm.getTrue()                                                           \
-                       : vm.getFalse();                                                         \
-        } else if(args[1]->is<VarFlt>()) {                                                      \
-            return mpfr_cmp_ld(as<VarMPFlt>(args[0])->getPtr(), as<VarFlt>(args[1])->getVal())  \
-                           checksym 0                                                           \
-                       ? vm.getTrue()                                                           \
-                       : vm.getFalse();                                                         \
-        } else if(args[1]->is<VarMPInt>()) {                                                    \
-            return mpfr_cmp_z(as<VarMPFlt>(args[0])->getSrcPtr(),                               \
-                              as<VarMPInt>(args[1])->getSrcPtr()) checksym 0                    \
-                       ? vm.getTrue()                                                           \
-                       : vm.getFalse();                                                         \
-        }                                                                                       \
-        return mpfr_cmp(as<VarMPFlt>(args[0])->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr()) \
-                       checksym 0                                                               \
-                   ? vm.getTrue()                                                               \
-                   : vm.getFalse();                                                             \
+void VarMPFltArray::grow(size_t count)
+{
+    size_t limbCount = fltLimbCount(prec);
+    size_t oldCount  = vals.size();
+    mp_limb_t *old   = limbs.data();
+    limbs.resize((oldCount + count) * limbCount);
+    if(limbs.data() != old) moveFltVals(limbs, vals, prec);
+    vals.resize(oldCount + count);
+    for(size_t i = oldCount; i < vals.size(); ++i) {
+        mp_limb_t *significand = limbs.data() + i * limbCount;
+        mpfr_custom_init(significand, prec);
+        mpfr_custom_init_set(&vals[i], MPFR_ZERO_KIND, 0, prec, significand);
     }
+}
 
-ARITHF_FUNC(Add, add, add_z)
-ARITHF_FUNC(Sub, sub, sub_z)
-ARITHF_FUNC(Mul, mul, mul_z)
-ARITHF_FUNC(Div, div, div_z)
-
-ARITHF_ASSN_FUNC(Add, add, add_z)
-ARITHF_ASSN_FUNC(Sub, sub, sub_z)
-ARITHF_ASSN_FUNC(Mul, mul, mul_z)
-ARITHF_ASSN_FUNC(Div, div, div_z)
-
-LOGICF_FUNC(LT, lt, <)
-LOGICF_FUNC(GT, gt, >)
-LOGICF_FUNC(LE, le, <=)
-LOGICF_FUNC(GE, ge, >=)
-
-FERAL_FUNC(mpFltEQ, 1, false,
-           "  var.fn(other) -> Bool\n"
-           "Returns `true` if `var` and `other` are equal.")
+void VarMPFltArray::toMPFR()
 {
-    if(!args[1]->is<VarMPFlt>()) return vm.getFalse();
-    return mpfr_cmp(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[1])->getPtr()) == 0
-               ? vm.getTrue()
-               : vm.getFalse();
+    if(!isDbl) return;
+    Vector<double> old;
+    old.swap(dbls);
+    isDbl = false;
+    grow(old.size());
+    for(size_t i = 0; i < old.size(); ++i) mpfr_set_d(&vals[i], old[i], MPFR_RNDN);
 }
 
-FERAL_FUNC(mpFltNE, 1, false,
-           "  var.fn(other) -> Bool\n"
-           "Returns `true` if `var` and `other` are not equal.")
+void VarMPFltArray::copyTo(Vector<mp_limb_t> &outLimbs, Vector<__mpfr_struct> &outVals)
 {
-    if(!args[1]->is<VarMPFlt>()) return vm.getTrue();
-    return mpfr_cmp(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[1])->getPtr()) != 0
-               ? vm.getTrue()
-               : vm.getFalse();
+    if(!isDbl) {
+        outLimbs = limbs;
+        outVals  = vals;
+        moveFltVals(outLimbs, outVals, prec);
+        return;
+    }
+    size_t limbCount = fltLimbCount(prec);
+    outLimbs.resize(dbls.size() * limbCount);
+    outVals.resize(dbls.size());
+    for(size_t i = 0; i < dbls.size(); ++i) {
+        mp_limb_t *significand = outLimbs.data() + i * limbCount;
+        mpfr_custom_init(significand, prec);
+        mpfr_custom_init_set(&outVals[i], MPFR_ZERO_KIND, 0, prec, significand);
+        mpfr_set_d(&outVals[i], dbls[i], MPFR_RNDN);
+    }
 }
 
-FERAL_FUNC(mpFltPreInc, 0, false,
-           "  var.fn() -> var\n"
-           "Applies pre-increment on `var` and returns `var` itself.")
+void VarMPFltArray::addZeros(size_t count)
 {
-    mpfr_add_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
-                mpfr_get_default_rounding_mode());
-    return args[0];
+    if(isDbl) dbls.resize(dbls.size() + count, 0.0);
+    else grow(count);
 }
 
-FERAL_FUNC(mpFltPostInc, 0, false,
-           "  var.fn() -> MPFlt\n"
-           "Applies post-increment on `var` and returns a new MPFlt with `var` - 1 as the result.")
+void VarMPFltArray::push(mpfr_srcptr val)
 {
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());
-    mpfr_add_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
-                mpfr_get_default_rounding_mode());
-    return res;
+    if(isDbl) {
+        double d;
+        if(fltToDouble(val, d)) {
+            dbls.push_back(d);
+            return;
+        }
+        toMPFR();
+    }
+    grow(1);
+    mpfr_set(&vals.back(), val, mpfr_get_default_rounding_mode());
 }
 
-FERAL_FUNC(mpFltPreDec, 0, false,
-           "  var.fn() -> var\n"
-           "Applies pre-decrement on `var` and returns `var` itself.")
+void VarMPFltArray::set(size_t idx, mpfr_srcptr val)
 {
-    mpfr_sub_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
-                mpfr_get_default_rounding_mode());
-    return args[0];
+    if(isDbl) {
+        if(fltToDouble(val, dbls[idx])) return;
+        toMPFR();
+    }
+    mpfr_set(&vals[idx], val, mpfr_get_default_rounding_mode());
 }
 
-FERAL_FUNC(mpFltPostDec, 0, false,
-           "  var.fn() -> MPFlt\n"
-           "Applies post-decrement on `var` and returns a new MPFlt with `var` + 1 as the result.")
+mpfr_srcptr VarMPFltArray::get(size_t idx, mpfr_ptr scratch)
 {
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());
-    mpfr_sub_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
-                mpfr_get_default_rounding_mode());
-    return res;
+    if(!isDbl) return &vals[idx];
+    mpfr_set_d(scratch, dbls[idx], MPFR_RNDN);
+    return scratch;
 }
 
-FERAL_FUNC(mpFltUSub, 0, false,
-           "  var.fn() -> MPFlt\n"
-           "Returns the negative equivalent of `var` as a new MPFlt.")
+bool VarMPFltArray::onSet(VirtualMachine &vm, Var *from)
 {
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());
-    mpfr_neg(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), mpfr_get_default_rounding_mode());
-    return res;
+    VarMPFltArray *f = as<VarMPFltArray>(from);
+    dbls             = f->dbls;
+    limbs            = f->limbs;
+    vals             = f->vals;
+    prec             = f->prec;
+    isDbl            = f->isDbl;
+    moveFltVals(limbs, vals, prec);
+    return true;
 }
 
-FERAL_FUNC(mpFltRound, 0, false,
-           "  var.fn() -> MPInt\n"
-           "Rounds `var` to the closest whole number and returns it as a new MPInt.")
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// VarRandState //////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Modulus size (in bits) of the LC algorithm - the largest one that GMP has parameters for.
+static constexpr mp_bitcnt_t RAND_LC_SIZE = 128;
+// Number of random bits taken from the parent state to seed a split state.
+static constexpr mp_bitcnt_t RAND_SPLIT_SEED_BITS = 256;
+
+// Each thread gets its own default state, which is initialized on first use.
+// Until seeded, the default states of all threads produce the same numbers.
+// The thread locals of a translation unit are constructed together, so the state itself is
+// initialized lazily to not allocate on every thread which touches any of them.
+struct DefaultRandState
+{
+    gmp_randstate_t state;
+    bool initialized = false;
+
+    ~DefaultRandState() { clear(); }
+
+    __gmp_randstate_struct *get()
+    {
+        if(!initialized) {
+            gmp_randinit_mt(state);
+            initialized = true;
+        }
+        return state;
+    }
+    void clear()
+    {
+        if(!initialized) return;
+        gmp_randclear(state);
+        initialized = false;
+    }
+};
+static thread_local DefaultRandState defaultRandState;
+
+__gmp_randstate_struct *getDefaultRandState() { return defaultRandState.get(); }
+
+void randInit(gmp_randstate_t state, VarRandState::Algo algo)
+{
+    if(algo == VarRandState::Algo::LC) gmp_randinit_lc_2exp_size(state, RAND_LC_SIZE);
+    else gmp_randinit_mt(state);
+}
+
+void randSplit(__gmp_randstate_struct *child, __gmp_randstate_struct *parent)
+{
+    mpz_t seed;
+    mpz_init(seed);
+    mpz_urandomb(seed, parent, RAND_SPLIT_SEED_BITS);
+    gmp_randseed(child, seed);
+    mpz_clear(seed);
+}
+
+VarRandState::VarRandState(ModuleLoc loc, Algo algo) : Var(loc, 0), algo(algo)
+{
+    randInit(state, algo);
+}
+VarRandState::VarRandState(ModuleLoc loc, VarRandState *from) : Var(loc, 0), algo(from->algo)
+{
+    gmp_randinit_set(state, from->state);
+}
+VarRandState::~VarRandState() { gmp_randclear(state); }
+
+bool VarRandState::onSet(VirtualMachine &vm, Var *from)
+{
+    VarRandState *f = as<VarRandState>(from);
+    gmp_randclear(state);
+    gmp_randinit_set(state, f->state);
+    algo = f->algo;
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////// VarMPExpr ///////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline size_t exprDepth(Var *var)
+{
+    return var && var->is<VarMPExpr>() ? as<VarMPExpr>(var)->getDepth() : 0;
+}
+
+VarMPExpr::VarMPExpr(ModuleLoc loc, VirtualMachine &vm, Kind kind, Op op, Var *lhs, Var *rhs)
+    : Var(loc, 0), vm(&vm), lhs(lhs), rhs(rhs),
+      depth(1 + std::max(exprDepth(lhs), exprDepth(rhs))), kind(kind), op(op)
+{
+    vm.incVarRef(lhs);
+    if(rhs) vm.incVarRef(rhs);
+}
+VarMPExpr::~VarMPExpr()
+{
+    vm->decVarRef(lhs);
+    if(rhs) vm->decVarRef(rhs);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////// VarMPWriter / VarMPReader ////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+VarMPWriter::VarMPWriter(ModuleLoc loc, FILE *file) : Var(loc, 0), file(file) {}
+VarMPWriter::~VarMPWriter() { close(); }
+
+bool VarMPWriter::close()
+{
+    if(!file) return true;
+    bool ok = fclose(file) == 0;
+    file    = nullptr;
+    return ok;
+}
+
+VarMPReader::VarMPReader(ModuleLoc loc, FILE *file) : Var(loc, 0), file(file) {}
+VarMPReader::~VarMPReader() { close(); }
+
+void VarMPReader::close()
+{
+    if(!file) return;
+    fclose(file);
+    file = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// VarMPIntStore / VarMPIntStoreWriter ///////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Identifies MPIntStore files. It is written last (along with the rest of the header), so that
+// files which were not completely written are rejected.
+static constexpr char INT_STORE_MAGIC[8] = {'F', 'E', 'R', 'M', 'P', 'I', 'S', '1'};
+// Written in the byte order of the host, to detect files written by hosts with another one.
+static constexpr uint32_t INT_STORE_BYTE_ORDER = 0x01020304;
+
+VarMPIntStore::VarMPIntStore(ModuleLoc loc, void *data, size_t dataSize)
+    : Var(loc, 0), data(data), dataSize(dataSize)
+{
+    const IntStoreHeader *header = (const IntStoreHeader *)data;
+    limbs                        = (const mp_limb_t *)(header + 1);
+    index                        = (const IntStoreElem *)(limbs + header->limbCount);
+    count                        = header->count;
+    limbCount                    = header->limbCount;
+}
+VarMPIntStore::~VarMPIntStore() { munmap(data, dataSize); }
+
+bool VarMPIntStore::get(size_t idx, const mp_limb_t *&elemLimbs, mp_size_t &elemSize)
+{
+    const IntStoreElem &e = index[idx];
+    uint64_t size         = e.size < 0 ? -(uint64_t)e.size : e.size;
+    if(e.offset > limbCount || size > limbCount - e.offset) return false;
+    elemLimbs = limbs + e.offset;
+    elemSize  = e.size;
+    return true;
+}
+
+VarMPIntStoreWriter::VarMPIntStoreWriter(ModuleLoc loc, FILE *file)
+    : Var(loc, 0), file(file), limbCount(0)
+{}
+VarMPIntStoreWriter::~VarMPIntStoreWriter()
+{
+    // Left without a header, so that the incomplete file is never used.
+    if(file) fclose(file);
+}
+
+bool VarMPIntStoreWriter::push(mpz_srcptr val)
+{
+    size_t size = mpz_size(val);
+    if(size > 0 && fwrite(mpz_limbs_read(val), sizeof(mp_limb_t), size, file) != size) {
+        return false;
+    }
+    index.push_back({limbCount, mpz_sgn(val) < 0 ? -(int64_t)size : (int64_t)size});
+    limbCount += size;
+    return true;
+}
+
+bool VarMPIntStoreWriter::close()
+{
+    if(!file) return true;
+    IntStoreHeader header;
+    memcpy(header.magic, INT_STORE_MAGIC, sizeof(header.magic));
+    header.limbBytes = sizeof(mp_limb_t);
+    header.byteOrder = INT_STORE_BYTE_ORDER;
+    header.count     = index.size();
+    header.limbCount = limbCount;
+    bool ok = fwrite(index.data(), sizeof(IntStoreElem), index.size(), file) == index.size() &&
+              fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok      = fclose(file) == 0 && ok;
+    file    = nullptr;
+    index.clear();
+    index.shrink_to_fit();
+    return ok;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// VarMPModContext /////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Odd moduli of up to this many limbs use the Montgomery form - REDC costs about as much as a
+// schoolbook division, so for larger moduli GMP's subquadratic division is faster.
+static constexpr size_t MOD_MONTGOMERY_LIMBS = 64;
+
+VarMPModContext::VarMPModContext(ModuleLoc loc, mpz_srcptr _mod)
+    : Var(loc, 0), modInv(0), limbCount(mpz_size(_mod)),
+      isMontgomeryVal(mpz_odd_p(_mod) && mpz_size(_mod) <= MOD_MONTGOMERY_LIMBS)
+{
+    mpz_init_set(mod, _mod);
+    mpz_init(rSqr);
+    if(!isMontgomeryVal) return;
+    mpz_setbit(rSqr, 2 * GMP_NUMB_BITS * limbCount);
+    mpz_mod(rSqr, rSqr, mod);
+    // Newton iteration for the inverse of the lowest limb - each step doubles the number of
+    // correct bits, starting from 3 (every odd number is its own inverse modulo 8).
+    mp_limb_t low = mpz_getlimbn(mod, 0), inv = low;
+    for(int i = 0; i < 5; ++i) inv *= 2 - low * inv;
+    modInv = -inv;
+}
+VarMPModContext::~VarMPModContext()
+{
+    mpz_clear(mod);
+    mpz_clear(rSqr);
+}
+
+void VarMPModContext::getLimbs(mp_limb_t *limbs, mpz_srcptr val)
+{
+    size_t size = mpz_size(val);
+    if(size > 0) memcpy(limbs, mpz_limbs_read(val), size * sizeof(mp_limb_t));
+    memset(limbs + size, 0, (limbCount - size) * sizeof(mp_limb_t));
+}
+
+void VarMPModContext::redc(mpz_ptr r, mp_limb_t *t)
+{
+    const mp_limb_t *modLimbs = mpz_limbs_read(mod);
+    // Each step clears t[i] by adding a multiple of `mod`, whose carry (into t[i + limbCount]) is
+    // kept in t[i] and added in one go at the end.
+    for(size_t i = 0; i < limbCount; ++i) {
+        t[i] = mpn_addmul_1(t + i, modLimbs, limbCount, t[i] * modInv);
+    }
+    mp_limb_t *res = mpz_limbs_write(r, limbCount);
+    // The result is below 2 * `mod`, so one subtraction is enough.
+    if(mpn_add_n(res, t + limbCount, t, limbCount) || mpn_cmp(res, modLimbs, limbCount) >= 0) {
+        mpn_sub_n(res, res, modLimbs, limbCount);
+    }
+    mpz_limbs_finish(r, limbCount);
+}
+
+void VarMPModContext::toResidue(mpz_ptr r, mpz_srcptr val)
+{
+    mpz_mod(r, val, mod);
+    // x * R = REDC(x * R ^ 2)
+    if(isMontgomeryVal) mul(r, r, rSqr);
+}
+
+void VarMPModContext::fromResidue(mpz_ptr r, mpz_srcptr a)
+{
+    if(!isMontgomeryVal) {
+        mpz_set(r, a);
+        return;
+    }
+    mp_limb_t t[2 * MOD_MONTGOMERY_LIMBS];
+    getLimbs(t, a);
+    memset(t + limbCount, 0, limbCount * sizeof(mp_limb_t));
+    redc(r, t);
+}
+
+void VarMPModContext::add(mpz_ptr r, mpz_srcptr a, mpz_srcptr b)
+{
+    mpz_add(r, a, b);
+    if(mpz_cmp(r, mod) >= 0) mpz_sub(r, r, mod);
+}
+
+void VarMPModContext::sub(mpz_ptr r, mpz_srcptr a, mpz_srcptr b)
+{
+    mpz_sub(r, a, b);
+    if(mpz_sgn(r) < 0) mpz_add(r, r, mod);
+}
+
+void VarMPModContext::mul(mpz_ptr r, mpz_srcptr a, mpz_srcptr b)
+{
+    if(!isMontgomeryVal) {
+        mpz_mul(r, a, b);
+        mpz_mod(r, r, mod);
+        return;
+    }
+    // (a * R) * (b * R) * R ^ -1 = a * b * R
+    mp_limb_t t[2 * MOD_MONTGOMERY_LIMBS], aLimbs[MOD_MONTGOMERY_LIMBS];
+    getLimbs(aLimbs, a);
+    if(a == b) {
+        mpn_sqr(t, aLimbs, limbCount);
+    } else {
+        mp_limb_t bLimbs[MOD_MONTGOMERY_LIMBS];
+        getLimbs(bLimbs, b);
+        mpn_mul_n(t, aLimbs, bLimbs, limbCount);
+    }
+    redc(r, t);
+}
+
+bool VarMPModContext::pow(mpz_ptr r, mpz_srcptr a, mpz_srcptr exp)
+{
+    // mpz_powm() does its own Montgomery multiplications (with a sliding window), so the residue
+    // is converted to a value and back around it.
+    mpz_t val, absExp;
+    pool.initInt(val);
+    fromResidue(val, a);
+    if(mpz_sgn(exp) < 0 && !mpz_invert(val, val, mod)) {
+        pool.clearInt(val);
+        return false;
+    }
+    mpz_roinit_n(absExp, mpz_limbs_read(exp), mpz_size(exp));
+    mpz_powm(val, val, absExp, mod);
+    toResidue(r, val);
+    pool.clearInt(val);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// VarMPFuture ///////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+VarMPFuture::VarMPFuture(ModuleLoc loc, std::shared_ptr<Op> _op) : Var(loc, 0), op(std::move(_op))
+{
+    // The task holds a reference of its own to the operation.
+    workerPool.submit([op = op]() {
+        {
+            std::lock_guard<std::mutex> lock(op->mtx);
+            if(op->status == Status::Cancelled) return;
+            op->status = Status::Running;
+        }
+        op->run();
+        {
+            std::lock_guard<std::mutex> lock(op->mtx);
+            if(op->status == Status::Cancelled) return;
+            op->status = Status::Done;
+        }
+        op->doneCond.notify_all();
+    });
+}
+VarMPFuture::~VarMPFuture() { cancel(); }
+
+bool VarMPFuture::isReady()
+{
+    std::lock_guard<std::mutex> lock(op->mtx);
+    return op->status == Status::Done || op->status == Status::Cancelled;
+}
+
+bool VarMPFuture::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(op->mtx);
+        if(op->status == Status::Done) return false;
+        op->status = Status::Cancelled;
+    }
+    op->doneCond.notify_all();
+    return true;
+}
+
+VarMPFuture::Status VarMPFuture::wait(int64_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(op->mtx);
+    auto isFinished = [this]() {
+        return op->status == Status::Done || op->status == Status::Cancelled;
+    };
+    if(timeoutMs < 0) op->doneCond.wait(lock, isFinished);
+    else op->doneCond.wait_for(lock, std::chrono::milliseconds(timeoutMs), isFinished);
+    return op->status;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////// Functions ////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fetches the precision (in bits) from the VarInt `arg` into `prec`.
+// If `allowZero` is set, 0 (which means default precision) is also accepted.
+static bool getPrecArg(VirtualMachine &vm, ModuleLoc loc, Var *arg, bool allowZero,
+                       mpfr_prec_t &prec)
+{
+    int64_t bits = as<VarInt>(arg)->getVal();
+    if((bits == 0 && allowZero) || (bits >= MPFR_PREC_MIN && bits <= MPFR_PREC_MAX)) {
+        prec = bits;
+        return true;
+    }
+    vm.fail(loc, "precision must be between ", MPFR_PREC_MIN, " and ", MPFR_PREC_MAX,
+            " bits, found: ", bits);
+    return false;
+}
+
+// Fetches the value of the non-negative Int / MPInt `arg`, which must fit in an unsigned long, into
+// `val`.
+static bool getUiArg(VirtualMachine &vm, ModuleLoc loc, Var *arg, const char *name,
+                     unsigned long &val)
+{
+    if(arg->is<VarInt>() && as<VarInt>(arg)->getVal() >= 0) {
+        val = as<VarInt>(arg)->getVal();
+        return true;
+    }
+    if(arg->is<VarMPInt>() && mpz_fits_ulong_p(as<VarMPInt>(arg)->getSrcPtr())) {
+        val = mpz_get_ui(as<VarMPInt>(arg)->getSrcPtr());
+        return true;
+    }
+    vm.fail(loc, "expected a non-negative Int / MPInt of up to 64 bits for ", name,
+            ", found: ", vm.getTypeName(arg));
+    return false;
+}
+
+// Arithmetic operations which the MPInt, MPFlt and MPComplex operators have in common.
+enum class ArithOp
+{
+    None, // no MPComplex equivalent (like mod)
+    Add,
+    Sub,
+    Mul,
+    Div,
+};
+
+// Rounds `val` to an integer with the MPFR rounding mode `rnd`.
+static double roundFlt(double val, mpfr_rnd_t rnd)
+{
+    switch(rnd) {
+    case MPFR_RNDZ: return std::trunc(val);
+    case MPFR_RNDU: return std::ceil(val);
+    case MPFR_RNDD: return std::floor(val);
+    case MPFR_RNDA: return val < 0 ? std::floor(val) : std::ceil(val);
+    default: break;
+    }
+    // Halfway cases go to the even neighbour - half of a double is exact.
+    if(std::fabs(val - std::trunc(val)) == 0.5) return 2 * std::round(val / 2);
+    return std::round(val);
+}
+
+// Integer value of the Int / Flt / MPInt / MPFlt operand of an MPInt operation - Flt and MPFlt
+// values are rounded to an integer with the default rounding mode (NaN and infinities become 0,
+// as with mpfr_get_z()).
+// Values which fit in an int64_t are kept inline, so that they can take the inline paths, and only
+// larger Flt / MPFlt values are ever converted - to a scratch value from the pool.
+class IntOperand
+{
+    mpz_t scratch;
+    mpz_t view;
+    mpz_srcptr val;
+    mp_limb_t viewLimb;
+    int64_t small;
+    bool isSmallVal;
+    bool isScratchInit;
+
+    inline mpz_ptr getScratch()
+    {
+        pool.initInt(scratch);
+        isScratchInit = true;
+        isSmallVal    = false;
+        val           = scratch;
+        return scratch;
+    }
+
+public:
+    IntOperand(Var *arg) : val(nullptr), small(0), isSmallVal(true), isScratchInit(false)
+    {
+        if(arg->is<VarInt>()) {
+            small = as<VarInt>(arg)->getVal();
+        } else if(arg->is<VarMPInt>()) {
+            VarMPInt *v = as<VarMPInt>(arg);
+            if(v->isSmall()) {
+                small = v->getSmall();
+            } else {
+                val        = v->getSrcPtr();
+                isSmallVal = false;
+            }
+        } else if(arg->is<VarFlt>()) {
+            double d = roundFlt(as<VarFlt>(arg)->getVal(), mpfr_get_default_rounding_mode());
+            if(d >= -0x1p63 && d < 0x1p63) small = d;
+            else if(std::isfinite(d)) mpz_set_d(getScratch(), d);
+        } else {
+            mpfr_srcptr f  = as<VarMPFlt>(arg)->getSrcPtr();
+            mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+            if(mpfr_fits_slong_p(f, rnd)) small = mpfr_get_si(f, rnd);
+            else mpfr_get_z(getScratch(), f, rnd);
+        }
+    }
+    ~IntOperand()
+    {
+        if(isScratchInit) pool.clearInt(scratch);
+    }
+
+    inline bool isSmall() { return isSmallVal; }
+    inline int64_t getSmall() { return small; }
+
+    // Returns the value truncated to a long / unsigned long, like mpz_get_si() / mpz_get_ui().
+    inline long getSi() { return isSmallVal ? small : mpz_get_si(val); }
+    inline unsigned long getUi()
+    {
+        if(!isSmallVal) return mpz_get_ui(val);
+        return small < 0 ? -(uint64_t)small : small;
+    }
+    inline bool fitsUi() { return isSmallVal ? small >= 0 : mpz_fits_ulong_p(val); }
+    // Returns the value for GMP functions - a read-only view for inline values.
+    inline mpz_srcptr get()
+    {
+        if(!isSmallVal) return val;
+        viewLimb = small < 0 ? -(uint64_t)small : (uint64_t)small;
+        return mpz_roinit_n(view, &viewLimb, small < 0 ? -1 : small > 0);
+    }
+};
+
+// Calls the `prefix`<op>`suffix` function (like mpfr_add_si) for the ArithOp `op`.
+#define ARITH_CALL(op, prefix, suffix, ...)                     \
+    switch(op) {                                                \
+    case ArithOp::Add: prefix##add##suffix(__VA_ARGS__); break; \
+    case ArithOp::Sub: prefix##sub##suffix(__VA_ARGS__); break; \
+    case ArithOp::Mul: prefix##mul##suffix(__VA_ARGS__); break; \
+    case ArithOp::Div: prefix##div##suffix(__VA_ARGS__); break; \
+    default: break;                                             \
+    }
+
+// Applies `op` between `lhs` and the Int / Flt / MPInt / MPFlt `rhs` into `res`, with the MPFR
+// function for the type of `rhs`.
+static void fltArith(mpfr_ptr res, mpfr_srcptr lhs, Var *rhs, ArithOp op)
+{
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    if(rhs->is<VarMPFlt>()) {
+        ARITH_CALL(op, mpfr_, , res, lhs, as<VarMPFlt>(rhs)->getSrcPtr(), rnd);
+    } else if(rhs->is<VarFlt>()) {
+        ARITH_CALL(op, mpfr_, _d, res, lhs, as<VarFlt>(rhs)->getVal(), rnd);
+    } else if(rhs->is<VarInt>()) {
+        ARITH_CALL(op, mpfr_, _si, res, lhs, as<VarInt>(rhs)->getVal(), rnd);
+    } else if(as<VarMPInt>(rhs)->isSmall()) {
+        ARITH_CALL(op, mpfr_, _si, res, lhs, as<VarMPInt>(rhs)->getSmall(), rnd);
+    } else {
+        ARITH_CALL(op, mpfr_, _z, res, lhs, as<VarMPInt>(rhs)->getSrcPtr(), rnd);
+    }
+}
+
+// Applies `op` between `c` and the Int / Flt / MPInt / MPFlt / MPComplex `other` into `res` - as
+// `other` `op` `c` if `isReversed` is set (in which case `other` cannot be an MPComplex).
+static void complexArith(mpc_ptr res, mpc_srcptr c, Var *other, ArithOp op, bool isReversed)
+{
+    mpc_rnd_t rnd = mpc_get_default_rounding_mode();
+    if(other->is<VarMPComplex>()) {
+        ARITH_CALL(op, mpc_, , res, c, as<VarMPComplex>(other)->getSrcPtr(), rnd);
+        return;
+    }
+    bool isSmall = other->is<VarInt>() || (other->is<VarMPInt>() && as<VarMPInt>(other)->isSmall());
+    int64_t small = 0;
+    if(isSmall) {
+        small = other->is<VarInt>() ? as<VarInt>(other)->getVal() : as<VarMPInt>(other)->getSmall();
+    }
+    // MPC only has (unsigned) long versions of some operations - negative divisors take the MPFR
+    // path, since negating the quotient would not round it the same way.
+    if(isSmall && !isReversed && (op != ArithOp::Div || small >= 0)) {
+        switch(op) {
+        case ArithOp::Add: mpc_add_si(res, c, small, rnd); break;
+        case ArithOp::Sub:
+            if(small >= 0) mpc_sub_ui(res, c, small, rnd);
+            else mpc_add_ui(res, c, -(uint64_t)small, rnd);
+            break;
+        case ArithOp::Mul: mpc_mul_si(res, c, small, rnd); break;
+        case ArithOp::Div: mpc_div_ui(res, c, small, rnd); break;
+        default: break;
+        }
+        return;
+    }
+    // Everything else goes through an (exact) MPFR value - on the stack for Flt values.
+    MPFR_DECL_INIT(dbl, DBL_MANT_DIG);
+    mpfr_t tmp;
+    mpfr_srcptr val;
+    bool isTmp = false;
+    if(other->is<VarMPFlt>()) {
+        val = as<VarMPFlt>(other)->getSrcPtr();
+    } else if(other->is<VarFlt>()) {
+        mpfr_set_d(dbl, as<VarFlt>(other)->getVal(), MPFR_RNDN);
+        val = dbl;
+    } else {
+        mp_limb_t limb = small < 0 ? -(uint64_t)small : (uint64_t)small;
+        mpz_t view;
+        mpz_srcptr z = other->is<VarMPInt>() ? as<VarMPInt>(other)->getSrcPtr()
+                                            : mpz_roinit_n(view, &limb, small < 0 ? -1 : small > 0);
+        pool.initFlt(tmp, std::max<mpfr_prec_t>(mpz_sizeinbase(z, 2), MPFR_PREC_MIN));
+        mpfr_set_z(tmp, z, MPFR_RNDN);
+        val   = tmp;
+        isTmp = true;
+    }
+    if(op == ArithOp::Sub && isReversed) mpc_fr_sub(res, val, c, rnd);
+    else if(op == ArithOp::Div && isReversed) mpc_fr_div(res, val, c, rnd);
+    else ARITH_CALL(op, mpc_, _fr, res, c, val, rnd);
+    if(isTmp) pool.clearFlt(tmp);
+}
+
+// Applies `op` between the MPInt / MPFlt `lhs` and the MPComplex `rhs`, and returns a new
+// MPComplex with the result.
+static Var *complexArithRev(VirtualMachine &vm, ModuleLoc loc, Var *lhs, Var *rhs, ArithOp op)
+{
+    mpfr_prec_t prec = as<VarMPComplex>(rhs)->getPrec();
+    if(lhs->is<VarMPFlt>()) prec = resultPrec(as<VarMPFlt>(lhs)->getPrec(), prec);
+    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, prec);
+    complexArith(res->getPtr(), as<VarMPComplex>(rhs)->getSrcPtr(), lhs, op, true);
+    return res;
+}
+
+// Compares `lhs` with the Int / Flt / MPInt / MPFlt `rhs` into `cmp` (which has the sign of
+// `lhs` - `rhs`), returning false if they are unordered (`rhs` is a NaN).
+static bool intCmp(VarMPInt *lhs, Var *rhs, int &cmp)
+{
+    if(rhs->is<VarInt>() || (rhs->is<VarMPInt>() && as<VarMPInt>(rhs)->isSmall())) {
+        int64_t val = rhs->is<VarInt>() ? as<VarInt>(rhs)->getVal() : as<VarMPInt>(rhs)->getSmall();
+        if(lhs->isSmall()) cmp = (lhs->getSmall() > val) - (lhs->getSmall() < val);
+        else cmp = mpz_cmp_si(lhs->getSrcPtr(), val);
+    } else if(rhs->is<VarMPInt>()) {
+        cmp = mpz_cmp(lhs->getSrcPtr(), as<VarMPInt>(rhs)->getSrcPtr());
+    } else if(rhs->is<VarFlt>()) {
+        if(std::isnan(as<VarFlt>(rhs)->getVal())) return false;
+        cmp = mpz_cmp_d(lhs->getSrcPtr(), as<VarFlt>(rhs)->getVal());
+    } else {
+        if(mpfr_nan_p(as<VarMPFlt>(rhs)->getSrcPtr())) return false;
+        cmp = -mpfr_cmp_z(as<VarMPFlt>(rhs)->getSrcPtr(), lhs->getSrcPtr());
+    }
+    return true;
+}
+
+// Same as intCmp(), for the MPFR value `lhs` - which is unordered if either is a NaN.
+static bool fltCmp(mpfr_srcptr lhs, Var *rhs, int &cmp)
+{
+    if(mpfr_nan_p(lhs)) return false;
+    if(rhs->is<VarInt>()) {
+        cmp = mpfr_cmp_si(lhs, as<VarInt>(rhs)->getVal());
+    } else if(rhs->is<VarMPInt>()) {
+        VarMPInt *val = as<VarMPInt>(rhs);
+        cmp           = val->isSmall() ? mpfr_cmp_si(lhs, val->getSmall())
+                                       : mpfr_cmp_z(lhs, val->getSrcPtr());
+    } else if(rhs->is<VarFlt>()) {
+        if(std::isnan(as<VarFlt>(rhs)->getVal())) return false;
+        cmp = mpfr_cmp_d(lhs, as<VarFlt>(rhs)->getVal());
+    } else {
+        if(mpfr_nan_p(as<VarMPFlt>(rhs)->getSrcPtr())) return false;
+        cmp = mpfr_cmp(lhs, as<VarMPFlt>(rhs)->getSrcPtr());
+    }
+    return true;
+}
+
+FERAL_FUNC(precSetDefault, 1, false,
+           "  fn(bits) -> Nil\n"
+           "Sets the default precision (in bits) used for new MPFlt values.")
+{
+    EXPECT(VarInt, args[1], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[1], false, prec)) return nullptr;
+    mpfr_set_default_prec(prec);
+    return vm.getNil();
+}
+
+FERAL_FUNC(precGetDefault, 0, false,
+           "  fn() -> Int\n"
+           "Returns the default precision (in bits) used for new MPFlt values.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)mpfr_get_default_prec());
+}
+
+FERAL_FUNC(precSetDefaultComplex, 1, false,
+           "  fn(bits) -> Nil\n"
+           "Sets the default precision (in bits) used for new MPComplex values.")
+{
+    EXPECT(VarInt, args[1], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[1], false, prec)) return nullptr;
+    mpc_set_default_prec(prec);
+    return vm.getNil();
+}
+
+FERAL_FUNC(precGetDefaultComplex, 0, false,
+           "  fn() -> Int\n"
+           "Returns the default precision (in bits) used for new MPComplex values.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)mpc_get_default_prec());
+}
+
+FERAL_FUNC(rngSeed, 1, false,
+           "  fn(seed) -> Nil\n"
+           "Provides a `seed` number to the default random number generator of the current "
+           "thread.")
+{
+    EXPECT(VarMPInt, args[1], "seed value");
+    gmp_randseed(getDefaultRandState(), as<VarMPInt>(args[1])->getSrcPtr());
+    return vm.getNil();
+}
+
+// Returns the state of the RandState `arg`, or the default state of the thread if `arg` is nil.
+static inline __gmp_randstate_struct *getRandStateArg(Var *arg)
+{
+    return arg->is<VarRandState>() ? as<VarRandState>(arg)->getPtr() : getDefaultRandState();
+}
+
+FERAL_FUNC(poolHits, 0, false,
+           "  fn() -> Int\n"
+           "Returns the number of MP values which reused an initialized value from the pool.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)pool.getHits());
+}
+
+FERAL_FUNC(poolMisses, 0, false,
+           "  fn() -> Int\n"
+           "Returns the number of MP values which had to be initialized as the pool was empty.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)pool.getMisses());
+}
+
+FERAL_FUNC(poolClear, 0, false,
+           "  fn() -> Nil\n"
+           "Releases all the values held by the pool and resets its hit/miss counters.")
+{
+    pool.clear();
+    pool.resetStats();
+    return vm.getNil();
+}
+
+FERAL_FUNC(arenaEnabled, 0, false,
+           "  fn() -> Bool\n"
+           "Returns `true` if the arena allocator is used for the MP values.\n"
+           "The arena allocator is enabled by setting the `FERAL_MP_ARENA` environment variable "
+           "before the module is loaded.")
+{
+    return arena.isInstalled() ? vm.getTrue() : vm.getFalse();
+}
+
+FERAL_FUNC(arenaBytesInUse, 0, false,
+           "  fn() -> Int\n"
+           "Returns the number of bytes currently allocated through the arena allocator.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)arena.getBytesInUse());
+}
+
+FERAL_FUNC(arenaPeakBytes, 0, false,
+           "  fn() -> Int\n"
+           "Returns the peak number of bytes allocated through the arena allocator.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)arena.getPeakBytes());
+}
+
+FERAL_FUNC(arenaResetPeak, 0, false,
+           "  fn() -> Nil\n"
+           "Resets the peak usage of the arena allocator to its current usage.")
+{
+    arena.resetPeak();
+    return vm.getNil();
+}
+
+FERAL_FUNC(profilingEnabled, 0, false,
+           "  fn() -> Bool\n"
+           "Returns `true` if the calls to the MP functions are being profiled.\n"
+           "Profiling can also be enabled by setting the `FERAL_MP_PROFILE` environment variable "
+           "before the module is loaded.")
+{
+    return profiler.isEnabled() ? vm.getTrue() : vm.getFalse();
+}
+
+FERAL_FUNC(profilingSet, 1, false,
+           "  fn(enabled) -> Nil\n"
+           "Enables or disables the profiling of the calls to the MP functions, according to the "
+           "Bool `enabled`. The data recorded so far is kept.")
+{
+    EXPECT(VarBool, args[1], "enabled");
+    profiler.setEnabled(as<VarBool>(args[1])->getVal());
+    return vm.getNil();
+}
+
+FERAL_FUNC(profilingStats, 0, false,
+           "  fn() -> Map\n"
+           "Returns the profiling data recorded so far, as a Map with:\n"
+           "  'ops': a Map of the name of each called function (like 'MPInt.+') to a Map of its "
+           "'calls', the time spent in them in 'ns', the 'newVals' they returned, and 'limbs', a "
+           "Vec which counts the calls by the size of their largest MP operand - index 0 for no MP "
+           "operand, and index i for [2 ** (i - 1), 2 ** i) limbs (the last one including all the "
+           "larger sizes).\n"
+           "  'newVals': a Map of each type (MPInt, MPFlt, MPComplex, MPIntArray, MPFltArray, "
+           "Other) to the number of new values of it returned by the functions.")
+{
+    return profiler.getStats(vm, loc);
+}
+
+FERAL_FUNC(profilingReset, 0, false,
+           "  fn() -> Nil\n"
+           "Clears the profiling data recorded so far.")
+{
+    profiler.reset();
+    return vm.getNil();
+}
+
+FERAL_FUNC(profilingToJson, 0, false,
+           "  fn() -> Str\n"
+           "Returns the profiling data recorded so far as JSON, in the same layout as stats().")
+{
+    String res;
+    profiler.toJson(res);
+    return vm.makeVar<VarStr>(loc, std::move(res));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// Int Functions //////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+FERAL_FUNC(mpIntNewNative, 1, false,
+           "  fn(value) -> MPInt\n"
+           "Creates and returns a new MPInt with `value`.\n"
+           "Here `value` can be any of Int / Str / MPInt / MPFlt")
+{
+    EXPECT4(VarInt, VarStr, VarMPInt, VarMPFlt, args[1], "initial value");
+    if(args[1]->is<VarInt>()) { return vm.makeVar<VarMPInt>(loc, as<VarInt>(args[1])->getVal()); }
+    if(args[1]->is<VarStr>()) {
+        return vm.makeVar<VarMPInt>(loc, as<VarStr>(args[1])->getVal().c_str());
+    }
+    if(args[1]->is<VarMPInt>()) {
+        return vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[1])->getSrcPtr());
+    }
+    return vm.makeVar<VarMPInt>(loc, as<VarMPFlt>(args[1])->getSrcPtr());
+}
+
+FERAL_FUNC(mpIntCopy, 1, false,
+           "  var.fn() -> MPInt\n"
+           "Creates a new instance of `var` and returns it.")
+{
+    return vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSrcPtr());
+}
+
+// Returns true if `var` is a temporary which dies right after the current operation (the only
+// reference to it is the one held for the call), in which case its storage can be reused for the
+// result of the operation instead of creating a new Var.
+static inline bool isTemporary(Var *var) { return var->getRef() == 1; }
+
+// Returns whichever of the operands of an MPInt operation can be reused to store its result,
+// nullptr if neither can be.
+static inline VarMPInt *intReusable(Var *lhs, Var *rhs)
+{
+    if(isTemporary(lhs)) return as<VarMPInt>(lhs);
+    if(rhs && rhs->is<VarMPInt>() && isTemporary(rhs)) return as<VarMPInt>(rhs);
+    return nullptr;
+}
+static inline VarMPInt *intResult(VirtualMachine &vm, ModuleLoc loc, Var *lhs, Var *rhs)
+{
+    VarMPInt *res = intReusable(lhs, rhs);
+    return res ? res : vm.makeVar<VarMPInt>(loc, 0);
+}
+static inline VarMPInt *intResult(VirtualMachine &vm, ModuleLoc loc, Var *lhs, Var *rhs,
+                                  int64_t small)
+{
+    VarMPInt *res = intReusable(lhs, rhs);
+    if(!res) return vm.makeVar<VarMPInt>(loc, small);
+    res->setSmall(small);
+    return res;
+}
+
+// Inline value helpers - each returns false if the result cannot be computed in an int64_t,
+// in which case the caller must fall back to GMP.
+
+static inline bool smallAdd(int64_t a, int64_t b, int64_t &res)
+{
+    return !__builtin_add_overflow(a, b, &res);
+}
+static inline bool smallSub(int64_t a, int64_t b, int64_t &res)
+{
+    return !__builtin_sub_overflow(a, b, &res);
+}
+static inline bool smallMul(int64_t a, int64_t b, int64_t &res)
+{
+    return !__builtin_mul_overflow(a, b, &res);
+}
+// Same semantics as mpz_fdiv_q (which is what mpz_div is).
+static inline bool smallDiv(int64_t a, int64_t b, int64_t &res)
+{
+    if(b == 0 || (a == INT64_MIN && b == -1)) return false;
+    res = a / b;
+    if(a % b != 0 && (a < 0) != (b < 0)) --res;
+    return true;
+}
+// Same semantics as mpz_mod - the result is always non-negative.
+static inline bool smallMod(int64_t a, int64_t b, int64_t &res)
+{
+    if(b == 0) return false;
+    if(b == -1) {
+        res = 0;
+        return true;
+    }
+    res = a % b;
+    if(res < 0) res = b < 0 ? res - b : res + b;
+    return true;
+}
+static inline bool smallLShift(int64_t a, unsigned long bits, int64_t &res)
+{
+    if(a == 0) {
+        res = 0;
+        return true;
+    }
+    if(bits >= 63) return false;
+    return !__builtin_mul_overflow(a, (int64_t)1 << bits, &res);
+}
+// Same semantics as mpz_fdiv_q_2exp (which is what mpz_div_2exp is).
+static inline bool smallRShift(int64_t a, unsigned long bits, int64_t &res)
+{
+    res = bits >= 63 ? (a < 0 ? -1 : 0) : a >> bits;
+    return true;
+}
+static inline bool smallPow(int64_t base, unsigned long exp, int64_t &res)
+{
+    res = 1;
+    while(exp > 0) {
+        if(exp & 1 && __builtin_mul_overflow(res, base, &res)) return false;
+        exp >>= 1;
+        if(exp > 0 && __builtin_mul_overflow(base, base, &base)) return false;
+    }
+    return true;
+}
+
+// Multiplications with both operands of at least this many limbs are split across threads by
+// intMul() - below it, starting the threads costs more than it saves.
+static std::atomic<size_t> mulParallelLimbs(1 << 14);
+// Number of threads which those multiplications are split across - 0 means one per core.
+static std::atomic<size_t> mulThreads(0);
+
+// Multiplies the non-negative `a` and `b` (which must not overlap `r`) into `r`, split into up to
+// `threads` parts which run on the worker pool (so nested splits, or splits made from the workers
+// themselves, never start more threads than there are cores).
+// When one operand is at least twice as large as the other, it is cut into a piece per part, and
+// the (shifted) products of the pieces with the smaller operand are added up - which is no more
+// work than a single multiplication, since GMP does much the same for unbalanced operands.
+// Otherwise, the operands are split in halves (a = a1 * B + a0, b = b1 * B + b0) and multiplied
+// with the Karatsuba formula, whose three half size products are computed in parallel (and split
+// further if there are threads to spare):
+//   a * b = a1b1 * B^2 + ((a0 + a1)(b0 + b1) - a1b1 - a0b0) * B + a0b0
+// At FFT sizes, that is about 1.5 times the work of a single multiplication, done in half the time.
+static void intMulSplit(mpz_ptr r, mpz_srcptr a, mpz_srcptr b, size_t threads)
+{
+    size_t an = mpz_size(a), bn = mpz_size(b);
+    if(an < bn) {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    if(threads < 2 || bn < mulParallelLimbs.load(std::memory_order_relaxed)) {
+        mpz_mul(r, a, b);
+        return;
+    }
+    const mp_limb_t *ap = mpz_limbs_read(a);
+    if(an >= 2 * bn) {
+        size_t partLimbs = (an + std::min(threads, an / bn) - 1) / std::min(threads, an / bn);
+        size_t parts     = (an + partLimbs - 1) / partLimbs;
+        Vector<__mpz_struct> prods(parts);
+        for(auto &p : prods) mpz_init(&p);
+        auto mulPart = [&](size_t i) {
+            mpz_t part;
+            size_t offset = i * partLimbs;
+            mpz_roinit_n(part, ap + offset, std::min(partLimbs, an - offset));
+            mpz_mul(&prods[i], part, b);
+        };
+        workerPool.run(parts, parts, [&](size_t i, size_t, size_t) { mulPart(i); });
+        mpz_swap(r, &prods[0]);
+        for(size_t i = 1; i < parts; ++i) {
+            mpz_mul_2exp(&prods[i], &prods[i], i * partLimbs * GMP_NUMB_BITS);
+            mpz_add(r, r, &prods[i]);
+        }
+        for(auto &p : prods) mpz_clear(&p);
+        return;
+    }
+    // Since an < 2 * bn, both halves of b are non-empty.
+    size_t half         = an / 2;
+    bool isSqr          = a == b;
+    const mp_limb_t *bp = mpz_limbs_read(b);
+    mpz_t a0, a1, b0, b1, z0, z1, z2, aSum, bSum;
+    mpz_roinit_n(a0, ap, half);
+    mpz_roinit_n(a1, ap + half, an - half);
+    mpz_roinit_n(b0, bp, half);
+    mpz_roinit_n(b1, bp + half, bn - half);
+    mpz_inits(z0, z1, z2, aSum, bSum, NULL);
+    mpz_add(aSum, a0, a1);
+    mpz_add(bSum, b0, b1);
+    // The high and low products get a third of the threads each, and the middle one the rest -
+    // with just 2 threads, the high product runs alongside the other two instead.
+    mpz_ptr prods[3]     = {z2, z0, z1};
+    mpz_srcptr lhs[3]    = {a1, a0, aSum};
+    mpz_srcptr rhs[3]    = {isSqr ? a1 : b1, isSqr ? a0 : b0, isSqr ? aSum : bSum};
+    size_t subThreads[3] = {threads / 3, threads / 3, threads - 2 * (threads / 3)};
+    if(threads < 3) subThreads[0] = subThreads[1] = subThreads[2] = 1;
+    workerPool.run(3, std::min<size_t>(threads, 3), [&](size_t, size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i) intMulSplit(prods[i], lhs[i], rhs[i], subThreads[i]);
+    });
+    mpz_sub(z1, z1, z0);
+    mpz_sub(z1, z1, z2);
+    mpz_mul_2exp(z1, z1, half * GMP_NUMB_BITS);
+    mpz_mul_2exp(z2, z2, 2 * half * GMP_NUMB_BITS);
+    mpz_add(r, z0, z1);
+    mpz_add(r, r, z2);
+    mpz_clears(z0, z1, z2, aSum, bSum, NULL);
+}
+
+// Returns the number of threads which large multiplications are split across.
+static inline size_t getMulThreads()
+{
+    size_t threads = mulThreads.load(std::memory_order_relaxed);
+    return threads > 0 ? threads : std::thread::hardware_concurrency();
+}
+
+// Same as mpz_mul(), except that the multiplication of large operands is split across up to
+// `threads` threads.
+static void intMul(mpz_ptr r, mpz_srcptr a, mpz_srcptr b, size_t threads)
+{
+    if(threads < 2 ||
+       std::min(mpz_size(a), mpz_size(b)) < mulParallelLimbs.load(std::memory_order_relaxed))
+    {
+        mpz_mul(r, a, b);
+        return;
+    }
+    // The product goes to `res` first, since `r` may be one of the operands.
+    mpz_t absA, absB, res;
+    mpz_roinit_n(absA, mpz_limbs_read(a), mpz_size(a));
+    mpz_roinit_n(absB, mpz_limbs_read(b), mpz_size(b));
+    pool.initInt(res);
+    intMulSplit(res, absA, a == b ? absA : absB, threads);
+    if((mpz_sgn(a) < 0) != (mpz_sgn(b) < 0)) mpz_neg(res, res);
+    mpz_swap(r, res);
+    pool.clearInt(res);
+}
+
+static inline void intMul(mpz_ptr r, mpz_srcptr a, mpz_srcptr b)
+{
+    intMul(r, a, b, getMulThreads());
+}
+
+// Same as mpz_pow_ui(), except that when the result is large, it is computed by repeated squaring
+// with intMul(), so that the largest squarings are split across threads.
+static void intPowUi(mpz_ptr r, mpz_srcptr base, unsigned long exp)
+{
+    size_t threads = getMulThreads();
+    // The result has about (bits of `base`) * exp bits - its last squaring has operands of half
+    // that.
+    double resLimbs = (double)mpz_sizeinbase(base, 2) * exp / GMP_NUMB_BITS;
+    if(threads < 2 || exp < 2 || mpz_sgn(base) == 0 ||
+       resLimbs < 2.0 * mulParallelLimbs.load(std::memory_order_relaxed))
+    {
+        mpz_pow_ui(r, base, exp);
+        return;
+    }
+    mpz_t res;
+    pool.initInt(res);
+    mpz_set(res, base);
+    for(int bit = 62 - __builtin_clzl(exp); bit >= 0; --bit) {
+        intMul(res, res, res);
+        if(exp >> bit & 1) intMul(res, res, base);
+    }
+    mpz_swap(r, res);
+    pool.clearInt(res);
+}
+
+// Multiplies the `count` values at `vals` into `res` as a balanced product tree - neighbouring
+// values are multiplied pairwise, then their products, and so on - so that the operands of each
+// multiplication are of similar size, which is where GMP's subquadratic multiplication pays off,
+// instead of multiplying an ever growing product by one small value at a time.
+// With `threads` > 1, the two halves of large trees are computed in parallel on the worker pool
+// (and split further), and their product is split across all of them.
+static void intProduct(mpz_ptr res, const mpz_srcptr *vals, size_t count, size_t threads)
+{
+    if(count == 0) {
+        mpz_set_ui(res, 1);
+        return;
+    }
+    size_t limbs = 0;
+    for(size_t i = 0; i < count; ++i) limbs += mpz_size(vals[i]);
+    // The halves have about half the limbs each, so that is what their product is split for.
+    if(threads > 1 && count > 1 && limbs >= 2 * mulParallelLimbs.load(std::memory_order_relaxed)) {
+        size_t half = count / 2;
+        mpz_t high;
+        mpz_init(high);
+        workerPool.run(2, 2, [&](size_t i, size_t, size_t) {
+            if(i == 0) intProduct(res, vals, half, threads - threads / 2);
+            else intProduct(high, vals + half, count - half, threads / 2);
+        });
+        intMul(res, res, high, threads);
+        mpz_clear(high);
+        return;
+    }
+    Vector<__mpz_struct> level((count + 1) / 2);
+    for(size_t i = 0; i < level.size(); ++i) {
+        mpz_init(&level[i]);
+        if(2 * i + 1 < count) mpz_mul(&level[i], vals[2 * i], vals[2 * i + 1]);
+        else mpz_set(&level[i], vals[2 * i]);
+    }
+    // The products of level[i] and level[i + 1] go to level[i / 2], which has already been used.
+    for(size_t len = level.size(); len > 1; len = (len + 1) / 2) {
+        for(size_t i = 0; i < len; i += 2) {
+            if(i + 1 < len) mpz_mul(&level[i / 2], &level[i], &level[i + 1]);
+            else mpz_swap(&level[i / 2], &level[i]);
+        }
+    }
+    mpz_swap(res, &level[0]);
+    for(auto &e : level) mpz_clear(&e);
+}
+
+FERAL_FUNC(mulSetParallelLimbs, 1, false,
+           "  fn(limbs) -> Nil\n"
+           "Sets the size (in limbs, for both operands) from which MPInt multiplications are split "
+           "across threads.")
+{
+    EXPECT(VarInt, args[1], "limb count");
+    int64_t limbs = as<VarInt>(args[1])->getVal();
+    if(limbs < 1) {
+        vm.fail(loc, "limb count must be positive, found: ", limbs);
+        return nullptr;
+    }
+    mulParallelLimbs.store(limbs, std::memory_order_relaxed);
+    return vm.getNil();
+}
+
+FERAL_FUNC(mulGetParallelLimbs, 0, false,
+           "  fn() -> Int\n"
+           "Returns the size (in limbs, for both operands) from which MPInt multiplications are "
+           "split across threads.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)mulParallelLimbs.load(std::memory_order_relaxed));
+}
+
+FERAL_FUNC(mulSetThreads, 1, false,
+           "  fn(threads) -> Nil\n"
+           "Sets the number of threads which large MPInt multiplications are split across - 0 "
+           "means one per core, and 1 disables the splitting.")
+{
+    EXPECT(VarInt, args[1], "thread count");
+    int64_t threads = as<VarInt>(args[1])->getVal();
+    if(threads < 0) {
+        vm.fail(loc, "thread count cannot be negative, found: ", threads);
+        return nullptr;
+    }
+    mulThreads.store(threads, std::memory_order_relaxed);
+    return vm.getNil();
+}
+
+FERAL_FUNC(mulGetThreads, 0, false,
+           "  fn() -> Int\n"
+           "Returns the number of threads which large MPInt multiplications are split across (0 "
+           "means one per core).")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)mulThreads.load(std::memory_order_relaxed));
+}
+
+#define ARITHI_FUNC(fn, name, op, arith)                                                   \
+    FERAL_FUNC(mpInt##fn, 1, false,                                                        \
+               "  var.fn(other) -> MPInt\n"                                                \
+               "Applies arithmetic-" STRINGIFY(                                            \
+                   name) " on `var` and `other` and returns a new MPInt with the result.") \
+    {                                                                                      \
+        if(arith != ArithOp::None && args[1]->is<VarMPComplex>()) {                        \
+            return complexArithRev(vm, loc, args[0], args[1], arith);                      \
+        }                                                                                  \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int " STRINGIFY(name));  \
+        VarMPInt *lhs = as<VarMPInt>(args[0]);                                             \
+        IntOperand rhs(args[1]);                                                           \
+        int64_t small;                                                                     \
+        if(lhs->isSmall() && rhs.isSmall() &&                                              \
+           small##fn(lhs->getSmall(), rhs.getSmall(), small))                              \
+        {                                                                                  \
+            return intResult(vm, loc, args[0], args[1], small);                            \
+        }                                                                                  \
+        VarMPInt *res = intResult(vm, loc, args[0], args[1]);                              \
+        op(res->getPtr(), lhs->getSrcPtr(), rhs.get());                                    \
+        res->normalize();                                                                  \
+        return res;                                                                        \
+    }
+
+#define ARITHI_ASSN_FUNC(fn, name, op)                                            \
+    FERAL_FUNC(mpIntAssn##fn, 1, false,                                           \
+               "  var.fn(other) -> var\n"                                         \
+               "Applies arithmetic-" STRINGIFY(                                   \
+                   name) " on `var` with `other` and returns the updated `var`.") \
+    {                                                                             \
+        EXPECT_NO_CONST(args[0], "var");                                          \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1],                      \
+                "big int " STRINGIFY(name) "-assn");                              \
+        VarMPInt *lhs = as<VarMPInt>(args[0]);                                    \
+        IntOperand rhs(args[1]);                                                  \
+        int64_t small;                                                            \
+        if(lhs->isSmall() && rhs.isSmall() &&                                     \
+           small##fn(lhs->getSmall(), rhs.getSmall(), small))                     \
+        {                                                                         \
+            lhs->setSmall(small);                                                 \
+            return args[0];                                                       \
+        }                                                                         \
+        op(lhs->getPtr(), lhs->getSrcPtr(), rhs.get());                           \
+        lhs->normalize();                                                         \
+        return args[0];                                                           \
+    }
+
+#define LOGICI_FUNC(fn, name, sym)                                                        \
+    FERAL_FUNC(mpInt##fn, 1, false,                                                       \
+               "  var.fn(other) -> Bool\n"                                                \
+               "Applies logical '" STRINGIFY(                                             \
+                   name) "' between `var` and `other` and returns the resulting Bool.")   \
+    {                                                                                     \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1],                              \
+                "big int logical " STRINGIFY(name));                                      \
+        int cmp;                                                                          \
+        return intCmp(as<VarMPInt>(args[0]), args[1], cmp) && cmp sym 0 ? vm.getTrue()    \
+                                                                         : vm.getFalse(); \
+    }
+
+ARITHI_FUNC(Add, add, mpz_add, ArithOp::Add)
+ARITHI_FUNC(Sub, sub, mpz_sub, ArithOp::Sub)
+ARITHI_FUNC(Mul, mul, intMul, ArithOp::Mul)
+ARITHI_FUNC(Mod, mod, mpz_mod, ArithOp::None)
+
+ARITHI_ASSN_FUNC(Add, add, mpz_add)
+ARITHI_ASSN_FUNC(Sub, sub, mpz_sub)
+ARITHI_ASSN_FUNC(Mul, mul, intMul)
+ARITHI_ASSN_FUNC(Mod, mod, mpz_mod)
+
+LOGICI_FUNC(LT, lt, <)
+LOGICI_FUNC(GT, gt, >)
+LOGICI_FUNC(LE, le, <=)
+LOGICI_FUNC(GE, ge, >=)
+
+FERAL_FUNC(mpIntEQ, 1, false,
+           "  var.fn(other) -> Bool\n"
+           "Returns `true` if `var` and `other` are equal.")
+{
+    int cmp;
+    if(args[1]->is<VarInt>() || args[1]->is<VarFlt>() || args[1]->is<VarMPInt>() ||
+       args[1]->is<VarMPFlt>())
+    {
+        return intCmp(as<VarMPInt>(args[0]), args[1], cmp) && cmp == 0 ? vm.getTrue()
+                                                                        : vm.getFalse();
+    }
+    return vm.getFalse();
+}
+
+FERAL_FUNC(mpIntNE, 1, false,
+           "  var.fn(other) -> Bool\n"
+           "Returns `true` if `var` and `other` are not equal.")
+{
+    int cmp;
+    if(args[1]->is<VarInt>() || args[1]->is<VarFlt>() || args[1]->is<VarMPInt>() ||
+       args[1]->is<VarMPFlt>())
+    {
+        return intCmp(as<VarMPInt>(args[0]), args[1], cmp) && cmp == 0 ? vm.getFalse()
+                                                                        : vm.getTrue();
+    }
+    return vm.getTrue();
+}
+
+FERAL_FUNC(mpIntDiv, 1, false,
+           "  var.fn(other) -> MPInt\n"
+           "Divides `var` by `other` and returns a new MPInt with the result.")
+{
+    if(args[1]->is<VarMPComplex>()) return complexArithRev(vm, loc, args[0], args[1], ArithOp::Div);
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int division");
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    IntOperand rhs(args[1]);
+    // rhs == 0
+    if(rhs.isSmall() ? rhs.getSmall() == 0 : mpz_sgn(rhs.get()) == 0) {
+        vm.fail(loc, "division by zero");
+        return nullptr;
+    }
+    int64_t small;
+    if(lhs->isSmall() && rhs.isSmall() && smallDiv(lhs->getSmall(), rhs.getSmall(), small)) {
+        return intResult(vm, loc, args[0], args[1], small);
+    }
+    VarMPInt *res = intResult(vm, loc, args[0], args[1]);
+    mpz_div(res->getPtr(), lhs->getSrcPtr(), rhs.get());
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntAssnDiv, 1, false,
+           "  var.fn(other) -> var\n"
+           "Divides `var` by `other` and returns the updated `var`.")
+{
+    EXPECT_NO_CONST(args[0], "var");
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int division");
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    IntOperand rhs(args[1]);
+    // rhs == 0
+    if(rhs.isSmall() ? rhs.getSmall() == 0 : mpz_sgn(rhs.get()) == 0) {
+        vm.fail(loc, "division by zero");
+        return nullptr;
+    }
+    int64_t small;
+    if(lhs->isSmall() && rhs.isSmall() && smallDiv(lhs->getSmall(), rhs.getSmall(), small)) {
+        lhs->setSmall(small);
+        return args[0];
+    }
+    mpz_div(lhs->getPtr(), lhs->getSrcPtr(), rhs.get());
+    lhs->normalize();
+    return args[0];
+}
+
+// Bitwise operations on int64_t have the same (two's complement) semantics as the mpz ones,
+// and can never overflow.
+#define BITWISEI_FUNC(fn, name, opname, sym)                                                   \
+    FERAL_FUNC(mpInt##fn, 1, false,                                                            \
+               "  var.fn(other) -> MPInt\n"                                                    \
+               "Applies bitwise " opname " operation between `var` and `other` and returns a " \
+               "new MPInt with the result.")                                                   \
+    {                                                                                          \
+        EXPECT2(VarInt, VarMPInt, args[1], "big int bitwise " opname);                         \
+        VarMPInt *lhs = as<VarMPInt>(args[0]);                                                 \
+        IntOperand rhs(args[1]);                                                               \
+        if(lhs->isSmall() && rhs.isSmall()) {                                                  \
+            return intResult(vm, loc, args[0], args[1], lhs->getSmall() sym rhs.getSmall());   \
+        }                                                                                      \
+        VarMPInt *res = intResult(vm, loc, args[0], args[1]);                                  \
+        mpz_##name(res->getPtr(), lhs->getSrcPtr(), rhs.get());                                \
+        res->normalize();                                                                      \
+        return res;                                                                            \
+    }
+
+#define BITWISEI_ASSN_FUNC(fn, name, opname, sym)                                            \
+    FERAL_FUNC(mpIntAssn##fn, 1, false,                                                      \
+               "  var.fn(other) -> var\n"                                                    \
+               "Applies bitwise " opname " operation between `var` and `other` and returns " \
+               "the updated `var`.")                                                         \
+    {                                                                                        \
+        EXPECT_NO_CONST(args[0], "var");                                                     \
+        EXPECT2(VarInt, VarMPInt, args[1], "big int bitwise " opname "-assn");               \
+        VarMPInt *lhs = as<VarMPInt>(args[0]);                                               \
+        IntOperand rhs(args[1]);                                                             \
+        if(lhs->isSmall() && rhs.isSmall()) {                                                \
+            lhs->setSmall(lhs->getSmall() sym rhs.getSmall());                               \
+            return args[0];                                                                  \
+        }                                                                                    \
+        mpz_##name(lhs->getPtr(), lhs->getSrcPtr(), rhs.get());                              \
+        lhs->normalize();                                                                    \
+        return args[0];                                                                      \
+    }
+
+BITWISEI_FUNC(BAnd, and, "AND", &)
+BITWISEI_FUNC(BOr, ior, "OR", |)
+BITWISEI_FUNC(BXOr, xor, "XOR", ^)
+
+BITWISEI_ASSN_FUNC(BAnd, and, "AND", &)
+BITWISEI_ASSN_FUNC(BOr, ior, "OR", |)
+BITWISEI_ASSN_FUNC(BXOr, xor, "XOR", ^)
+
+FERAL_FUNC(mpIntBNot, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Applies bitwise NOT operation on `var` and returns a new MPInt with the result.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(lhs->isSmall()) return intResult(vm, loc, args[0], nullptr, ~lhs->getSmall());
+    VarMPInt *res = intResult(vm, loc, args[0], nullptr);
+    mpz_com(res->getPtr(), lhs->getSrcPtr());
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntAssnBNot, 0, false,
+           "  var.fn(other) -> var\n"
+           "Applies bitwise NOT operation on `var` and returns the updated `var`.")
+{
+    EXPECT_NO_CONST(args[0], "var");
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(lhs->isSmall()) {
+        lhs->setSmall(~lhs->getSmall());
+        return args[0];
+    }
+    mpz_com(lhs->getPtr(), lhs->getSrcPtr());
+    lhs->normalize();
+    return args[0];
+}
+
+#define SHIFTI_FUNC(fn, name, opname)                                                         \
+    FERAL_FUNC(mpInt##fn, 1, false,                                                           \
+               "  var.fn(other) -> MPInt\n"                                                   \
+               "Applies " opname " shift operation on `var` using `other` and returns a new " \
+               "MPInt with the result.")                                                      \
+    {                                                                                         \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int " opname "-shift");     \
+        VarMPInt *lhs = as<VarMPInt>(args[0]);                                                \
+        unsigned long bits = IntOperand(args[1]).getSi();                                     \
+        int64_t small;                                                                        \
+        if(lhs->isSmall() && small##fn(lhs->getSmall(), bits, small)) {                       \
+            return intResult(vm, loc, args[0], args[1], small);                               \
+        }                                                                                     \
+        VarMPInt *res = intResult(vm, loc, args[0], args[1]);                                 \
+        mpz_##name(res->getPtr(), lhs->getSrcPtr(), bits);                                    \
+        res->normalize();                                                                     \
+        return res;                                                                           \
+    }
+
+#define SHIFTI_ASSN_FUNC(fn, name, opname)                                                     \
+    FERAL_FUNC(mpIntAssn##fn, 1, false,                                                        \
+               "  var.fn(other) -> var\n"                                                      \
+               "Applies " opname " shift operation on `var` using `other` and returns the "    \
+               "updated `var`.")                                                               \
+    {                                                                                          \
+        EXPECT_NO_CONST(args[0], "var");                                                       \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int " opname "-shift-assn"); \
+        VarMPInt *lhs = as<VarMPInt>(args[0]);                                                 \
+        unsigned long bits = IntOperand(args[1]).getSi();                                      \
+        int64_t small;                                                                         \
+        if(lhs->isSmall() && small##fn(lhs->getSmall(), bits, small)) {                        \
+            lhs->setSmall(small);                                                              \
+            return args[0];                                                                    \
+        }                                                                                      \
+        mpz_##name(lhs->getPtr(), lhs->getSrcPtr(), bits);                                     \
+        lhs->normalize();                                                                      \
+        return args[0];                                                                        \
+    }
+
+SHIFTI_FUNC(LShift, mul_2exp, "left")
+SHIFTI_FUNC(RShift, div_2exp, "right")
+
+SHIFTI_ASSN_FUNC(LShift, mul_2exp, "left")
+SHIFTI_ASSN_FUNC(RShift, div_2exp, "right")
+
+FERAL_FUNC(mpIntPreInc, 0, false,
+           "  var.fn() -> var\n"
+           "Applies pre-increment on `var` and returns `var` itself.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    int64_t small;
+    if(lhs->isSmall() && smallAdd(lhs->getSmall(), 1, small)) {
+        lhs->setSmall(small);
+        return args[0];
+    }
+    mpz_add_ui(lhs->getPtr(), lhs->getSrcPtr(), 1);
+    lhs->normalize();
+    return args[0];
+}
+
+FERAL_FUNC(mpIntPostInc, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Applies post-increment on `var` and returns a new MPInt with `var` - 1 as the result.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, lhs->getSrcPtr());
+    int64_t small;
+    if(lhs->isSmall() && smallAdd(lhs->getSmall(), 1, small)) {
+        lhs->setSmall(small);
+        return res;
+    }
+    mpz_add_ui(lhs->getPtr(), lhs->getSrcPtr(), 1);
+    lhs->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntPreDec, 0, false,
+           "  var.fn() -> var\n"
+           "Applies pre-decrement on `var` and returns `var` itself.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    int64_t small;
+    if(lhs->isSmall() && smallSub(lhs->getSmall(), 1, small)) {
+        lhs->setSmall(small);
+        return args[0];
+    }
+    mpz_sub_ui(lhs->getPtr(), lhs->getSrcPtr(), 1);
+    lhs->normalize();
+    return args[0];
+}
+
+FERAL_FUNC(mpIntPostDec, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Applies post-decrement on `var` and returns a new MPInt with `var` + 1 as the result.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, lhs->getSrcPtr());
+    int64_t small;
+    if(lhs->isSmall() && smallSub(lhs->getSmall(), 1, small)) {
+        lhs->setSmall(small);
+        return res;
+    }
+    mpz_sub_ui(lhs->getPtr(), lhs->getSrcPtr(), 1);
+    lhs->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntUSub, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the negative equivalent of `var` as a new MPInt.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(lhs->isSmall() && lhs->getSmall() != INT64_MIN) {
+        return intResult(vm, loc, args[0], nullptr, -lhs->getSmall());
+    }
+    VarMPInt *res = intResult(vm, loc, args[0], nullptr);
+    mpz_neg(res->getPtr(), lhs->getSrcPtr());
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntPow, 1, false,
+           "  var.fn(other) -> MPInt\n"
+           "Raises `var` to the power of `other` and returns a new MPInt with the result.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int power");
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    IntOperand expVal(args[1]);
+    // mpz_get_ui() would truncate anything else - powers with huge exponents can only be computed
+    // modulo something, with powm().
+    if(!expVal.fitsUi()) {
+        vm.fail(loc, "exponent must be non-negative and fit in 64 bits");
+        return nullptr;
+    }
+    unsigned long exp = expVal.getUi();
+    int64_t small;
+    if(lhs->isSmall() && smallPow(lhs->getSmall(), exp, small)) {
+        return intResult(vm, loc, args[0], args[1], small);
+    }
+    VarMPInt *res = intResult(vm, loc, args[0], args[1]);
+    intPowUi(res->getPtr(), lhs->getSrcPtr(), exp);
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntRoot, 1, false,
+           "  var.fn(other) -> MPInt\n"
+           "Lowers `var` to the root of `other` and returns a new MPInt with the result.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int root");
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    unsigned long n = IntOperand(args[1]).getUi();
+    VarMPInt *res   = intResult(vm, loc, args[0], args[1]);
+    mpz_root(res->getPtr(), lhs->getSrcPtr(), n);
+    res->normalize();
+    return res;
+}
+
+#define MULACCI_FUNC(fn, name, doc)                                                             \
+    FERAL_FUNC(mpInt##fn, 2, false,                                                             \
+               "  var.fn(a, b) -> var\n" doc " in place (without creating a temporary for the " \
+               "product) and returns the updated `var`.")                                       \
+    {                                                                                           \
+        EXPECT_NO_CONST(args[0], "var");                                                        \
+        EXPECT(VarMPInt, args[1], "big int multiplicand");                                      \
+        EXPECT(VarMPInt, args[2], "big int multiplier");                                        \
+        VarMPInt *acc = as<VarMPInt>(args[0]);                                                  \
+        VarMPInt *a   = as<VarMPInt>(args[1]);                                                  \
+        VarMPInt *b   = as<VarMPInt>(args[2]);                                                  \
+        int64_t prod, small;                                                                    \
+        if(acc->isSmall() && a->isSmall() && b->isSmall() &&                                    \
+           smallMul(a->getSmall(), b->getSmall(), prod) &&                                      \
+           small##fn(acc->getSmall(), prod, small))                                             \
+        {                                                                                       \
+            acc->setSmall(small);                                                               \
+            return args[0];                                                                     \
+        }                                                                                       \
+        mpz_##name(acc->getPtr(), a->getSrcPtr(), b->getSrcPtr());                              \
+        acc->normalize();                                                                       \
+        return args[0];                                                                         \
+    }
+
+// Used by MULACCI_FUNC - the names follow those of the GMP functions.
+static inline bool smallAddMul(int64_t acc, int64_t prod, int64_t &res)
+{
+    return smallAdd(acc, prod, res);
+}
+static inline bool smallSubMul(int64_t acc, int64_t prod, int64_t &res)
+{
+    return smallSub(acc, prod, res);
+}
+
+MULACCI_FUNC(AddMul, addmul, "Adds `a` * `b` to `var`")
+MULACCI_FUNC(SubMul, submul, "Subtracts `a` * `b` from `var`")
+
+FERAL_FUNC(mpIntSqr, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the square of `var` as a new MPInt.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    int64_t small;
+    if(lhs->isSmall() && smallMul(lhs->getSmall(), lhs->getSmall(), small)) {
+        return intResult(vm, loc, args[0], nullptr, small);
+    }
+    VarMPInt *res = intResult(vm, loc, args[0], nullptr);
+    intMul(res->getPtr(), lhs->getSrcPtr(), lhs->getSrcPtr());
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntPopCnt, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the number of set bits in `var` as a new MPInt.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(lhs->isSmall() && lhs->getSmall() >= 0) {
+        return vm.makeVar<VarMPInt>(loc, (int64_t)__builtin_popcountll(lhs->getSmall()));
+    }
+    return vm.makeVar<VarMPInt>(loc, mpz_popcount(lhs->getSrcPtr()));
+}
+
+// Number theory operations - each one writes its result to `res` (fetched with getPtr() before any
+// operand, so that `res` can also be one of them), with `args` being `var` followed by the
+// operands (which are all MPInts), and returns false after failing if it cannot be computed.
+
+static bool intPowm(VirtualMachine &vm, ModuleLoc loc, VarMPInt *res, Span<Var *> args)
+{
+    mpz_ptr r      = res->getPtr();
+    mpz_srcptr mod = as<VarMPInt>(args[2])->getSrcPtr();
+    if(mpz_sgn(mod) == 0) {
+        vm.fail(loc, "modulus must not be zero");
+        return false;
+    }
+    mpz_srcptr base = as<VarMPInt>(args[0])->getSrcPtr();
+    mpz_srcptr exp  = as<VarMPInt>(args[1])->getSrcPtr();
+    if(mpz_sgn(exp) >= 0) {
+        mpz_powm(r, base, exp, mod);
+        return true;
+    }
+    // base ** -exp = (base ** -1) ** exp
+    mpz_t inv, absExp;
+    pool.initInt(inv);
+    if(!mpz_invert(inv, base, mod)) {
+        pool.clearInt(inv);
+        vm.fail(loc, "negative exponent, but the base is not invertible modulo the modulus");
+        return false;
+    }
+    // Computed into `inv`, as `absExp` is a view of the limbs of `exp` (which may be `r`) that GMP
+    // cannot see the aliasing through.
+    mpz_roinit_n(absExp, mpz_limbs_read(exp), mpz_size(exp));
+    mpz_powm(inv, inv, absExp, mod);
+    mpz_swap(r, inv);
+    pool.clearInt(inv);
+    return true;
+}
+
+static bool intPowmSec(VirtualMachine &vm, ModuleLoc loc, VarMPInt *res, Span<Var *> args)
+{
+    mpz_ptr r       = res->getPtr();
+    mpz_srcptr base = as<VarMPInt>(args[0])->getSrcPtr();
+    mpz_srcptr exp  = as<VarMPInt>(args[1])->getSrcPtr();
+    mpz_srcptr mod  = as<VarMPInt>(args[2])->getSrcPtr();
+    if(mpz_sgn(exp) <= 0 || mpz_sgn(mod) <= 0 || mpz_even_p(mod)) {
+        vm.fail(loc, "expected a positive exponent and a positive odd modulus");
+        return false;
+    }
+    mpz_powm_sec(r, base, exp, mod);
+    return true;
+}
+
+static bool intInvert(VirtualMachine &vm, ModuleLoc loc, VarMPInt *res, Span<Var *> args)
+{
+    mpz_ptr r      = res->getPtr();
+    mpz_srcptr mod = as<VarMPInt>(args[1])->getSrcPtr();
+    if(mpz_sgn(mod) == 0) {
+        vm.fail(loc, "modulus must not be zero");
+        return false;
+    }
+    // mpz_invert() leaves its result undefined when there is no inverse, which must not happen to
+    // the destination.
+    mpz_t inv;
+    pool.initInt(inv);
+    if(!mpz_invert(inv, as<VarMPInt>(args[0])->getSrcPtr(), mod)) {
+        pool.clearInt(inv);
+        vm.fail(loc, "value is not invertible modulo the modulus");
+        return false;
+    }
+    mpz_swap(r, inv);
+    pool.clearInt(inv);
+    return true;
+}
+
+static bool intGcd(VirtualMachine &vm, ModuleLoc loc, VarMPInt *res, Span<Var *> args)
+{
+    mpz_ptr r = res->getPtr();
+    mpz_gcd(r, as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());
+    return true;
+}
+
+static bool intLcm(VirtualMachine &vm, ModuleLoc loc, VarMPInt *res, Span<Var *> args)
+{
+    mpz_ptr r = res->getPtr();
+    mpz_lcm(r, as<VarMPInt>(args[0])->getSrcPtr(), as<VarMPInt>(args[1])->getSrcPtr());
+    return true;
+}
+
+static bool intDivExact(VirtualMachine &vm, ModuleLoc loc, VarMPInt *res, Span<Var *> args)
+{
+    mpz_ptr r      = res->getPtr();
+    mpz_srcptr div = as<VarMPInt>(args[1])->getSrcPtr();
+    if(mpz_sgn(div) == 0) {
+        vm.fail(loc, "division by zero");
+        return false;
+    }
+    mpz_divexact(r, as<VarMPInt>(args[0])->getSrcPtr(), div);
+    return true;
+}
+
+// Defines both the native which returns the result of int`fn`() as a new MPInt, and the `Into`
+// one which writes it to an existing MPInt `dest` instead.
+#define NUMTHEORYI_FUNC(fn, argc, params, doc)                                                    \
+    FERAL_FUNC(mpInt##fn, argc, false,                                                            \
+               "  var.fn(" params ") -> MPInt\n" doc " and returns a new MPInt with the result.") \
+    {                                                                                             \
+        for(size_t i = 1; i <= argc; ++i) EXPECT(VarMPInt, args[i], "big int operand");           \
+        VarMPInt *res = vm.makeVar<VarMPInt>(loc, (int64_t)0);                                    \
+        if(int##fn(vm, loc, res, args)) {                                                         \
+            res->normalize();                                                                     \
+            return res;                                                                           \
+        }                                                                                         \
+        vm.incVarRef(res);                                                                        \
+        vm.decVarRef(res);                                                                        \
+        return nullptr;                                                                           \
+    }                                                                                             \
+    FERAL_FUNC(mpInt##fn##Into, argc + 1, false,                                                  \
+               "  var.fn(dest, " params ") -> dest\n" doc " into the existing MPInt `dest` "      \
+               "(without creating a new value) and returns `dest`.")                              \
+    {                                                                                             \
+        EXPECT_NO_CONST(args[1], "destination");                                                  \
+        EXPECT(VarMPInt, args[1], "destination");                                                 \
+        Var *opArgs[argc + 1] = {args[0]};                                                        \
+        for(size_t i = 1; i <= argc; ++i) {                                                       \
+            EXPECT(VarMPInt, args[i + 1], "big int operand");                                     \
+            opArgs[i] = args[i + 1];                                                              \
+        }                                                                                         \
+        VarMPInt *dest = as<VarMPInt>(args[1]);                                                   \
+        if(!int##fn(vm, loc, dest, Span<Var *>(opArgs, argc + 1))) return nullptr;                \
+        dest->normalize();                                                                        \
+        return args[1];                                                                           \
+    }
+
+NUMTHEORYI_FUNC(Powm, 2, "exp, mod",
+                "Computes `var` ** `exp` modulo `mod` (without computing the full power - a "
+                "negative `exp` uses the inverse of `var`)")
+NUMTHEORYI_FUNC(PowmSec, 2, "exp, mod",
+                "Computes `var` ** `exp` modulo `mod` in a time (and with memory accesses) which "
+                "does not depend on the values, for cryptography - `exp` must be positive and "
+                "`mod` odd")
+NUMTHEORYI_FUNC(Invert, 1, "mod", "Computes the inverse of `var` modulo `mod` (failing if none)")
+NUMTHEORYI_FUNC(Gcd, 1, "other", "Computes the greatest common divisor of `var` and `other`")
+NUMTHEORYI_FUNC(Lcm, 1, "other", "Computes the least common multiple of `var` and `other`")
+NUMTHEORYI_FUNC(DivExact, 1, "other",
+                "Divides `var` by `other` - which must divide it exactly, as that is not checked")
+
+FERAL_FUNC(mpIntNextPrime, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the next (probable) prime greater than `var` as a new MPInt.")
+{
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    mpz_nextprime(res->getPtr(), as<VarMPInt>(args[0])->getSrcPtr());
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntNextPrimeInto, 1, false,
+           "  var.fn(dest) -> dest\n"
+           "Computes the next (probable) prime greater than `var` into the existing MPInt `dest` "
+           "(without creating a new value) and returns `dest`.")
+{
+    EXPECT_NO_CONST(args[1], "destination");
+    EXPECT(VarMPInt, args[1], "destination");
+    VarMPInt *dest = as<VarMPInt>(args[1]);
+    mpz_ptr r      = dest->getPtr();
+    mpz_nextprime(r, as<VarMPInt>(args[0])->getSrcPtr());
+    dest->normalize();
+    return args[1];
+}
+
+// Computes the gcd `g` of `a` and `b` along with `s` and `t` such that a * s + b * t = g, into the
+// distinct `g`, `s` and `t` (any of which can be `a` or `b`).
+static void intGcdExt(VarMPInt *g, VarMPInt *s, VarMPInt *t, VarMPInt *a, VarMPInt *b)
+{
+    mpz_ptr gp = g->getPtr(), sp = s->getPtr(), tp = t->getPtr();
+    mpz_gcdext(gp, sp, tp, a->getSrcPtr(), b->getSrcPtr());
+    g->normalize();
+    s->normalize();
+    t->normalize();
+}
+
+FERAL_FUNC(mpIntGcdExt, 1, false,
+           "  var.fn(other) -> Vec\n"
+           "Returns a Vec of new MPInts [g, s, t] such that g is the greatest common divisor of "
+           "`var` and `other`, and `var` * s + `other` * t = g.")
+{
+    EXPECT(VarMPInt, args[1], "big int gcd");
+    VarVec *res = vm.makeVar<VarVec>(loc, 3, false);
+    VarMPInt *g = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    VarMPInt *s = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    VarMPInt *t = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    intGcdExt(g, s, t, as<VarMPInt>(args[0]), as<VarMPInt>(args[1]));
+    for(Var *e : {g, s, t}) {
+        vm.incVarRef(e);
+        res->getVal().push_back(e);
+    }
+    return res;
+}
+
+FERAL_FUNC(mpIntGcdExtInto, 4, false,
+           "  var.fn(g, s, t, other) -> g\n"
+           "Computes the greatest common divisor of `var` and `other` into the existing MPInt `g`, "
+           "and `s` and `t` such that `var` * s + `other` * t = g into the existing MPInts `s` and "
+           "`t` (all three distinct), and returns `g`.")
+{
+    for(size_t i = 1; i <= 3; ++i) {
+        EXPECT_NO_CONST(args[i], "destination");
+        EXPECT(VarMPInt, args[i], "destination");
+    }
+    EXPECT(VarMPInt, args[4], "big int gcd");
+    if(args[1] == args[2] || args[1] == args[3] || args[2] == args[3]) {
+        vm.fail(loc, "the destinations must be distinct");
+        return nullptr;
+    }
+    intGcdExt(as<VarMPInt>(args[1]), as<VarMPInt>(args[2]), as<VarMPInt>(args[3]),
+              as<VarMPInt>(args[0]), as<VarMPInt>(args[4]));
+    return args[1];
+}
+
+// Computes the integer square root of the non-negative `val` into `root`, and the remainder into
+// the distinct `rem` (either of which can be `val`).
+static void intSqrtRem(VarMPInt *root, VarMPInt *rem, VarMPInt *val)
+{
+    mpz_ptr rootp = root->getPtr(), remp = rem->getPtr();
+    mpz_sqrtrem(rootp, remp, val->getSrcPtr());
+    root->normalize();
+    rem->normalize();
+}
+
+FERAL_FUNC(mpIntSqrtRem, 0, false,
+           "  var.fn() -> Vec\n"
+           "Returns a Vec of new MPInts [root, rem] such that root is the integer square root of "
+           "`var`, and root * root + rem = `var`.")
+{
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(mpz_sgn(lhs->getSrcPtr()) < 0) {
+        vm.fail(loc, "square root of a negative value");
+        return nullptr;
+    }
+    VarVec *res    = vm.makeVar<VarVec>(loc, 2, false);
+    VarMPInt *root = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    VarMPInt *rem  = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    intSqrtRem(root, rem, lhs);
+    for(Var *e : {root, rem}) {
+        vm.incVarRef(e);
+        res->getVal().push_back(e);
+    }
+    return res;
+}
+
+FERAL_FUNC(mpIntSqrtRemInto, 2, false,
+           "  var.fn(root, rem) -> root\n"
+           "Computes the integer square root of `var` into the existing MPInt `root`, and the "
+           "remainder (`var` - root * root) into the existing (distinct) MPInt `rem`, and returns "
+           "`root`.")
+{
+    for(size_t i = 1; i <= 2; ++i) {
+        EXPECT_NO_CONST(args[i], "destination");
+        EXPECT(VarMPInt, args[i], "destination");
+    }
+    if(args[1] == args[2]) {
+        vm.fail(loc, "the destinations must be distinct");
+        return nullptr;
+    }
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(mpz_sgn(lhs->getSrcPtr()) < 0) {
+        vm.fail(loc, "square root of a negative value");
+        return nullptr;
+    }
+    intSqrtRem(as<VarMPInt>(args[1]), as<VarMPInt>(args[2]), lhs);
+    return args[1];
+}
+
+FERAL_FUNC(mpIntIsProbablePrime, 0, true,
+           "  var.fn(reps = 25) -> Bool\n"
+           "Returns true if `var` is prime, or probably prime - after `reps` Miller-Rabin rounds "
+           "(each of which lets a composite value through with a probability of at most 1 / 4).")
+{
+    int64_t reps = 25;
+    if(args.size() > 1) {
+        EXPECT(VarInt, args[1], "repetition count");
+        reps = as<VarInt>(args[1])->getVal();
+        if(reps < 1 || reps > INT_MAX) {
+            vm.fail(loc, "repetition count must be positive, found: ", reps);
+            return nullptr;
+        }
+    }
+    return vm.getBool(mpz_probab_prime_p(as<VarMPInt>(args[0])->getSrcPtr(), reps) > 0);
+}
+
+FERAL_FUNC(mpIntJacobi, 1, false,
+           "  var.fn(other) -> Int\n"
+           "Returns the Jacobi symbol (`var` / `other`) - `other` must be odd and positive.")
+{
+    EXPECT(VarMPInt, args[1], "big int jacobi");
+    mpz_srcptr b = as<VarMPInt>(args[1])->getSrcPtr();
+    if(mpz_sgn(b) <= 0 || mpz_even_p(b)) {
+        vm.fail(loc, "expected an odd positive value for the jacobi symbol");
+        return nullptr;
+    }
+    return vm.makeVar<VarInt>(loc, mpz_jacobi(as<VarMPInt>(args[0])->getSrcPtr(), b));
+}
+
+FERAL_FUNC(mpIntToInt, 0, false,
+           "  var.fn() -> Int\n"
+           "Converts `var` from MPInt to Int and returns the value.")
+{
+    return vm.makeVar<VarMPInt>(loc, as<VarMPInt>(args[0])->getSi());
+}
+
+// Numbers with at least this many digits are converted to / from strings by splitting them in
+// halves (at a power of the base) which are converted in parallel on the worker pool, recursively.
+// Below it, GMP's own (subquadratic, but single threaded) conversion is used as is.
+static constexpr size_t INT_STR_PARALLEL_DIGITS = 1 << 17;
+
+// Returns true if `base` can be used for converting to / from strings.
+static inline bool isValidBase(int64_t base) { return base >= 2 && base <= 62; }
+
+// Number of times the conversion of a number of `digits` digits in `base` is split in halves.
+// Conversion in power of 2 bases is linear (just bit shifting), so it is never worth splitting.
+static int intStrSplitDepth(size_t digits, int base)
+{
+    if(digits < INT_STR_PARALLEL_DIGITS || (base & (base - 1)) == 0) return 0;
+    int depth = 0;
+    for(size_t threads = workerPool.getThreadCount(); threads > 1; threads >>= 1) {
+        ++depth;
+    }
+    return depth;
+}
+
+// Writes the digits of the non-negative `val` in `base` to `out`, padded with leading zeros to
+// exactly `width` digits (which `val` must fit in), without a terminator.
+static void intToDigits(mpz_srcptr val, int base, char *out, size_t width, int depth)
+{
+    if(depth == 0 || width < INT_STR_PARALLEL_DIGITS / 2) {
+        // mpz_sizeinbase() may be one more than `width`, plus the sign and the terminator.
+        Vector<char> buf(width + 3);
+        size_t len = 0;
+        if(mpz_sgn(val) != 0) {
+            mpz_get_str(buf.data(), base, val);
+            len = strlen(buf.data());
+        }
+        memset(out, '0', width - len);
+        memcpy(out + width - len, buf.data(), len);
+        return;
+    }
+    // val = high * base^lowDigits + low
+    size_t lowDigits = width / 2;
+    mpz_t high, low;
+    mpz_inits(high, low, NULL);
+    mpz_ui_pow_ui(low, base, lowDigits);
+    mpz_tdiv_qr(high, low, val, low);
+    workerPool.run(2, 2, [&](size_t i, size_t, size_t) {
+        if(i == 0) intToDigits(high, base, out, width - lowDigits, depth - 1);
+        else intToDigits(low, base, out + width - lowDigits, lowDigits, depth - 1);
+    });
+    mpz_clears(high, low, NULL);
+}
+
+// Writes `val` in `base` to `str`, with the digits written directly into it.
+static void intToStr(mpz_srcptr val, int base, String &str)
+{
+    size_t digits = mpz_sizeinbase(val, base);
+    int depth     = intStrSplitDepth(digits, base);
+    if(depth == 0) {
+        // mpz_get_str() needs space for the sign and the null terminator.
+        str.resize(digits + 2);
+        mpz_get_str(str.data(), base, val);
+        str.resize(strlen(str.data()));
+        return;
+    }
+    size_t sign = mpz_sgn(val) < 0;
+    str.resize(sign + digits);
+    if(sign) str[0] = '-';
+    mpz_t absVal;
+    intToDigits(mpz_roinit_n(absVal, mpz_limbs_read(val), mpz_size(val)), base,
+                str.data() + sign, digits, depth);
+    // mpz_sizeinbase() may be one more than the actual number of digits.
+    if(str[sign] == '0') str.erase(sign, 1);
+}
+
+// Sets `res` to the digits `vals` (each between 0 and base - 1, most significant first) in
+// `base`.
+static void digitsToInt(const unsigned char *vals, size_t len, int base, mpz_ptr res, int depth)
+{
+    if(depth == 0 || len < INT_STR_PARALLEL_DIGITS / 2) {
+        for(; len > 0 && *vals == 0; ++vals, --len) {}
+        // mpn_set_str() needs room for the largest number of `len` digits, plus one limb.
+        size_t limbs = (size_t)(len * std::log2(base) / GMP_NUMB_BITS) + 2;
+        mp_limb_t *rp = mpz_limbs_write(res, limbs);
+        mpz_limbs_finish(res, len > 0 ? mpn_set_str(rp, vals, len, base) : 0);
+        return;
+    }
+    // res = high * base^lowDigits + low
+    size_t lowDigits = len / 2;
+    mpz_t low, power;
+    mpz_inits(low, power, NULL);
+    workerPool.run(3, 3, [&](size_t i, size_t, size_t) {
+        if(i == 0) digitsToInt(vals, len - lowDigits, base, res, depth - 1);
+        else if(i == 1) digitsToInt(vals + len - lowDigits, lowDigits, base, low, depth - 1);
+        else mpz_ui_pow_ui(power, base, lowDigits);
+    });
+    mpz_mul(res, res, power);
+    mpz_add(res, res, low);
+    mpz_clears(low, power, NULL);
+}
+
+// Sets `res` to the number in `str` in `base`, returning false if `str` is not a valid number.
+// Like mpz_set_str(), base 0 means that the base is taken from the prefix (0x, 0b, 0), if any.
+static bool strToInt(const String &str, int base, mpz_ptr res)
+{
+    size_t start = !str.empty() && str[0] == '-' ? 1 : 0;
+    size_t len   = str.size() - start;
+    if(base == 0 || len < INT_STR_PARALLEL_DIGITS) return mpz_set_str(res, str.c_str(), base) == 0;
+    // Same as the digit values of mpz_set_str() - case insensitive for bases up to 36.
+    Vector<unsigned char> vals(len);
+    for(size_t i = 0; i < len; ++i) {
+        char c = str[start + i];
+        int val;
+        if(c >= '0' && c <= '9') val = c - '0';
+        else if(c >= 'A' && c <= 'Z') val = c - 'A' + 10;
+        else if(c >= 'a' && c <= 'z') val = c - 'a' + (base <= 36 ? 10 : 36);
+        else return false;
+        if(val >= base) return false;
+        vals[i] = val;
+    }
+    digitsToInt(vals.data(), len, base, res, intStrSplitDepth(len, base));
+    if(str[0] == '-') mpz_neg(res, res);
+    return true;
+}
+
+FERAL_FUNC(mpIntToStr, 0, true,
+           "  var.fn(base = 10) -> Str\n"
+           "Converts `var` from MPInt to Str in `base` (between 2 and 62) and returns the value.")
+{
+    int64_t base = 10;
+    if(args.size() > 1) {
+        EXPECT(VarInt, args[1], "base");
+        base = as<VarInt>(args[1])->getVal();
+        if(!isValidBase(base)) {
+            vm.fail(loc, "base must be between 2 and 62, found: ", base);
+            return nullptr;
+        }
+    }
+    VarMPInt *lhs = as<VarMPInt>(args[0]);
+    if(lhs->isSmall() && base == 10) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%" PRId64, lhs->getSmall());
+        return vm.makeVar<VarStr>(loc, buf);
+    }
+    VarStr *res = vm.makeVar<VarStr>(loc, "");
+    intToStr(lhs->getSrcPtr(), base, res->getVal());
+    return res;
+}
+
+FERAL_FUNC(mpIntToHex, 0, false,
+           "  var.fn() -> Str\n"
+           "Converts `var` from MPInt to a hexadecimal (lower case, without a prefix) Str and "
+           "returns the value.")
+{
+    VarStr *res = vm.makeVar<VarStr>(loc, "");
+    intToStr(as<VarMPInt>(args[0])->getSrcPtr(), 16, res->getVal());
+    return res;
+}
+
+FERAL_FUNC(mpIntFromStrNative, 2, false,
+           "  fn(str, base) -> MPInt\n"
+           "Creates and returns a new MPInt with the number in `str`, in `base` (between 2 and 62, "
+           "or 0 to take it from the prefix of `str` - 0x, 0b, or 0 for octal).")
+{
+    EXPECT(VarStr, args[1], "string");
+    EXPECT(VarInt, args[2], "base");
+    int64_t base = as<VarInt>(args[2])->getVal();
+    if(base != 0 && !isValidBase(base)) {
+        vm.fail(loc, "base must be 0 or between 2 and 62, found: ", base);
+        return nullptr;
+    }
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    if(!strToInt(as<VarStr>(args[1])->getVal(), base, res->getPtr())) {
+        vm.incVarRef(res);
+        vm.decVarRef(res);
+        vm.fail(loc, "invalid number in base ", base, ": ", as<VarStr>(args[1])->getVal());
+        return nullptr;
+    }
+    res->normalize();
+    return res;
+}
+
+// Iterator
+
+// Iterates over the values of an irange().
+// When the beginning, end, and step all fit in an int64_t, so do all the values in between, so the
+// iteration runs on plain integers (and yields MPInts stored inline) without touching GMP at all.
+// Otherwise, `curr` is stepped in place.
+// With setInPlace(), the same MPInt is yielded on every step, updated in place, which saves
+// creating a new one for each value.
+class VarMPIntIterator : public Var
+{
+    mpz_t begin, end, step, curr;
+    int64_t smallEnd, smallStep, smallCurr;
+    // In place mode only - the MPInt yielded on every step, and the VM which holds a reference to
+    // it for the iterator.
+    VarMPInt *yielded;
+    VirtualMachine *vm;
+    bool started;
+    bool done;
+    bool reversed;
+    bool isSmallRange;
+
+    void initSmall();
+
+public:
+    VarMPIntIterator(ModuleLoc loc);
+    VarMPIntIterator(ModuleLoc loc, mpz_srcptr _begin, mpz_srcptr _end, mpz_srcptr _step);
+    ~VarMPIntIterator();
+
+    Var *copy(ModuleLoc loc);
+    void set(Var *from);
+
+    // Moves to the next value, returning false if there is none.
+    bool next();
+    // Returns the current value - as a new MPInt, or the yielded one in place mode.
+    VarMPInt *getCurr(VirtualMachine &vm, ModuleLoc loc);
+
+    void setInPlace(VirtualMachine &vm, ModuleLoc loc);
+};
+
+VarMPIntIterator::VarMPIntIterator(ModuleLoc loc)
+    : Var(loc, 0), yielded(nullptr), vm(nullptr), started(false), done(false), reversed(false)
+{
+    mpz_init(begin);
+    mpz_init(end);
+    mpz_init(step);
+    mpz_init(curr);
+    initSmall();
+}
+VarMPIntIterator::VarMPIntIterator(ModuleLoc loc, mpz_srcptr _begin, mpz_srcptr _end,
+                                   mpz_srcptr _step)
+    : Var(loc, 0), yielded(nullptr), vm(nullptr), started(false), done(false),
+      reversed(mpz_cmp_si(_step, 0) < 0)
+{
+    mpz_init_set(begin, _begin);
+    mpz_init_set(end, _end);
+    mpz_init_set(step, _step);
+    mpz_init_set(curr, _begin);
+    initSmall();
+}
+VarMPIntIterator::~VarMPIntIterator()
+{
+    if(yielded) vm->decVarRef(yielded);
+    mpz_clears(begin, end, step, curr, NULL);
+}
+
+void VarMPIntIterator::initSmall()
+{
+    isSmallRange = mpz_fits_slong_p(curr) && mpz_fits_slong_p(end) && mpz_fits_slong_p(step);
+    if(!isSmallRange) return;
+    smallCurr = mpz_get_si(curr);
+    smallEnd  = mpz_get_si(end);
+    smallStep = mpz_get_si(step);
+}
+
+Var *VarMPIntIterator::copy(ModuleLoc loc) { return new VarMPIntIterator(loc, begin, end, step); }
+void VarMPIntIterator::set(Var *from)
+{
+    VarMPIntIterator *f = as<VarMPIntIterator>(from);
+    mpz_set(begin, f->begin);
+    mpz_set(end, f->end);
+    mpz_set(step, f->step);
+    mpz_set(curr, f->curr);
+    smallEnd     = f->smallEnd;
+    smallStep    = f->smallStep;
+    smallCurr    = f->smallCurr;
+    started      = f->started;
+    done         = f->done;
+    reversed     = f->reversed;
+    isSmallRange = f->isSmallRange;
+}
+
+bool VarMPIntIterator::next()
+{
+    if(done) return false;
+    if(isSmallRange) {
+        // Overflowing means going past the end, which fits in an int64_t.
+        if(started && __builtin_add_overflow(smallCurr, smallStep, &smallCurr)) done = true;
+        else done = reversed ? smallCurr <= smallEnd : smallCurr >= smallEnd;
+    } else {
+        if(started) mpz_add(curr, curr, step);
+        int cmp = mpz_cmp(curr, end);
+        done    = reversed ? cmp <= 0 : cmp >= 0;
+    }
+    started = true;
+    return !done;
+}
+
+VarMPInt *VarMPIntIterator::getCurr(VirtualMachine &vm, ModuleLoc loc)
+{
+    if(!yielded) {
+        if(isSmallRange) return vm.makeVar<VarMPInt>(loc, smallCurr);
+        return vm.makeVar<VarMPInt>(loc, curr);
+    }
+    if(isSmallRange) {
+        yielded->setSmall(smallCurr);
+    } else {
+        mpz_set(yielded->getPtr(), curr);
+        yielded->normalize();
+    }
+    return yielded;
+}
+
+void VarMPIntIterator::setInPlace(VirtualMachine &vm, ModuleLoc loc)
+{
+    if(yielded) return;
+    yielded  = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    this->vm = &vm;
+    vm.incVarRef(yielded);
+}
+
+FERAL_FUNC(mpIntRange, 1, true,
+           "  fn(start, end, step) -> MPIntIterator\n"
+           "Creates an iterator which starts at `start`, ends at `end` (exclusive), and "
+           "increments/decrements by `step`.\n"
+           "If `end` and `step` are not provided, `start` becomes 0, `end` becomes the provided "
+           "`start`, and `step` becomes 1.")
+{
+    Var *lhsBase  = args[1];
+    Var *rhsBase  = args.size() > 2 ? args[2] : nullptr;
+    Var *stepBase = args.size() > 3 ? args[3] : nullptr;
+
+    EXPECT(VarMPInt, lhsBase, "range start");
+    if(rhsBase) { EXPECT(VarMPInt, rhsBase, "range end"); }
+    if(stepBase) { EXPECT(VarMPInt, stepBase, "range step"); }
+
+    mpz_t begin, end, step;
+    mpz_inits(begin, end, step, NULL);
+    if(args.size() > 2) mpz_set(begin, as<VarMPInt>(lhsBase)->getSrcPtr());
+    else mpz_set_si(begin, 0);
+    if(rhsBase) mpz_set(end, as<VarMPInt>(rhsBase)->getSrcPtr());
+    else mpz_set(end, as<VarMPInt>(lhsBase)->getSrcPtr());
+    if(stepBase) mpz_set(step, as<VarMPInt>(stepBase)->getSrcPtr());
+    else mpz_set_si(step, 1);
+    VarMPIntIterator *res = vm.makeVar<VarMPIntIterator>(loc, begin, end, step);
+    mpz_clears(begin, end, step, NULL);
+    return res;
+}
+
+FERAL_FUNC(getMPIntIteratorNext, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Fetch the next MPInt from the MPIntIterator `var`.\n"
+           "This function is mainly used by for-in loop.")
+{
+    VarMPIntIterator *it = as<VarMPIntIterator>(args[0]);
+    if(!it->next()) { return vm.getNil(); }
+    VarMPInt *res = it->getCurr(vm, loc);
+    res->setLoadAsRef();
+    return res;
+}
+
+FERAL_FUNC(mpIntIteratorInPlace, 0, false,
+           "  var.fn() -> var\n"
+           "Makes the MPIntIterator `var` yield the same MPInt on every step, updated in place, "
+           "instead of a new one, and returns `var`.\n"
+           "A yielded value which is to be kept beyond its step must therefore be copied.")
+{
+    as<VarMPIntIterator>(args[0])->setInPlace(vm, loc);
+    return args[0];
+}
+
+// RNG
+
+FERAL_FUNC(mpIntRngGet, 2, false,
+           "  fn(upto, state) -> MPInt\n"
+           "Returns a random number between [0, `upto`), generated using the RandState `state`, "
+           "or the thread's default one if it is nil.")
+{
+    EXPECT(VarMPInt, args[1], "upper limit");
+    EXPECT2(VarNil, VarRandState, args[2], "random state");
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    mpz_urandomm(res->getPtr(), getRandStateArg(args[2]), as<VarMPInt>(args[1])->getSrcPtr());
+    res->normalize();
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// Float Functions /////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+FERAL_FUNC(mpFltNewNative, 2, false,
+           "  fn(value, precision) -> MPFlt\n"
+           "Creates and returns a new MPFlt with `value` and `precision` bits.\n"
+           "Here `value` can be any of Flt / Str / MPInt / MPFlt\n"
+           "If `precision` is 0, the default precision is used (or the precision of `value` if it "
+           "is an MPFlt).")
+{
+    EXPECT4(VarFlt, VarStr, VarMPInt, VarMPFlt, args[1], "initial value");
+    EXPECT(VarInt, args[2], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[2], true, prec)) return nullptr;
+    if(args[1]->is<VarFlt>()) {
+        return vm.makeVar<VarMPFlt>(loc, as<VarFlt>(args[1])->getVal(), prec);
+    }
+    if(args[1]->is<VarStr>()) {
+        return vm.makeVar<VarMPFlt>(loc, as<VarStr>(args[1])->getVal().c_str(), prec);
+    }
+    if(args[1]->is<VarMPInt>()) {
+        return vm.makeVar<VarMPFlt>(loc, as<VarMPInt>(args[1])->getSrcPtr(), prec);
+    }
+    return vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[1])->getSrcPtr(), prec);
+}
+
+FERAL_FUNC(mpFltCopy, 1, false,
+           "  var.fn() -> MPFlt\n"
+           "Creates a new instance of `var` and returns it.")
+{
+    return vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getSrcPtr());
+}
+
+// Returns an MPFlt to store the result of an operation on `lhs` (and `rhs`, if it is an MPFlt)
+// at precision `prec` - one of the operands if it is a temporary of that precision, otherwise a
+// new one.
+static inline VarMPFlt *fltResult(VirtualMachine &vm, ModuleLoc loc, Var *lhs, Var *rhs,
+                                  mpfr_prec_t prec)
+{
+    if(isTemporary(lhs) && as<VarMPFlt>(lhs)->getPrec() == prec) return as<VarMPFlt>(lhs);
+    if(rhs && rhs->is<VarMPFlt>() && isTemporary(rhs) && as<VarMPFlt>(rhs)->getPrec() == prec) {
+        return as<VarMPFlt>(rhs);
+    }
+    return vm.makeVar<VarMPFlt>(loc, 0.0, prec);
+}
+
+#define ARITHF_FUNC(fn, name, arith)                                                              \
+    FERAL_FUNC(mpFlt##fn, 1, false,                                                               \
+               "  var.fn(other) -> MPFlt\n"                                                       \
+               "Applies arithmetic-" STRINGIFY(                                                   \
+                   name) " on `var` and `other` and returns a new MPFlt with the result.")        \
+    {                                                                                             \
+        if(args[1]->is<VarMPComplex>()) return complexArithRev(vm, loc, args[0], args[1], arith); \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big float " STRINGIFY(name));       \
+        VarMPFlt *lhs    = as<VarMPFlt>(args[0]);                                                 \
+        mpfr_prec_t prec = lhs->getPrec();                                                        \
+        if(args[1]->is<VarMPFlt>()) prec = resultPrec(prec, as<VarMPFlt>(args[1])->getPrec());    \
+        VarMPFlt *res = fltResult(vm, loc, args[0], args[1], prec);                               \
+        fltArith(res->getPtr(), lhs->getSrcPtr(), args[1], arith);                                \
+        return res;                                                                               \
+    }
+
+#define ARITHF_ASSN_FUNC(fn, name, arith)                                                      \
+    FERAL_FUNC(mpFltAssn##fn, 1, false,                                                        \
+               "  var.fn(other) -> var\n"                                                      \
+               "Applies arithmetic-" STRINGIFY(                                                \
+                   name) " on `var` with `other` and returns the updated `var`.")              \
+    {                                                                                          \
+        EXPECT_NO_CONST(args[0], "var");                                                       \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1],                                   \
+                "big float " STRINGIFY(name) "-assn");                                         \
+        fltArith(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), args[1], \
+                 arith);                                                                       \
+        return args[0];                                                                        \
+    }
+
+#define LOGICF_FUNC(fn, name, checksym)                                                   \
+    FERAL_FUNC(mpFlt##fn, 1, false,                                                       \
+               "  var.fn(other) -> Bool\n"                                                \
+               "Applies logical '" STRINGIFY(                                             \
+                   name) "' between `var` and `other` and returns the resulting Bool.")   \
+    {                                                                                     \
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1],                              \
+                "big float logical " STRINGIFY(name));                                    \
+        int cmp;                                                                          \
+        return fltCmp(as<VarMPFlt>(args[0])->getSrcPtr(), args[1], cmp) && cmp checksym 0 \
+                   ? vm.getTrue()                                                         \
+                   : vm.getFalse();                                                       \
+    }
+
+ARITHF_FUNC(Add, add, ArithOp::Add)
+ARITHF_FUNC(Sub, sub, ArithOp::Sub)
+ARITHF_FUNC(Mul, mul, ArithOp::Mul)
+ARITHF_FUNC(Div, div, ArithOp::Div)
+
+ARITHF_ASSN_FUNC(Add, add, ArithOp::Add)
+ARITHF_ASSN_FUNC(Sub, sub, ArithOp::Sub)
+ARITHF_ASSN_FUNC(Mul, mul, ArithOp::Mul)
+ARITHF_ASSN_FUNC(Div, div, ArithOp::Div)
+
+LOGICF_FUNC(LT, lt, <)
+LOGICF_FUNC(GT, gt, >)
+LOGICF_FUNC(LE, le, <=)
+LOGICF_FUNC(GE, ge, >=)
+
+FERAL_FUNC(mpFltEQ, 1, false,
+           "  var.fn(other) -> Bool\n"
+           "Returns `true` if `var` and `other` are equal.")
+{
+    int cmp;
+    if(args[1]->is<VarInt>() || args[1]->is<VarFlt>() || args[1]->is<VarMPInt>() ||
+       args[1]->is<VarMPFlt>())
+    {
+        return fltCmp(as<VarMPFlt>(args[0])->getSrcPtr(), args[1], cmp) && cmp == 0
+                   ? vm.getTrue()
+                   : vm.getFalse();
+    }
+    return vm.getFalse();
+}
+
+FERAL_FUNC(mpFltNE, 1, false,
+           "  var.fn(other) -> Bool\n"
+           "Returns `true` if `var` and `other` are not equal.")
+{
+    int cmp;
+    if(args[1]->is<VarInt>() || args[1]->is<VarFlt>() || args[1]->is<VarMPInt>() ||
+       args[1]->is<VarMPFlt>())
+    {
+        return fltCmp(as<VarMPFlt>(args[0])->getSrcPtr(), args[1], cmp) && cmp == 0
+                   ? vm.getFalse()
+                   : vm.getTrue();
+    }
+    return vm.getTrue();
+}
+
+FERAL_FUNC(mpFltPreInc, 0, false,
+           "  var.fn() -> var\n"
+           "Applies pre-increment on `var` and returns `var` itself.")
+{
+    mpfr_add_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
+                mpfr_get_default_rounding_mode());
+    return args[0];
+}
+
+FERAL_FUNC(mpFltPostInc, 0, false,
+           "  var.fn() -> MPFlt\n"
+           "Applies post-increment on `var` and returns a new MPFlt with `var` - 1 as the result.")
+{
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());
+    mpfr_add_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
+                mpfr_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpFltPreDec, 0, false,
+           "  var.fn() -> var\n"
+           "Applies pre-decrement on `var` and returns `var` itself.")
+{
+    mpfr_sub_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
+                mpfr_get_default_rounding_mode());
+    return args[0];
+}
+
+FERAL_FUNC(mpFltPostDec, 0, false,
+           "  var.fn() -> MPFlt\n"
+           "Applies post-decrement on `var` and returns a new MPFlt with `var` + 1 as the result.")
+{
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getPtr());
+    mpfr_sub_ui(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), 1,
+                mpfr_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpFltUSub, 0, false,
+           "  var.fn() -> MPFlt\n"
+           "Returns the negative equivalent of `var` as a new MPFlt.")
+{
+    VarMPFlt *res = fltResult(vm, loc, args[0], nullptr, as<VarMPFlt>(args[0])->getPrec());
+    mpfr_neg(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), mpfr_get_default_rounding_mode());
+    return res;
+}
+
+// Returns the rounding mode which rounds -x the way `rnd` rounds x.
+static inline mpfr_rnd_t negRnd(mpfr_rnd_t rnd)
+{
+    if(rnd == MPFR_RNDU) return MPFR_RNDD;
+    if(rnd == MPFR_RNDD) return MPFR_RNDU;
+    return rnd;
+}
+
+FERAL_FUNC(mpFltAddMul, 2, false,
+           "  var.fn(a, b) -> var\n"
+           "Adds `a` * `b` to `var` in place, with a single rounding (using fma), and returns the "
+           "updated `var`.")
+{
+    EXPECT_NO_CONST(args[0], "var");
+    EXPECT(VarMPFlt, args[1], "big float multiplicand");
+    EXPECT(VarMPFlt, args[2], "big float multiplier");
+    mpfr_fma(as<VarMPFlt>(args[0])->getPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),
+             as<VarMPFlt>(args[2])->getSrcPtr(), as<VarMPFlt>(args[0])->getSrcPtr(),
+             mpfr_get_default_rounding_mode());
+    return args[0];
+}
+
+FERAL_FUNC(mpFltSubMul, 2, false,
+           "  var.fn(a, b) -> var\n"
+           "Subtracts `a` * `b` from `var` in place, with a single rounding (using fms), and "
+           "returns the updated `var`.")
+{
+    EXPECT_NO_CONST(args[0], "var");
+    EXPECT(VarMPFlt, args[1], "big float multiplicand");
+    EXPECT(VarMPFlt, args[2], "big float multiplier");
+    mpfr_ptr acc = as<VarMPFlt>(args[0])->getPtr();
+    // var - a * b = -(a * b - var), and negation is exact.
+    mpfr_fms(acc, as<VarMPFlt>(args[1])->getSrcPtr(), as<VarMPFlt>(args[2])->getSrcPtr(), acc,
+             negRnd(mpfr_get_default_rounding_mode()));
+    mpfr_neg(acc, acc, MPFR_RNDN);
+    return args[0];
+}
+
+#define FMAF_FUNC(fn, name, sym)                                                           \
+    FERAL_FUNC(mpFlt##fn, 2, false,                                                        \
+               "  var.fn(a, b) -> MPFlt\n"                                                 \
+               "Returns `var` * `a` " sym " `b` as a new MPFlt, computed with a single "   \
+               "rounding.")                                                                \
+    {                                                                                      \
+        EXPECT(VarMPFlt, args[1], "big float multiplier");                                 \
+        EXPECT(VarMPFlt, args[2], "big float addend");                                     \
+        VarMPFlt *lhs    = as<VarMPFlt>(args[0]);                                          \
+        mpfr_prec_t prec = resultPrec(lhs->getPrec(), as<VarMPFlt>(args[1])->getPrec());   \
+        prec             = resultPrec(prec, as<VarMPFlt>(args[2])->getPrec());             \
+        VarMPFlt *res    = fltResult(vm, loc, args[0], args[1], prec);                     \
+        mpfr_##name(res->getPtr(), lhs->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),   \
+                    as<VarMPFlt>(args[2])->getSrcPtr(), mpfr_get_default_rounding_mode()); \
+        return res;                                                                        \
+    }
+
+FMAF_FUNC(FMA, fma, "+")
+FMAF_FUNC(FMS, fms, "-")
+
+FERAL_FUNC(mpFltSqr, 0, false,
+           "  var.fn() -> MPFlt\n"
+           "Returns the square of `var` as a new MPFlt.")
+{
+    VarMPFlt *res = fltResult(vm, loc, args[0], nullptr, as<VarMPFlt>(args[0])->getPrec());
+    mpfr_sqr(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), mpfr_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpFltRound, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Rounds `var` to the closest whole number and returns it as a new MPInt.")
+{
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    mpfr_get_z(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), MPFR_RNDN);
+    res->normalize();
+    return res;
+}
+
+// Raises `base` to the power of the Int / Flt / MPInt / MPFlt `exp` into `res`.
+static void fltPow(mpfr_ptr res, mpfr_srcptr base, Var *exp)
+{
+    if(exp->is<VarInt>()) {
+        mpfr_pow_si(res, base, as<VarInt>(exp)->getVal(), MPFR_RNDN);
+    } else if(exp->is<VarMPInt>()) {
+        VarMPInt *val = as<VarMPInt>(exp);
+        if(val->isSmall()) mpfr_pow_si(res, base, val->getSmall(), MPFR_RNDN);
+        else mpfr_pow_z(res, base, val->getSrcPtr(), MPFR_RNDN);
+    } else if(exp->is<VarFlt>()) {
+        MPFR_DECL_INIT(val, DBL_MANT_DIG);
+        mpfr_set_d(val, as<VarFlt>(exp)->getVal(), MPFR_RNDN);
+        mpfr_pow(res, base, val, MPFR_RNDN);
+    } else {
+        mpfr_pow(res, base, as<VarMPFlt>(exp)->getSrcPtr(), MPFR_RNDN);
+    }
+}
+
+FERAL_FUNC(mpFltPow, 1, false,
+           "  var.fn(other) -> MPFlt\n"
+           "Raises `var` to the power of `other` and returns a new MPFlt with the result.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "power");
+    VarMPFlt *lhs    = as<VarMPFlt>(args[0]);
+    mpfr_prec_t prec = lhs->getPrec();
+    if(args[1]->is<VarMPFlt>()) prec = resultPrec(prec, as<VarMPFlt>(args[1])->getPrec());
+    VarMPFlt *res = fltResult(vm, loc, args[0], args[1], prec);
+    fltPow(res->getPtr(), lhs->getSrcPtr(), args[1]);
+    return res;
+}
+
+FERAL_FUNC(mpFltRoot, 1, false,
+           "  var.fn(other) -> MPFlt\n"
+           "Lowers `var` to the root of `other` and returns a new MPFlt with the result.")
+{
+    EXPECT2(VarInt, VarMPInt, args[1], "root");
+    VarMPFlt *res   = fltResult(vm, loc, args[0], nullptr, as<VarMPFlt>(args[0])->getPrec());
+    unsigned long n = IntOperand(args[1]).getUi();
+#if MPFR_VERSION_MAJOR >= 4
+    mpfr_rootn_ui(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), n, MPFR_RNDN);
+#else
+    mpfr_root(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), n, MPFR_RNDN);
+#endif // MPFR_VERSION_MAJOR
+    return res;
+}
+
+FERAL_FUNC(mpFltToFlt, 0, false,
+           "  var.fn() -> Flt\n"
+           "Converts `var` from MPInt to Flt and returns the value.")
+{
+    return vm.makeVar<VarFlt>(loc, mpfr_get_d(as<VarMPFlt>(args[0])->getPtr(), MPFR_RNDN));
+}
+
+FERAL_FUNC(mpFltGetPrec, 0, false,
+           "  var.fn() -> Int\n"
+           "Returns the precision (in bits) of `var`.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)as<VarMPFlt>(args[0])->getPrec());
+}
+
+FERAL_FUNC(mpFltWithPrec, 1, false,
+           "  var.fn(bits) -> MPFlt\n"
+           "Returns a new MPFlt with the value of `var` rounded to `bits` precision.")
+{
+    EXPECT(VarInt, args[1], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[1], false, prec)) return nullptr;
+    return vm.makeVar<VarMPFlt>(loc, as<VarMPFlt>(args[0])->getSrcPtr(), prec);
+}
+
+// Floats with a decimal exponent within this bound are printed in positional notation (123.45),
+// and the rest in scientific notation (1.2345e30).
+static constexpr mpfr_exp_t FLT_STR_MAX_POSITIONAL_EXPO = 25;
+
+// Writes `val` to `str` (rounding its digits with `rnd`) - in positional notation if its decimal
+// exponent is small enough, otherwise in scientific notation.
+static void fltToStr(mpfr_srcptr val, mpfr_rnd_t rnd, String &str)
+{
+    if(mpfr_nan_p(val)) {
+        str = "nan";
+        return;
+    }
+    if(mpfr_inf_p(val)) {
+        str = mpfr_signbit(val) ? "-inf" : "inf";
+        return;
+    }
+    if(mpfr_zero_p(val)) {
+        str = mpfr_signbit(val) ? "-0.0" : "0.0";
+        return;
+    }
+
+    // Same as mpfr_get_str_ndigits(10, prec), which is only available since MPFR 4.1.
+    size_t digits = 1 + (size_t)std::ceil(mpfr_get_prec(val) * 0.30102999566398119521);
+    // mpfr_get_str() needs space for the sign and the null terminator, and at least 7 bytes.
+    Vector<char> buf(std::max(digits + 2, (size_t)7));
+    mpfr_exp_t expo;
+    mpfr_get_str(buf.data(), &expo, 10, digits, val, rnd);
+    // The value is 0.[mant] * 10^expo, where the first digit of mant is not zero.
+    const char *mant = buf.data();
+    bool neg         = *mant == '-';
+    if(neg) ++mant;
+    size_t len = digits;
+    while(len > 1 && mant[len - 1] == '0') --len;
+
+    str.clear();
+    if(neg) str += '-';
+    if(expo > FLT_STR_MAX_POSITIONAL_EXPO || expo < -FLT_STR_MAX_POSITIONAL_EXPO) {
+        str.reserve(len + 24);
+        str += mant[0];
+        str += '.';
+        if(len > 1) str.append(mant + 1, len - 1);
+        else str += '0';
+        str += 'e';
+        str += std::to_string(expo - 1);
+    } else if(expo <= 0) {
+        str.reserve(len - expo + 3);
+        str += "0.";
+        str.append(-expo, '0');
+        str.append(mant, len);
+    } else if((size_t)expo >= len) {
+        str.reserve(expo + 3);
+        str.append(mant, len);
+        str.append(expo - len, '0');
+        str += ".0";
+    } else {
+        str.reserve(len + 2);
+        str.append(mant, expo);
+        str += '.';
+        str.append(mant + expo, len - expo);
+    }
+}
+
+FERAL_FUNC(mpFltToStr, 0, false,
+           "  var.fn() -> Str\n"
+           "Converts `var` from MPFlt to Str and returns the value.")
+{
+    VarStr *res = vm.makeVar<VarStr>(loc, "");
+    fltToStr(as<VarMPFlt>(args[0])->getSrcPtr(), mpfr_get_default_rounding_mode(), res->getVal());
+    return res;
+}
+
+// RNG
+
+FERAL_FUNC(mpFltRngGet, 2, false,
+           "  fn(upto, state) -> MPFlt\n"
+           "Returns a random number between [0.0, `upto`], generated using the RandState `state`, "
+           "or the thread's default one if it is nil.")
+{
+    EXPECT(VarMPFlt, args[1], "upper bound");
+    EXPECT2(VarNil, VarRandState, args[2], "random state");
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, as<VarMPFlt>(args[1])->getPrec());
+    mpfr_urandom(res->getPtr(), getRandStateArg(args[2]), MPFR_RNDN);
+    mpfr_mul(res->getPtr(), res->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(), MPFR_RNDN);
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// Complex Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+FERAL_FUNC(mpComplexNewNative, 3, false,
+           "  fn(real, virtual, precision) -> MPComplex\n"
+           "Creates and returns a new MPComplex using `real` and `virtual` value, with "
+           "`precision` bits.\n"
+           "Here `real` and `virtual` can be either of MPInt / MPFlt\n"
+           "If `precision` is 0, the default precision is used.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "real value");
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[2], "virtual value");
+    EXPECT(VarInt, args[3], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[3], true, prec)) return nullptr;
+    if(args[1]->getType() != args[2]->getType()) {
+        vm.fail(loc, "the real and imaginary arguments must be of same type, found: (",
+                vm.getTypeName(args[1]), ", ", vm.getTypeName(args[2]), ")");
+        return nullptr;
+    }
+
+    Var *a1           = args[1];
+    Var *a2           = args[2];
+    VarMPComplex *res = nullptr;
+
+    if(a1->is<VarInt>()) {
+        res = vm.makeVar<VarMPComplex>(loc, as<VarInt>(a1)->getVal(), as<VarInt>(a2)->getVal(),
+                                       prec);
+    } else if(a1->is<VarFlt>()) {
+        res = vm.makeVar<VarMPComplex>(loc, as<VarFlt>(a1)->getVal(), as<VarFlt>(a2)->getVal(),
+                                       prec);
+    } else if(a1->is<VarMPInt>()) {
+        res = vm.makeVar<VarMPComplex>(loc, as<VarMPInt>(a1)->getSrcPtr(),
+                                       as<VarMPInt>(a2)->getSrcPtr(), prec);
+    } else if(a1->is<VarMPFlt>()) {
+        res = vm.makeVar<VarMPComplex>(loc, as<VarMPFlt>(a1)->getSrcPtr(),
+                                       as<VarMPFlt>(a2)->getSrcPtr(), prec);
+    }
+
+    return res;
+}
+
+FERAL_FUNC(mpComplexCopy, 1, false,
+           "  var.fn() -> MPComplex\n"
+           "Creates a new instance of `var` and returns it.")
+{
+    return vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
+}
+
+// Result precision of a binary operation between the MPComplex `lhs` and `rhs`.
+static mpfr_prec_t complexResultPrec(Var *lhs, Var *rhs)
+{
+    mpfr_prec_t prec = as<VarMPComplex>(lhs)->getPrec();
+    if(rhs->is<VarMPFlt>()) return resultPrec(prec, as<VarMPFlt>(rhs)->getPrec());
+    if(rhs->is<VarMPComplex>()) return resultPrec(prec, as<VarMPComplex>(rhs)->getPrec());
+    return prec;
+}
+
+static inline bool hasComplexPrec(Var *var, mpfr_prec_t prec)
+{
+    mpc_srcptr val = as<VarMPComplex>(var)->getSrcPtr();
+    return mpfr_get_prec(mpc_realref(val)) == prec && mpfr_get_prec(mpc_imagref(val)) == prec;
+}
+
+// Returns an MPComplex to store the result of a binary operation on the MPComplex `lhs` and `rhs`
+// - one of the operands if it is a temporary of the result precision, otherwise a new one.
+static VarMPComplex *complexResult(VirtualMachine &vm, ModuleLoc loc, Var *lhs, Var *rhs)
+{
+    mpfr_prec_t prec = complexResultPrec(lhs, rhs);
+    if(isTemporary(lhs) && hasComplexPrec(lhs, prec)) return as<VarMPComplex>(lhs);
+    if(rhs->is<VarMPComplex>() && isTemporary(rhs) && hasComplexPrec(rhs, prec)) {
+        return as<VarMPComplex>(rhs);
+    }
+    return vm.makeVar<VarMPComplex>(loc, prec);
+}
+
+#define LOGICC_FUNC(fn, name, sym)                                                      \
+    FERAL_FUNC(mpComplex##fn, 1, false,                                                 \
+               "  var.fn(other) -> Bool\n"                                              \
+               "Applies logical '" STRINGIFY(                                           \
+                   name) "' between `var` and `other` and returns the resulting Bool.") \
+    {                                                                                   \
+        if(args[1]->is<VarMPComplex>()) {                                               \
+            return mpc_cmp(as<VarMPComplex>(args[0])->getSrcPtr(),                      \
+                           as<VarMPComplex>(args[1])->getSrcPtr()) sym 0                \
+                       ? vm.getTrue()                                                   \
+                       : vm.getFalse();                                                 \
+        }                                                                               \
+        return vm.getFalse();                                                           \
+    }
+
+LOGICC_FUNC(LT, lt, <)
+LOGICC_FUNC(GT, gt, >)
+LOGICC_FUNC(LE, le, <=)
+LOGICC_FUNC(GE, ge, >=)
+
+#define ARITHC_FUNC(fn, name, opname, arith)                                                   \
+    FERAL_FUNC(mpComplex##fn, 1, false,                                                        \
+               "  var.fn(other) -> MPComplex\n"                                                \
+               "Applies arithmetic-" STRINGIFY(                                                \
+                   name) " on `var` and `other` and returns a new MPComplex with the result.") \
+    {                                                                                          \
+        if(!args[1]->is<VarMPComplex>()) {                                                     \
+            EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "complex " opname);           \
+        }                                                                                      \
+        VarMPComplex *res = complexResult(vm, loc, args[0], args[1]);                          \
+        complexArith(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), args[1], arith,    \
+                     false);                                                                   \
+        return res;                                                                            \
+    }
+
+#define ARITHC_ASSN_FUNC(fn, name, opname, arith)                                            \
+    FERAL_FUNC(mpComplexAssn##fn, 1, false,                                                  \
+               "  var.fn(other) -> var\n"                                                    \
+               "Applies arithmetic-" STRINGIFY(                                              \
+                   name) " on `var` with `other` and returns the updated `var`.")            \
+    {                                                                                        \
+        EXPECT_NO_CONST(args[0], "var");                                                     \
+        if(!args[1]->is<VarMPComplex>()) {                                                   \
+            EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "complex " opname "-assn"); \
+        }                                                                                    \
+        VarMPComplex *base = as<VarMPComplex>(args[0]);                                      \
+        complexArith(base->getPtr(), base->getSrcPtr(), args[1], arith, false);              \
+        return base;                                                                         \
+    }
+
+ARITHC_FUNC(Add, add, "addition", ArithOp::Add)
+ARITHC_FUNC(Sub, sub, "subtraction", ArithOp::Sub)
+ARITHC_FUNC(Mul, mul, "multiplication", ArithOp::Mul)
+ARITHC_FUNC(Div, div, "division", ArithOp::Div)
+
+ARITHC_ASSN_FUNC(Add, add, "addition", ArithOp::Add)
+ARITHC_ASSN_FUNC(Sub, sub, "subtraction", ArithOp::Sub)
+ARITHC_ASSN_FUNC(Mul, mul, "multiplication", ArithOp::Mul)
+ARITHC_ASSN_FUNC(Div, div, "division", ArithOp::Div)
+
+// Returns true if the MPComplex `lhs` is equal to `rhs` - a real `rhs` is equal if the imaginary
+// part of `lhs` is zero.
+static bool complexEq(VarMPComplex *lhs, Var *rhs)
+{
+    if(rhs->is<VarMPComplex>()) {
+        mpc_srcptr l = lhs->getSrcPtr(), r = as<VarMPComplex>(rhs)->getSrcPtr();
+        // mpc_cmp() reports NaNs as equal.
+        return mpfr_equal_p(mpc_realref(l), mpc_realref(r)) &&
+               mpfr_equal_p(mpc_imagref(l), mpc_imagref(r));
+    }
+    int cmp;
+    return mpfr_zero_p(mpc_imagref(lhs->getSrcPtr())) &&
+           fltCmp(mpc_realref(lhs->getSrcPtr()), rhs, cmp) && cmp == 0;
+}
+
+FERAL_FUNC(mpComplexEQ, 1, false,
+           "  var.fn(other) -> Bool\n"
+           "Returns `true` if `var` and `other` are equal.")
+{
+    if(args[1]->is<VarInt>() || args[1]->is<VarFlt>() || args[1]->is<VarMPInt>() ||
+       args[1]->is<VarMPFlt>() || args[1]->is<VarMPComplex>())
+    {
+        return complexEq(as<VarMPComplex>(args[0]), args[1]) ? vm.getTrue() : vm.getFalse();
+    }
+    return vm.getFalse();
+}
+
+FERAL_FUNC(mpComplexNE, 1, false,
+           "  var.fn(other) -> Bool\n"
+           "Returns `true` if `var` and `other` are not equal.")
+{
+    if(args[1]->is<VarInt>() || args[1]->is<VarFlt>() || args[1]->is<VarMPInt>() ||
+       args[1]->is<VarMPFlt>() || args[1]->is<VarMPComplex>())
+    {
+        return complexEq(as<VarMPComplex>(args[0]), args[1]) ? vm.getFalse() : vm.getTrue();
+    }
+    return vm.getTrue();
+}
+
+FERAL_FUNC(mpComplexPreInc, 0, false,
+           "  var.fn() -> var\n"
+           "Applies pre-increment on `var` and returns `var` itself.")
+{
+    mpc_add_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
+               mpc_get_default_rounding_mode());
+    return args[0];
+}
+
+FERAL_FUNC(
+    mpComplexPostInc, 0, false,
+    "  var.fn() -> MPComplex\n"
+    "Applies post-increment on `var` and returns a new MPComplex with `var` - 1 as the result.")
+{
+    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
+    mpc_add_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
+               mpc_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpComplexPreDec, 0, false,
+           "  var.fn() -> var\n"
+           "Applies pre-decrement on `var` and returns `var` itself.")
+{
+    mpc_sub_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
+               mpc_get_default_rounding_mode());
+    return args[0];
+}
+
+FERAL_FUNC(
+    mpComplexPostDec, 0, false,
+    "  var.fn() -> MPComplex\n"
+    "Applies post-decrement on `var` and returns a new MPComplex with `var` + 1 as the result.")
+{
+    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
+    mpc_sub_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
+               mpc_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpComplexUSub, 0, false,
+           "  var.fn() -> MPComplex\n"
+           "Returns the negative equivalent of `var` as a new MPComplex.")
+{
+    VarMPComplex *res = as<VarMPComplex>(args[0]);
+    if(!isTemporary(args[0])) res = vm.makeVar<VarMPComplex>(loc, res->getSrcPtr());
+    mpc_neg(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), mpc_get_default_rounding_mode());
+    return res;
+}
+
+// Raises `base` to the power of the Int / Flt / MPInt / MPFlt / MPComplex `exp` into `res`.
+static void complexPow(mpc_ptr res, mpc_srcptr base, Var *exp)
+{
+    mpc_rnd_t rnd = mpc_get_default_rounding_mode();
+    if(exp->is<VarInt>()) {
+        mpc_pow_si(res, base, as<VarInt>(exp)->getVal(), rnd);
+    } else if(exp->is<VarFlt>()) {
+        mpc_pow_d(res, base, as<VarFlt>(exp)->getVal(), rnd);
+    } else if(exp->is<VarMPInt>()) {
+        VarMPInt *val = as<VarMPInt>(exp);
+        if(val->isSmall()) mpc_pow_si(res, base, val->getSmall(), rnd);
+        else mpc_pow_z(res, base, val->getSrcPtr(), rnd);
+    } else if(exp->is<VarMPFlt>()) {
+        mpc_pow_fr(res, base, as<VarMPFlt>(exp)->getSrcPtr(), rnd);
+    } else {
+        mpc_pow(res, base, as<VarMPComplex>(exp)->getSrcPtr(), rnd);
+    }
+}
+
+FERAL_FUNC(mpComplexPow, 1, false,
+           "  var.fn(other) -> MPComplex\n"
+           "Raises `var` to the power of `other` and returns a new MPComplex with the result.")
+{
+    if(!args[1]->is<VarMPComplex>()) {
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "complex power");
+    }
+    VarMPComplex *res = complexResult(vm, loc, args[0], args[1]);
+    complexPow(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), args[1]);
+    return res;
+}
+
+FERAL_FUNC(mpComplexFMA, 2, false,
+           "  var.fn(a, b) -> MPComplex\n"
+           "Returns `var` * `a` + `b` as a new MPComplex, computed with a single rounding.")
+{
+    EXPECT(VarMPComplex, args[1], "complex multiplier");
+    EXPECT(VarMPComplex, args[2], "complex addend");
+    // Like the MPFlt fma, the precision of the addend counts too.
+    mpfr_prec_t prec  = resultPrec(complexResultPrec(args[0], args[1]),
+                                   as<VarMPComplex>(args[2])->getPrec());
+    VarMPComplex *res = nullptr;
+    for(size_t i = 0; !res && i < 3; ++i) {
+        if(isTemporary(args[i]) && hasComplexPrec(args[i], prec)) res = as<VarMPComplex>(args[i]);
+    }
+    if(!res) res = vm.makeVar<VarMPComplex>(loc, prec);
+    mpc_fma(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
+            as<VarMPComplex>(args[1])->getSrcPtr(), as<VarMPComplex>(args[2])->getSrcPtr(),
+            mpc_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpComplexSqr, 0, false,
+           "  var.fn() -> MPComplex\n"
+           "Returns the square of `var` as a new MPComplex.")
+{
+    VarMPComplex *res = as<VarMPComplex>(args[0]);
+    if(!isTemporary(args[0])) res = vm.makeVar<VarMPComplex>(loc, res->getPrec());
+    mpc_sqr(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), mpc_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpComplexAbs, 0, false,
+           "  var.fn() -> MPFlt\n"
+           "Returns the absolute float value of `var` as a new MPFlt.")
+{
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, as<VarMPComplex>(args[0])->getPrec());
+    mpc_abs(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
+            mpfr_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpComplexGetPrec, 0, false,
+           "  var.fn() -> Int\n"
+           "Returns the precision (in bits) of `var`.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)as<VarMPComplex>(args[0])->getPrec());
+}
+
+FERAL_FUNC(mpComplexWithPrec, 1, false,
+           "  var.fn(bits) -> MPComplex\n"
+           "Returns a new MPComplex with the value of `var` rounded to `bits` precision.")
+{
+    EXPECT(VarInt, args[1], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[1], false, prec)) return nullptr;
+    return vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr(), prec);
+}
+
+FERAL_FUNC(mpComplexSet, 2, false,
+           "  var.fn(real, virtual) -> var\n"
+           "Updates the `real` and `virtual` parts of the MPComplex `var` and returns itself.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "real value");
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[2], "virtual value");
+    if(args[1]->getType() != args[2]->getType()) {
+        vm.fail(loc, "the real and imaginary arguments must be of same type, found: (",
+                vm.getTypeName(args[1]), ", ", vm.getTypeName(args[2]), ")");
+        return nullptr;
+    }
+
+    Var *a1           = args[1];
+    Var *a2           = args[2];
+    VarMPComplex *res = as<VarMPComplex>(args[0]);
+
+    if(a1->is<VarInt>()) {
+        mpc_set_si_si(res->getPtr(), as<VarInt>(a1)->getVal(), as<VarInt>(a2)->getVal(),
+                      mpc_get_default_rounding_mode());
+    } else if(a1->is<VarFlt>()) {
+        mpc_set_ld_ld(res->getPtr(), as<VarFlt>(a1)->getVal(), as<VarFlt>(a2)->getVal(),
+                      mpc_get_default_rounding_mode());
+    } else if(a1->is<VarMPInt>()) {
+        mpc_set_z_z(res->getPtr(), as<VarMPInt>(a1)->getSrcPtr(), as<VarMPInt>(a2)->getSrcPtr(),
+                    mpc_get_default_rounding_mode());
+    } else if(a1->is<VarMPFlt>()) {
+        mpc_set_fr_fr(res->getPtr(), as<VarMPFlt>(a1)->getSrcPtr(), as<VarMPFlt>(a2)->getSrcPtr(),
+                      mpc_get_default_rounding_mode());
+    }
+
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////// Lazy Functions ////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Expressions deeper than this have their operands evaluated when they are built, which bounds
+// the recursion of the evaluator (for example, for expressions built in a loop).
+static constexpr size_t EXPR_MAX_DEPTH = 256;
+
+// Fetches the kind of expression which `var` is (or can be an operand of) into `kind`, returning
+// false if `var` is not an MP value or expression.
+static bool getExprKind(Var *var, VarMPExpr::Kind &kind)
+{
+    if(var->is<VarMPExpr>()) kind = as<VarMPExpr>(var)->getKind();
+    else if(var->is<VarMPInt>()) kind = VarMPExpr::Kind::Int;
+    else if(var->is<VarMPFlt>()) kind = VarMPExpr::Kind::Flt;
+    else if(var->is<VarMPComplex>()) kind = VarMPExpr::Kind::Complex;
+    else return false;
+    return true;
+}
+
+// Returns the MP value `var` is if it is one (or an expression of just one), otherwise nullptr.
+static inline Var *exprValue(Var *var)
+{
+    if(!var->is<VarMPExpr>()) return var;
+    VarMPExpr *expr = as<VarMPExpr>(var);
+    return expr->getOp() == VarMPExpr::Op::Val ? expr->getLHS() : nullptr;
+}
+
+static inline bool isExprOp(Var *var, VarMPExpr::Op op)
+{
+    return var->is<VarMPExpr>() && as<VarMPExpr>(var)->getOp() == op;
+}
+
+// Counts the uses of each node (other than values) of the expression `var` into `uses`, visiting
+// each node only once - expressions are DAGs, where a shared node may be reached through many
+// paths.
+static void countExprUses(Var *var, Map<Var *, size_t> &uses)
+{
+    if(exprValue(var) || uses[var]++ > 0) return;
+    VarMPExpr *expr = as<VarMPExpr>(var);
+    countExprUses(expr->getLHS(), uses);
+    if(expr->getRHS()) countExprUses(expr->getRHS(), uses);
+}
+
+static mpfr_prec_t valuePrec(Var *val)
+{
+    if(val->is<VarMPFlt>()) return as<VarMPFlt>(val)->getPrec();
+    if(val->is<VarMPComplex>()) return as<VarMPComplex>(val)->getPrec();
+    return 0;
+}
+
+// Returns the precision of the float / complex expression `var` - the largest precision of its
+// values, as with eager operations.
+static mpfr_prec_t exprPrec(Var *var)
+{
+    Var *val = exprValue(var);
+    if(val) return valuePrec(val);
+    Map<Var *, size_t> nodes;
+    countExprUses(var, nodes);
+    mpfr_prec_t prec = 0;
+    for(auto &node : nodes) {
+        VarMPExpr *expr = as<VarMPExpr>(node.first);
+        if((val = exprValue(expr->getLHS()))) prec = resultPrec(prec, valuePrec(val));
+        if(expr->getRHS() && (val = exprValue(expr->getRHS()))) {
+            prec = resultPrec(prec, valuePrec(val));
+        }
+    }
+    return prec;
+}
+
+// Returns true if the MP value `val` is used by `var`.
+static bool exprUses(Var *var, Var *val)
+{
+    Var *varVal = exprValue(var);
+    if(varVal) return varVal == val;
+    Map<Var *, size_t> nodes;
+    countExprUses(var, nodes);
+    for(auto &node : nodes) {
+        VarMPExpr *expr = as<VarMPExpr>(node.first);
+        if(exprValue(expr->getLHS()) == val) return true;
+        if(expr->getRHS() && exprValue(expr->getRHS()) == val) return true;
+    }
+    return false;
+}
+
+// Operations of each kind of expression, used by MPExprEval.
+// The fused ones compute r = a * b + c (mulAdd), r = a * b - c (mulSub), and r = c - a * b
+// (subMul), where only `c` may be the same as `r`.
+
+struct IntExprOps
+{
+    using Val = __mpz_struct;
+    using Ptr = mpz_ptr;
+    using Src = mpz_srcptr;
+
+    static constexpr bool hasFusedSub = true;
+
+    static inline void init(Ptr r, mpfr_prec_t prec) { pool.initInt(r); }
+    static inline void clear(Ptr r) { pool.clearInt(r); }
+    static inline Src get(Var *var) { return as<VarMPInt>(var)->getSrcPtr(); }
+    static inline int cmp(Src a, Src b) { return mpz_cmp(a, b); }
+
+    static inline void set(Ptr r, Src a) { mpz_set(r, a); }
+    static inline void neg(Ptr r, Src a) { mpz_neg(r, a); }
+    static inline void sqr(Ptr r, Src a) { intMul(r, a, a); }
+    static inline void add(Ptr r, Src a, Src b) { mpz_add(r, a, b); }
+    static inline void sub(Ptr r, Src a, Src b) { mpz_sub(r, a, b); }
+    static inline void mul(Ptr r, Src a, Src b) { intMul(r, a, b); }
+    // Same as mpIntDiv() - fails on division by zero.
+    static inline bool div(Ptr r, Src a, Src b)
+    {
+        if(mpz_sgn(b) == 0) return false;
+        mpz_fdiv_q(r, a, b);
+        return true;
+    }
+    static inline void mulAdd(Ptr r, Src a, Src b, Src c)
+    {
+        if(r != c) mpz_set(r, c);
+        mpz_addmul(r, a, b);
+    }
+    static inline void mulSub(Ptr r, Src a, Src b, Src c)
+    {
+        subMul(r, c, a, b);
+        mpz_neg(r, r);
+    }
+    static inline void subMul(Ptr r, Src c, Src a, Src b)
+    {
+        if(r != c) mpz_set(r, c);
+        mpz_submul(r, a, b);
+    }
+};
+
+struct FltExprOps
+{
+    using Val = __mpfr_struct;
+    using Ptr = mpfr_ptr;
+    using Src = mpfr_srcptr;
+
+    static constexpr bool hasFusedSub = true;
+
+    static inline void init(Ptr r, mpfr_prec_t prec) { pool.initFlt(r, prec); }
+    static inline void clear(Ptr r) { pool.clearFlt(r); }
+    static inline Src get(Var *var) { return as<VarMPFlt>(var)->getSrcPtr(); }
+    static inline int cmp(Src a, Src b) { return mpfr_cmp(a, b); }
+
+    static inline void set(Ptr r, Src a) { mpfr_set(r, a, mpfr_get_default_rounding_mode()); }
+    static inline void neg(Ptr r, Src a) { mpfr_neg(r, a, mpfr_get_default_rounding_mode()); }
+    static inline void sqr(Ptr r, Src a) { mpfr_sqr(r, a, mpfr_get_default_rounding_mode()); }
+    static inline void add(Ptr r, Src a, Src b)
+    {
+        mpfr_add(r, a, b, mpfr_get_default_rounding_mode());
+    }
+    static inline void sub(Ptr r, Src a, Src b)
+    {
+        mpfr_sub(r, a, b, mpfr_get_default_rounding_mode());
+    }
+    static inline void mul(Ptr r, Src a, Src b)
+    {
+        mpfr_mul(r, a, b, mpfr_get_default_rounding_mode());
+    }
+    static inline bool div(Ptr r, Src a, Src b)
+    {
+        mpfr_div(r, a, b, mpfr_get_default_rounding_mode());
+        return true;
+    }
+    static inline void mulAdd(Ptr r, Src a, Src b, Src c)
+    {
+        mpfr_fma(r, a, b, c, mpfr_get_default_rounding_mode());
+    }
+    static inline void mulSub(Ptr r, Src a, Src b, Src c)
+    {
+        mpfr_fms(r, a, b, c, mpfr_get_default_rounding_mode());
+    }
+    // Same as mpFltSubMul().
+    static inline void subMul(Ptr r, Src c, Src a, Src b)
+    {
+        mpfr_fms(r, a, b, c, negRnd(mpfr_get_default_rounding_mode()));
+        mpfr_neg(r, r, MPFR_RNDN);
+    }
+};
+
+// MPC has no fused multiply-subtract, so subtractions are never fused.
+struct ComplexExprOps
+{
+    using Val = __mpc_struct;
+    using Ptr = mpc_ptr;
+    using Src = mpc_srcptr;
+
+    static constexpr bool hasFusedSub = false;
+
+    static inline void init(Ptr r, mpfr_prec_t prec) { pool.initComplex(r, prec); }
+    static inline void clear(Ptr r) { pool.clearComplex(r); }
+    static inline Src get(Var *var) { return as<VarMPComplex>(var)->getSrcPtr(); }
+    static inline int cmp(Src a, Src b) { return mpc_cmp(a, b); }
+
+    static inline void set(Ptr r, Src a) { mpc_set(r, a, mpc_get_default_rounding_mode()); }
+    static inline void neg(Ptr r, Src a) { mpc_neg(r, a, mpc_get_default_rounding_mode()); }
+    static inline void sqr(Ptr r, Src a) { mpc_sqr(r, a, mpc_get_default_rounding_mode()); }
+    static inline void add(Ptr r, Src a, Src b)
+    {
+        mpc_add(r, a, b, mpc_get_default_rounding_mode());
+    }
+    static inline void sub(Ptr r, Src a, Src b)
+    {
+        mpc_sub(r, a, b, mpc_get_default_rounding_mode());
+    }
+    static inline void mul(Ptr r, Src a, Src b)
+    {
+        mpc_mul(r, a, b, mpc_get_default_rounding_mode());
+    }
+    static inline bool div(Ptr r, Src a, Src b)
+    {
+        mpc_div(r, a, b, mpc_get_default_rounding_mode());
+        return true;
+    }
+    static inline void mulAdd(Ptr r, Src a, Src b, Src c)
+    {
+        mpc_fma(r, a, b, c, mpc_get_default_rounding_mode());
+    }
+};
+
+// Evaluates expressions of one kind (using `Ops`), with intermediate results stored in scratch
+// values which are reused across the nodes (and taken from the pool in the first place), except
+// for the nodes used more than once, whose values are kept so that each is only evaluated once.
+// Products which are added to / subtracted from something are fused with the addition /
+// subtraction, and products of a value by itself become squares.
+template<typename Ops> class MPExprEval
+{
+    using Val = typename Ops::Val;
+    using Ptr = typename Ops::Ptr;
+    using Src = typename Ops::Src;
+
+    // A scratch value, which is only taken when first used, and given back when done with.
+    struct Scratch
+    {
+        MPExprEval &eval;
+        Val val;
+        bool isTaken;
+
+        Scratch(MPExprEval &eval) : eval(eval), isTaken(false) {}
+        ~Scratch()
+        {
+            if(isTaken) eval.freeVals.push_back(val);
+        }
+        Ptr get()
+        {
+            if(isTaken) return &val;
+            isTaken = true;
+            if(eval.freeVals.empty()) {
+                Ops::init(&val, eval.prec);
+            } else {
+                val = eval.freeVals.back();
+                eval.freeVals.pop_back();
+            }
+            return &val;
+        }
+    };
+
+    Vector<Val> freeVals;
+    // Uses of each node of the evaluated expressions, and the values of the nodes used more than
+    // once, so that those are only evaluated once.
+    Map<Var *, size_t> uses;
+    Map<Var *, Val> sharedVals;
+    mpfr_prec_t prec;
+
+    inline bool isShared(Var *var)
+    {
+        auto it = uses.find(var);
+        return it != uses.end() && it->second > 1;
+    }
+
+    // Fetches the value of the shared node `var` into `res`, evaluating it the first time.
+    bool sharedOperand(Var *var, Src &res)
+    {
+        auto it = sharedVals.find(var);
+        if(it != sharedVals.end()) {
+            res = &it->second;
+            return true;
+        }
+        // References to map elements stay valid as the map grows.
+        Ptr val = &sharedVals[var];
+        Ops::init(val, prec);
+        res = val;
+        return evalNode(var, val);
+    }
+
+    // Fetches the value of `var` into `res` - directly if it is an MP value or a shared node,
+    // otherwise after evaluating it into `dst`.
+    bool operand(Var *var, Ptr dst, Src &res)
+    {
+        Var *val = exprValue(var);
+        if(val) {
+            res = Ops::get(val);
+            return true;
+        }
+        if(isShared(var)) return sharedOperand(var, res);
+        res = dst;
+        return evalNode(var, dst);
+    }
+    bool operand(Var *var, Scratch &scratch, Src &res)
+    {
+        Var *val = exprValue(var);
+        if(val) {
+            res = Ops::get(val);
+            return true;
+        }
+        if(isShared(var)) return sharedOperand(var, res);
+        res = scratch.get();
+        return evalNode(var, scratch.get());
+    }
+
+    // Computes `mul` * `mul`'s RHS with `other` as given by `fused` (see IntExprOps) into `dst`.
+    bool evalFused(VarMPExpr *mul, Var *other, Ptr dst,
+                   void (*fused)(Ptr r, Src a, Src b, Src c))
+    {
+        Scratch lhsScratch(*this), rhsScratch(*this);
+        Src a, b, c;
+        if(!operand(other, dst, c)) return false;
+        if(!operand(mul->getLHS(), lhsScratch, a)) return false;
+        if(!operand(mul->getRHS(), rhsScratch, b)) return false;
+        fused(dst, a, b, c);
+        return true;
+    }
+
+    // Returns true if `var` is a product which can be fused with the addition / subtraction it is
+    // an operand of - shared products are evaluated (once) on their own instead.
+    inline bool isFusable(Var *var) { return isExprOp(var, VarMPExpr::Op::Mul) && !isShared(var); }
+
+    // Evaluates the node `var` (which must not use `dst`) into `dst`.
+    bool evalNode(Var *var, Ptr dst)
+    {
+        Var *val = exprValue(var);
+        if(val) {
+            Ops::set(dst, Ops::get(val));
+            return true;
+        }
+        VarMPExpr *expr = as<VarMPExpr>(var);
+        Var *lhs = expr->getLHS(), *rhs = expr->getRHS();
+        VarMPExpr::Op op = expr->getOp();
+        Src a, b;
+        if(op == VarMPExpr::Op::Neg) {
+            if(!operand(lhs, dst, a)) return false;
+            Ops::neg(dst, a);
+            return true;
+        }
+        if(op == VarMPExpr::Op::Add) {
+            if(isFusable(lhs)) return evalFused(as<VarMPExpr>(lhs), rhs, dst, Ops::mulAdd);
+            if(isFusable(rhs)) return evalFused(as<VarMPExpr>(rhs), lhs, dst, Ops::mulAdd);
+        }
+        if constexpr(Ops::hasFusedSub) {
+            if(op == VarMPExpr::Op::Sub && isFusable(lhs)) {
+                return evalFused(as<VarMPExpr>(lhs), rhs, dst, Ops::mulSub);
+            }
+            if(op == VarMPExpr::Op::Sub && isFusable(rhs)) {
+                return evalFused(as<VarMPExpr>(rhs), lhs, dst,
+                                 [](Ptr r, Src a, Src b, Src c) { Ops::subMul(r, c, a, b); });
+            }
+        }
+        if(!operand(lhs, dst, a)) return false;
+        if(op == VarMPExpr::Op::Mul && (lhs == rhs || (exprValue(lhs) == exprValue(rhs) &&
+                                                       exprValue(lhs) != nullptr)))
+        {
+            Ops::sqr(dst, a);
+            return true;
+        }
+        Scratch rhsScratch(*this);
+        if(!operand(rhs, rhsScratch, b)) return false;
+        switch(op) {
+        case VarMPExpr::Op::Add: Ops::add(dst, a, b); break;
+        case VarMPExpr::Op::Sub: Ops::sub(dst, a, b); break;
+        case VarMPExpr::Op::Mul: Ops::mul(dst, a, b); break;
+        case VarMPExpr::Op::Div: return Ops::div(dst, a, b);
+        default: break;
+        }
+        return true;
+    }
+
+public:
+    MPExprEval(mpfr_prec_t prec) : prec(prec) {}
+    ~MPExprEval()
+    {
+        for(auto &val : freeVals) Ops::clear(&val);
+        for(auto &val : sharedVals) Ops::clear(&val.second);
+    }
+
+    // Evaluates `var` (which must not use `dst`) into `dst`, returning false on division by zero.
+    bool eval(Var *var, Ptr dst)
+    {
+        countExprUses(var, uses);
+        if(!isShared(var)) return evalNode(var, dst);
+        Src res;
+        if(!sharedOperand(var, res)) return false;
+        Ops::set(dst, res);
+        return true;
+    }
+};
+
+// Evaluates `var` into `dst` at precision `prec` - through a scratch value if `var` uses `dst`.
+template<typename Ops>
+static bool evalExprInto(Var *var, typename Ops::Ptr dst, mpfr_prec_t prec, bool usesDst)
+{
+    MPExprEval<Ops> eval(prec);
+    if(!usesDst) return eval.eval(var, dst);
+    typename Ops::Val tmp;
+    Ops::init(&tmp, prec);
+    bool ok = eval.eval(var, &tmp);
+    if(ok) Ops::set(dst, &tmp);
+    Ops::clear(&tmp);
+    return ok;
+}
+
+// Evaluates both `lhs` and `rhs` at precision `prec`, and compares them into `res`.
+template<typename Ops> static bool evalExprCmp(Var *lhs, Var *rhs, mpfr_prec_t prec, int &res)
+{
+    MPExprEval<Ops> eval(prec);
+    typename Ops::Val lhsVal, rhsVal;
+    Ops::init(&lhsVal, prec);
+    Ops::init(&rhsVal, prec);
+    bool ok = eval.eval(lhs, &lhsVal) && eval.eval(rhs, &rhsVal);
+    if(ok) res = Ops::cmp(&lhsVal, &rhsVal);
+    Ops::clear(&lhsVal);
+    Ops::clear(&rhsVal);
+    return ok;
+}
+
+// Evaluates the MP value / expression `var` into the (existing) MP value `dst` of the same kind.
+static bool evalExprInto(Var *var, Var *dst)
+{
+    bool usesDst = exprUses(var, dst);
+    if(dst->is<VarMPInt>()) {
+        VarMPInt *res = as<VarMPInt>(dst);
+        bool ok       = evalExprInto<IntExprOps>(var, res->getPtr(), 0, usesDst);
+        res->normalize();
+        return ok;
+    }
+    mpfr_prec_t prec = exprPrec(var);
+    if(dst->is<VarMPFlt>()) {
+        return evalExprInto<FltExprOps>(var, as<VarMPFlt>(dst)->getPtr(), prec, usesDst);
+    }
+    return evalExprInto<ComplexExprOps>(var, as<VarMPComplex>(dst)->getPtr(), prec, usesDst);
+}
+
+// Evaluates the MP value / expression `var` into a new MP value, which is returned (nullptr, after
+// failing, on division by zero).
+static Var *evalExpr(VirtualMachine &vm, ModuleLoc loc, Var *var)
+{
+    VarMPExpr::Kind kind;
+    getExprKind(var, kind);
+    Var *res;
+    if(kind == VarMPExpr::Kind::Int) res = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+    else if(kind == VarMPExpr::Kind::Flt) res = vm.makeVar<VarMPFlt>(loc, 0.0, exprPrec(var));
+    else res = vm.makeVar<VarMPComplex>(loc, exprPrec(var));
+    if(evalExprInto(var, res)) return res;
+    vm.incVarRef(res);
+    vm.decVarRef(res);
+    vm.fail(loc, "division by zero");
+    return nullptr;
+}
+
+// Returns the node `lhs` `op` `rhs` (`rhs` is nullptr for unary operations) of the expression
+// `lhs`, with any operand which would make the expression too deep evaluated first.
+static Var *makeExpr(VirtualMachine &vm, ModuleLoc loc, VarMPExpr::Op op, Var *lhs, Var *rhs)
+{
+    VarMPExpr::Kind kind = as<VarMPExpr>(lhs)->getKind(), rhsKind;
+    if(rhs && (!getExprKind(rhs, rhsKind) || rhsKind != kind)) {
+        vm.fail(loc, "expected an expression or a value of the same MP type as the expression, "
+                     "found: ",
+                vm.getTypeName(rhs));
+        return nullptr;
+    }
+    if(exprDepth(lhs) >= EXPR_MAX_DEPTH && !(lhs = evalExpr(vm, loc, lhs))) return nullptr;
+    if(exprDepth(rhs) >= EXPR_MAX_DEPTH && !(rhs = evalExpr(vm, loc, rhs))) return nullptr;
+    return vm.makeVar<VarMPExpr>(loc, vm, kind, op, lhs, rhs);
+}
+
+FERAL_FUNC(mpLazy, 1, false,
+           "  fn(value) -> MPExpr\n"
+           "Returns an expression of the MPInt / MPFlt / MPComplex `value`, on which arithmetic "
+           "(with other expressions or values of the same type) builds up a larger expression "
+           "instead of computing anything. Expressions are only evaluated when compared, "
+           "converted (via str / int / flt / eval), or evaluated into a value (via into).\n"
+           "Values are read when the expression is evaluated, not when it is built.")
+{
+    VarMPExpr::Kind kind;
+    if(args[1]->is<VarMPExpr>()) return args[1];
+    if(!getExprKind(args[1], kind)) {
+        vm.fail(loc, "expected an MPInt / MPFlt / MPComplex, found: ", vm.getTypeName(args[1]));
+        return nullptr;
+    }
+    return vm.makeVar<VarMPExpr>(loc, vm, kind, VarMPExpr::Op::Val, args[1], nullptr);
+}
+
+#define ARITHE_FUNC(fn, name)                                                                  \
+    FERAL_FUNC(mpExpr##fn, 1, false,                                                           \
+               "  var.fn(other) -> MPExpr\n"                                                   \
+               "Returns the expression of arithmetic-" STRINGIFY(                              \
+                   name) " on `var` and `other` (an expression or a value of the same type).") \
+    {                                                                                          \
+        return makeExpr(vm, loc, VarMPExpr::Op::fn, args[0], args[1]);                         \
+    }
+
+ARITHE_FUNC(Add, add)
+ARITHE_FUNC(Sub, sub)
+ARITHE_FUNC(Mul, mul)
+ARITHE_FUNC(Div, div)
+
+FERAL_FUNC(mpExprUSub, 0, false,
+           "  var.fn() -> MPExpr\n"
+           "Returns the expression of the negation of `var`.")
+{
+    return makeExpr(vm, loc, VarMPExpr::Op::Neg, args[0], nullptr);
+}
+
+#define LOGICE_FUNC(fn, name, sym, mismatch)                                                   \
+    FERAL_FUNC(mpExpr##fn, 1, false,                                                           \
+               "  var.fn(other) -> Bool\n"                                                     \
+               "Evaluates `var` and `other` (an expression or a value of the same type), "     \
+               "applies logical '" STRINGIFY(name) "' between them and returns the resulting " \
+               "Bool.")                                                                        \
+    {                                                                                          \
+        VarMPExpr::Kind kind = as<VarMPExpr>(args[0])->getKind(), rhsKind;                     \
+        if(!getExprKind(args[1], rhsKind) || rhsKind != kind) {                                \
+            mismatch;                                                                          \
+        }                                                                                      \
+        int cmp;                                                                               \
+        bool ok;                                                                               \
+        if(kind == VarMPExpr::Kind::Int) {                                                     \
+            ok = evalExprCmp<IntExprOps>(args[0], args[1], 0, cmp);                            \
+        } else {                                                                               \
+            mpfr_prec_t prec = resultPrec(exprPrec(args[0]), exprPrec(args[1]));               \
+            ok = kind == VarMPExpr::Kind::Flt                                                  \
+                 ? evalExprCmp<FltExprOps>(args[0], args[1], prec, cmp)                        \
+                 : evalExprCmp<ComplexExprOps>(args[0], args[1], prec, cmp);                   \
+        }                                                                                      \
+        if(!ok) {                                                                              \
+            vm.fail(loc, "division by zero");                                                  \
+            return nullptr;                                                                    \
+        }                                                                                      \
+        return cmp sym 0 ? vm.getTrue() : vm.getFalse();                                       \
+    }
+
+#define LOGICE_MISMATCH_FAIL                                                                 \
+    vm.fail(loc, "expected an expression or a value of the same MP type as the expression, " \
+                 "found: ",                                                                  \
+            vm.getTypeName(args[1]));                                                        \
+    return nullptr
+
+LOGICE_FUNC(LT, lt, <, LOGICE_MISMATCH_FAIL)
+LOGICE_FUNC(GT, gt, >, LOGICE_MISMATCH_FAIL)
+LOGICE_FUNC(LE, le, <=, LOGICE_MISMATCH_FAIL)
+LOGICE_FUNC(GE, ge, >=, LOGICE_MISMATCH_FAIL)
+LOGICE_FUNC(EQ, eq, ==, return vm.getFalse())
+LOGICE_FUNC(NE, ne, !=, return vm.getTrue())
+
+FERAL_FUNC(mpExprEval, 0, false,
+           "  var.fn() -> MPInt / MPFlt / MPComplex\n"
+           "Evaluates `var` and returns the result as a new value.")
+{
+    return evalExpr(vm, loc, args[0]);
+}
+
+FERAL_FUNC(mpExprInto, 1, false,
+           "  var.fn(dest) -> dest\n"
+           "Evaluates `var` into the existing value `dest` (of the same type as the expression, "
+           "rounded to the precision of `dest`), without creating a new value, and returns "
+           "`dest`.")
+{
+    EXPECT_NO_CONST(args[1], "destination");
+    VarMPExpr::Kind kind;
+    if(args[1]->is<VarMPExpr>() || !getExprKind(args[1], kind) ||
+       kind != as<VarMPExpr>(args[0])->getKind())
+    {
+        vm.fail(loc, "expected a value of the same MP type as the expression, found: ",
+                vm.getTypeName(args[1]));
+        return nullptr;
+    }
+    if(!evalExprInto(args[0], args[1])) {
+        vm.fail(loc, "division by zero");
+        return nullptr;
+    }
+    return args[1];
+}
+
+// Evaluates `var` and returns the result of `fn` (a conversion function of the resulting value).
+static Var *exprConvert(VirtualMachine &vm, ModuleLoc loc, Var *var,
+                        const Map<String, size_t> &assnArgs,
+                        Var *(*fn)(VirtualMachine &, ModuleLoc, Span<Var *>,
+                                   const Map<String, size_t> &))
+{
+    Var *val = evalExpr(vm, loc, var);
+    if(!val) return nullptr;
+    vm.incVarRef(val);
+    Var *fnArgs[] = {val};
+    Var *res      = fn(vm, loc, Span<Var *>(fnArgs, 1), assnArgs);
+    vm.decVarRef(val);
+    return res;
+}
+
+FERAL_FUNC(mpExprToStr, 0, false,
+           "  var.fn() -> Str\n"
+           "Evaluates `var` and returns the result as a Str.")
+{
+    VarMPExpr::Kind kind = as<VarMPExpr>(args[0])->getKind();
+    if(kind == VarMPExpr::Kind::Int) return exprConvert(vm, loc, args[0], assnArgs, mpIntToStr);
+    if(kind == VarMPExpr::Kind::Flt) return exprConvert(vm, loc, args[0], assnArgs, mpFltToStr);
+    Var *val = evalExpr(vm, loc, args[0]);
+    if(!val) return nullptr;
+    vm.incVarRef(val);
+    char *str   = mpc_get_str(10, 0, as<VarMPComplex>(val)->getSrcPtr(),
+                              mpc_get_default_rounding_mode());
+    VarStr *res = vm.makeVar<VarStr>(loc, str);
+    mpc_free_str(str);
+    vm.decVarRef(val);
+    return res;
+}
+
+FERAL_FUNC(mpExprToInt, 0, false,
+           "  var.fn() -> Int\n"
+           "Evaluates the MPInt expression `var` and returns the result as an Int.")
+{
+    if(as<VarMPExpr>(args[0])->getKind() != VarMPExpr::Kind::Int) {
+        vm.fail(loc, "int() requires an MPInt expression");
+        return nullptr;
+    }
+    return exprConvert(vm, loc, args[0], assnArgs, mpIntToInt);
+}
+
+FERAL_FUNC(mpExprToFlt, 0, false,
+           "  var.fn() -> Flt\n"
+           "Evaluates the MPFlt expression `var` and returns the result as a Flt.")
+{
+    if(as<VarMPExpr>(args[0])->getKind() != VarMPExpr::Kind::Flt) {
+        vm.fail(loc, "flt() requires an MPFlt expression");
+        return nullptr;
+    }
+    return exprConvert(vm, loc, args[0], assnArgs, mpFltToFlt);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// RandState Functions //////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+FERAL_FUNC(randStateNewNative, 2, false,
+           "  fn(algo, seed) -> RandState\n"
+           "Creates and returns a new RandState which uses the algorithm `algo` - 'mt' (Mersenne "
+           "Twister) or 'lc' (linear congruential), seeded with `seed` (Int / MPInt) unless it is "
+           "nil.")
+{
+    EXPECT(VarStr, args[1], "random algorithm");
+    EXPECT3(VarNil, VarInt, VarMPInt, args[2], "seed value");
+    const String &name = as<VarStr>(args[1])->getVal();
+    VarRandState::Algo algo;
+    if(name == "mt") {
+        algo = VarRandState::Algo::MT;
+    } else if(name == "lc") {
+        algo = VarRandState::Algo::LC;
+    } else {
+        vm.fail(loc, "random algorithm must be one of 'mt' or 'lc', found: ", name);
+        return nullptr;
+    }
+    VarRandState *res = vm.makeVar<VarRandState>(loc, algo);
+    if(args[2]->is<VarInt>()) gmp_randseed_ui(res->getPtr(), as<VarInt>(args[2])->getVal());
+    else if(args[2]->is<VarMPInt>()) {
+        gmp_randseed(res->getPtr(), as<VarMPInt>(args[2])->getSrcPtr());
+    }
+    return res;
+}
+
+FERAL_FUNC(randStateCopy, 0, false,
+           "  var.fn() -> RandState\n"
+           "Creates a new instance of `var`, which produces the same numbers as `var` would from "
+           "this point, and returns it.")
+{
+    return vm.makeVar<VarRandState>(loc, as<VarRandState>(args[0]));
+}
+
+FERAL_FUNC(randStateSeed, 1, false,
+           "  var.fn(seed) -> var\n"
+           "Seeds `var` with `seed` (Int / MPInt) and returns `var`.")
+{
+    EXPECT2(VarInt, VarMPInt, args[1], "seed value");
+    VarRandState *state = as<VarRandState>(args[0]);
+    if(args[1]->is<VarInt>()) gmp_randseed_ui(state->getPtr(), as<VarInt>(args[1])->getVal());
+    else gmp_randseed(state->getPtr(), as<VarMPInt>(args[1])->getSrcPtr());
+    return args[0];
+}
+
+FERAL_FUNC(randStateSplit, 0, false,
+           "  var.fn() -> RandState\n"
+           "Returns a new RandState (with the same algorithm as `var`), seeded from `var`, whose "
+           "numbers are independent from those of `var` - meant for giving each of many parallel "
+           "jobs its own stream.")
+{
+    VarRandState *state = as<VarRandState>(args[0]);
+    VarRandState *res   = vm.makeVar<VarRandState>(loc, state->getAlgo());
+    randSplit(res->getPtr(), state->getPtr());
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// IntArray Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fetches the value of the Int / Str / MPInt `arg` into `val`.
+static inline void getIntArrayElem(Var *arg, mpz_ptr val)
+{
+    if(arg->is<VarInt>()) mpz_set_si(val, as<VarInt>(arg)->getVal());
+    else if(arg->is<VarStr>()) mpz_set_str(val, as<VarStr>(arg)->getVal().c_str(), 0);
+    else mpz_set(val, as<VarMPInt>(arg)->getSrcPtr());
+}
+
+FERAL_FUNC(mpIntArrayNewNative, 0, true,
+           "  fn(values...) -> MPIntArray\n"
+           "Creates and returns a new MPIntArray with `values`.\n"
+           "Here each of `values` can be any of Int / Str / MPInt, or a Vec of them.")
+{
+    size_t count = 0;
+    for(size_t i = 1; i < args.size(); ++i) {
+        if(!args[i]->is<VarVec>()) {
+            EXPECT3(VarInt, VarStr, VarMPInt, args[i], "big int array value");
+            ++count;
+            continue;
+        }
+        for(Var *e : as<VarVec>(args[i])->getVal()) {
+            EXPECT3(VarInt, VarStr, VarMPInt, e, "big int array value");
+            ++count;
+        }
+    }
+    VarMPIntArray *res = vm.makeVar<VarMPIntArray>(loc);
+    res->reserve(count, count);
+    mpz_t tmp;
+    pool.initInt(tmp);
+    for(size_t i = 1; i < args.size(); ++i) {
+        if(!args[i]->is<VarVec>()) {
+            getIntArrayElem(args[i], tmp);
+            res->push(tmp);
+            continue;
+        }
+        for(Var *e : as<VarVec>(args[i])->getVal()) {
+            getIntArrayElem(e, tmp);
+            res->push(tmp);
+        }
+    }
+    pool.clearInt(tmp);
+    return res;
+}
+
+FERAL_FUNC(mpIntArrayCopy, 1, false,
+           "  var.fn() -> MPIntArray\n"
+           "Creates a new instance of `var` and returns it.")
+{
+    return vm.makeVar<VarMPIntArray>(loc, as<VarMPIntArray>(args[0]));
+}
+
+// Applies `op` between each element of the MPIntArray `args[0]` and `args[1]` - either an
+// MPIntArray of the same length, or an Int / MPInt which is used with every element - in a single
+// pass, and returns a new MPIntArray with the results.
+// If `isDiv` is set, a zero in `args[1]` fails instead of being passed to `op`.
+static Var *intArrayApply(VirtualMachine &vm, ModuleLoc loc, Span<Var *> args,
+                          void (*op)(mpz_ptr, mpz_srcptr, mpz_srcptr), bool isDiv)
+{
+    EXPECT3(VarInt, VarMPInt, VarMPIntArray, args[1], "big int array operand");
+    VarMPIntArray *lhs = as<VarMPIntArray>(args[0]);
+    VarMPIntArray *rhs = args[1]->is<VarMPIntArray>() ? as<VarMPIntArray>(args[1]) : nullptr;
+    size_t count       = lhs->size();
+    mpz_t a, b;
+    if(rhs && rhs->size() != count) {
+        vm.fail(loc, "big int array lengths must be equal, found: (", count, ", ", rhs->size(),
+                ")");
+        return nullptr;
+    }
+    mpz_t scalar;
+    pool.initInt(scalar);
+    if(!rhs) getIntArrayElem(args[1], scalar);
+    if(isDiv) {
+        bool hasZero = rhs ? false : mpz_sgn(scalar) == 0;
+        for(size_t i = 0; rhs && i < count && !hasZero; ++i) hasZero = mpz_sgn(rhs->get(i, b)) == 0;
+        if(hasZero) {
+            vm.fail(loc, "division by zero");
+            pool.clearInt(scalar);
+            return nullptr;
+        }
+    }
+    VarMPIntArray *res = vm.makeVar<VarMPIntArray>(loc);
+    res->reserve(count, lhs->getLimbCount());
+    mpz_t tmp;
+    pool.initInt(tmp);
+    for(size_t i = 0; i < count; ++i) {
+        op(tmp, lhs->get(i, a), rhs ? rhs->get(i, b) : scalar);
+        res->push(tmp);
+    }
+    pool.clearInt(tmp);
+    pool.clearInt(scalar);
+    return res;
+}
+
+#define ARITHIA_FUNC(fn, name, opname, isDiv)                                                     \
+    FERAL_FUNC(mpIntArray##fn, 1, false,                                                          \
+               "  var.fn(other) -> MPIntArray\n"                                                  \
+               "Applies " opname " between each element of `var` and `other` - an MPIntArray of " \
+               "the same length, or an Int / MPInt - and returns a new MPIntArray with the "      \
+               "results.")                                                                        \
+    {                                                                                             \
+        return intArrayApply(vm, loc, args, mpz_##name, isDiv);                                   \
+    }
+
+ARITHIA_FUNC(Add, add, "arithmetic-add", false)
+ARITHIA_FUNC(Sub, sub, "arithmetic-sub", false)
+ARITHIA_FUNC(Mul, mul, "arithmetic-mul", false)
+ARITHIA_FUNC(Mod, mod, "arithmetic-mod", true)
+ARITHIA_FUNC(BAnd, and, "bitwise-and", false)
+ARITHIA_FUNC(BOr, ior, "bitwise-or", false)
+ARITHIA_FUNC(BXOr, xor, "bitwise-xor", false)
+
+FERAL_FUNC(mpIntArrayLen, 0, false,
+           "  var.fn() -> Int\n"
+           "Returns the number of elements in `var`.")
+{
+    return vm.makeVar<VarInt>(loc, as<VarMPIntArray>(args[0])->size());
+}
+
+// Fetches the index `arg` into `idx`, failing if it is out of the bounds of `arr`.
+static bool getIntArrayIdx(VirtualMachine &vm, ModuleLoc loc, VarMPIntArray *arr, Var *arg,
+                           size_t &idx)
+{
+    int64_t i = as<VarInt>(arg)->getVal();
+    if(i < 0 || (size_t)i >= arr->size()) {
+        vm.fail(loc, "index out of bounds - array size: ", arr->size(), ", index: ", i);
+        return false;
+    }
+    idx = i;
+    return true;
+}
+
+FERAL_FUNC(mpIntArrayAt, 1, false,
+           "  var.fn(idx) -> MPInt\n"
+           "Returns the element at index `idx` in `var` as a new MPInt.")
+{
+    EXPECT(VarInt, args[1], "index");
+    VarMPIntArray *arr = as<VarMPIntArray>(args[0]);
+    size_t idx;
+    if(!getIntArrayIdx(vm, loc, arr, args[1], idx)) return nullptr;
+    mpz_t view;
+    return vm.makeVar<VarMPInt>(loc, arr->get(idx, view));
+}
+
+FERAL_FUNC(mpIntArraySet, 2, false,
+           "  var.fn(idx, value) -> var\n"
+           "Sets the element at index `idx` in `var` to `value` (Int / Str / MPInt) and returns "
+           "`var`.")
+{
+    EXPECT(VarInt, args[1], "index");
+    EXPECT3(VarInt, VarStr, VarMPInt, args[2], "big int array value");
+    VarMPIntArray *arr = as<VarMPIntArray>(args[0]);
+    size_t idx;
+    if(!getIntArrayIdx(vm, loc, arr, args[1], idx)) return nullptr;
+    mpz_t tmp;
+    pool.initInt(tmp);
+    getIntArrayElem(args[2], tmp);
+    arr->set(idx, tmp);
+    pool.clearInt(tmp);
+    return args[0];
+}
+
+FERAL_FUNC(mpIntArrayPush, 1, false,
+           "  var.fn(value) -> var\n"
+           "Appends `value` (Int / Str / MPInt) to `var` and returns `var`.")
+{
+    EXPECT3(VarInt, VarStr, VarMPInt, args[1], "big int array value");
+    mpz_t tmp;
+    pool.initInt(tmp);
+    getIntArrayElem(args[1], tmp);
+    as<VarMPIntArray>(args[0])->push(tmp);
+    pool.clearInt(tmp);
+    return args[0];
+}
+
+FERAL_FUNC(mpIntArraySum, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the sum of all the elements in `var` as a new MPInt.")
+{
+    VarMPIntArray *arr = as<VarMPIntArray>(args[0]);
+    VarMPInt *res      = vm.makeVar<VarMPInt>(loc, 0);
+    mpz_ptr sum        = res->getPtr();
+    mpz_t view;
+    for(size_t i = 0; i < arr->size(); ++i) mpz_add(sum, sum, arr->get(i, view));
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpIntArrayProduct, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the product of all the elements in `var` as a new MPInt, computed as a "
+           "balanced product tree.")
+{
+    VarMPIntArray *arr = as<VarMPIntArray>(args[0]);
+    Vector<__mpz_struct> views(arr->size());
+    Vector<mpz_srcptr> vals(arr->size());
+    for(size_t i = 0; i < arr->size(); ++i) vals[i] = arr->get(i, &views[i]);
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    intProduct(res->getPtr(), vals.data(), vals.size(), getMulThreads());
+    res->normalize();
+    return res;
+}
+
+#define MINMAXIA_FUNC(fn, opname, sym)                                                       \
+    FERAL_FUNC(mpIntArray##fn, 0, false,                                                     \
+               "  var.fn() -> MPInt\n"                                                       \
+               "Returns the " opname " element in `var` as a new MPInt, or nil if `var` is " \
+               "empty.")                                                                     \
+    {                                                                                        \
+        VarMPIntArray *arr = as<VarMPIntArray>(args[0]);                                     \
+        if(arr->size() == 0) return vm.getNil();                                             \
+        mpz_t view, bestView;                                                                \
+        size_t best = 0;                                                                     \
+        for(size_t i = 1; i < arr->size(); ++i) {                                            \
+            if(mpz_cmp(arr->get(i, view), arr->get(best, bestView)) sym 0) best = i;         \
+        }                                                                                    \
+        return vm.makeVar<VarMPInt>(loc, arr->get(best, view));                              \
+    }
+
+MINMAXIA_FUNC(Min, "smallest", <)
+MINMAXIA_FUNC(Max, "largest", >)
+
+FERAL_FUNC(mpIntArraySort, 0, false,
+           "  var.fn() -> var\n"
+           "Sorts the elements of `var` in ascending order and returns `var`.")
+{
+    VarMPIntArray *arr = as<VarMPIntArray>(args[0]);
+    Vector<size_t> order(arr->size());
+    for(size_t i = 0; i < order.size(); ++i) order[i] = i;
+    mpz_t a, b;
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return mpz_cmp(arr->get(lhs, a), arr->get(rhs, b)) < 0;
+    });
+    arr->reorder(order);
+    return args[0];
+}
+
+FERAL_FUNC(mpIntArrayToStr, 0, false,
+           "  var.fn() -> Str\n"
+           "Returns the string representation of `var`.")
+{
+    VarMPIntArray *arr = as<VarMPIntArray>(args[0]);
+    VarStr *res        = vm.makeVar<VarStr>(loc, "[");
+    String &str        = res->getVal();
+    String buf;
+    mpz_t view;
+    for(size_t i = 0; i < arr->size(); ++i) {
+        mpz_srcptr val = arr->get(i, view);
+        // mpz_get_str() needs space for the sign and the null terminator.
+        buf.resize(mpz_sizeinbase(val, 10) + 2);
+        mpz_get_str(buf.data(), 10, val);
+        if(i > 0) str += ", ";
+        str += buf.c_str();
+    }
+    str += "]";
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////// Combinatorial Functions /////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+FERAL_FUNC(mpFactorial, 1, false,
+           "  fn(n) -> MPInt\n"
+           "Returns n! as a new MPInt.")
+{
+    unsigned long n;
+    if(!getUiArg(vm, loc, args[1], "factorial argument", n)) return nullptr;
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    mpz_fac_ui(res->getPtr(), n);
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpBinomial, 2, false,
+           "  fn(n, k) -> MPInt\n"
+           "Returns the binomial coefficient (`n` choose `k`) as a new MPInt.\n"
+           "Here `n` (an Int / MPInt) can be negative.")
+{
+    EXPECT2(VarInt, VarMPInt, args[1], "binomial n");
+    unsigned long k;
+    if(!getUiArg(vm, loc, args[2], "binomial k", k)) return nullptr;
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    if(args[1]->is<VarInt>()) {
+        int64_t n = as<VarInt>(args[1])->getVal();
+        if(n >= 0) {
+            mpz_bin_uiui(res->getPtr(), n, k);
+        } else {
+            mpz_set_si(res->getPtr(), n);
+            mpz_bin_ui(res->getPtr(), res->getPtr(), k);
+        }
+    } else {
+        mpz_bin_ui(res->getPtr(), as<VarMPInt>(args[1])->getSrcPtr(), k);
+    }
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpPrimorial, 1, false,
+           "  fn(n) -> MPInt\n"
+           "Returns the product of all the primes up to `n` as a new MPInt.")
+{
+    unsigned long n;
+    if(!getUiArg(vm, loc, args[1], "primorial argument", n)) return nullptr;
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    mpz_primorial_ui(res->getPtr(), n);
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpFib, 1, false,
+           "  fn(n) -> MPInt\n"
+           "Returns the `n`th Fibonacci number as a new MPInt.")
+{
+    unsigned long n;
+    if(!getUiArg(vm, loc, args[1], "fibonacci index", n)) return nullptr;
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    mpz_fib_ui(res->getPtr(), n);
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpLucas, 1, false,
+           "  fn(n) -> MPInt\n"
+           "Returns the `n`th Lucas number as a new MPInt.")
+{
+    unsigned long n;
+    if(!getUiArg(vm, loc, args[1], "lucas index", n)) return nullptr;
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    mpz_lucnum_ui(res->getPtr(), n);
+    res->normalize();
+    return res;
+}
+
+FERAL_FUNC(mpProductOf, 1, false,
+           "  fn(values) -> MPInt\n"
+           "Returns the product of `values` (a Vec of Int / MPInt, or an MPIntArray) as a new "
+           "MPInt, computed as a balanced product tree whose subtrees are computed on multiple "
+           "threads.")
+{
+    EXPECT2(VarVec, VarMPIntArray, args[1], "values");
+    if(args[1]->is<VarMPIntArray>()) {
+        Var *productArgs[] = {args[1]};
+        return mpIntArrayProduct(vm, loc, Span<Var *>(productArgs, 1), assnArgs);
+    }
+    Vector<Var *> &values = as<VarVec>(args[1])->getVal();
+    for(Var *e : values) {
+        EXPECT2(VarInt, VarMPInt, e, "product value");
+    }
+    // Views of the values - Ints are read from `limbs`.
+    Vector<mp_limb_t> limbs(values.size());
+    Vector<__mpz_struct> views(values.size());
+    Vector<mpz_srcptr> vals(values.size());
+    for(size_t i = 0; i < values.size(); ++i) {
+        if(values[i]->is<VarMPInt>()) {
+            vals[i] = as<VarMPInt>(values[i])->getSrcPtr();
+            continue;
+        }
+        int64_t val = as<VarInt>(values[i])->getVal();
+        limbs[i]    = val < 0 ? -(uint64_t)val : (uint64_t)val;
+        vals[i]     = mpz_roinit_n(&views[i], &limbs[i], val < 0 ? -1 : val > 0);
+    }
+    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+    intProduct(res->getPtr(), vals.data(), vals.size(), getMulThreads());
+    res->normalize();
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// FltArray Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Fetches the value of the Int / Flt / MPInt / MPFlt `arg` into `val`, rounded to its precision.
+static inline void getFltArrayElem(Var *arg, mpfr_ptr val)
+{
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    if(arg->is<VarInt>()) mpfr_set_si(val, as<VarInt>(arg)->getVal(), rnd);
+    else if(arg->is<VarFlt>()) mpfr_set_d(val, as<VarFlt>(arg)->getVal(), rnd);
+    else if(arg->is<VarMPInt>()) mpfr_set_z(val, as<VarMPInt>(arg)->getSrcPtr(), rnd);
+    else mpfr_set(val, as<VarMPFlt>(arg)->getSrcPtr(), rnd);
+}
+
+FERAL_FUNC(mpFltArrayNewNative, 2, false,
+           "  fn(values, precision) -> MPFltArray\n"
+           "Creates and returns a new MPFltArray of `precision` bits with `values`.\n"
+           "Here `values` can be a Vec of Int / Flt / MPInt / MPFlt, or an Int count of zeros.\n"
+           "If `precision` is 0, the default precision is used.")
+{
+    EXPECT2(VarVec, VarInt, args[1], "big float array values");
+    EXPECT(VarInt, args[2], "precision");
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[2], true, prec)) return nullptr;
+    if(prec == 0) prec = mpfr_get_default_prec();
+    if(args[1]->is<VarInt>()) {
+        int64_t count = as<VarInt>(args[1])->getVal();
+        if(count < 0) {
+            vm.fail(loc, "big float array size cannot be negative, found: ", count);
+            return nullptr;
+        }
+        VarMPFltArray *res = vm.makeVar<VarMPFltArray>(loc, prec);
+        res->addZeros(count);
+        return res;
+    }
+    Vector<Var *> &values = as<VarVec>(args[1])->getVal();
+    for(Var *e : values) {
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, e, "big float array value");
+    }
+    VarMPFltArray *res = vm.makeVar<VarMPFltArray>(loc, prec);
+    mpfr_t tmp;
+    pool.initFlt(tmp, prec);
+    for(Var *e : values) {
+        getFltArrayElem(e, tmp);
+        res->push(tmp);
+    }
+    pool.clearFlt(tmp);
+    return res;
+}
+
+FERAL_FUNC(mpFltArrayCopy, 1, false,
+           "  var.fn() -> MPFltArray\n"
+           "Creates a new instance of `var` and returns it.")
+{
+    return vm.makeVar<VarMPFltArray>(loc, as<VarMPFltArray>(args[0]));
+}
+
+// Signature of the double kernels, which return false if any of the results might differ from
+// what MPFR would have computed (mostly due to overflow or underflow), in which case the results
+// are thrown away and computed again by MPFR.
+// `rhs` is a single value (the scalar) if `isScalar` is set.
+typedef bool (*DblKernel)(double *res, const double *lhs, const double *rhs, size_t count,
+                          bool isScalar);
+
+// Applies `op` between each element of the MPFltArray `args[0]` and `args[1]` - either an
+// MPFltArray of the same length, or an Int / Flt / MPFlt which is used with every element - in a
+// single pass, and returns a new MPFltArray with the results.
+// If both sides are (or fit in) doubles at 53 bits, `dblOp` is tried first.
+static Var *fltArrayApply(VirtualMachine &vm, ModuleLoc loc, Span<Var *> args,
+                          int (*op)(mpfr_ptr, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t),
+                          DblKernel dblOp)
+{
+    EXPECT4(VarInt, VarFlt, VarMPFlt, VarMPFltArray, args[1], "big float array operand");
+    VarMPFltArray *lhs = as<VarMPFltArray>(args[0]);
+    VarMPFltArray *rhs = args[1]->is<VarMPFltArray>() ? as<VarMPFltArray>(args[1]) : nullptr;
+    size_t count       = lhs->size();
+    if(rhs && rhs->size() != count) {
+        vm.fail(loc, "big float array lengths must be equal, found: (", count, ", ", rhs->size(),
+                ")");
+        return nullptr;
+    }
+    mpfr_prec_t prec = lhs->getPrec();
+    if(rhs) prec = resultPrec(prec, rhs->getPrec());
+    else if(args[1]->is<VarMPFlt>()) prec = resultPrec(prec, as<VarMPFlt>(args[1])->getPrec());
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+
+    // The scalar is exact at 53 bits for a Flt, and at 64 bits for an Int.
+    mpfr_t scalar;
+    pool.initFlt(scalar, args[1]->is<VarMPFlt>() ? as<VarMPFlt>(args[1])->getPrec() : 64);
+    if(!rhs) getFltArrayElem(args[1], scalar);
+
+    VarMPFltArray *res = vm.makeVar<VarMPFltArray>(loc, prec);
+    double dblScalar;
+    if(prec == 53 && rnd == MPFR_RNDN && lhs->isDouble() &&
+       (rhs ? rhs->isDouble()
+            : fltToDouble(scalar, dblScalar) && mpfr_cmp_d(scalar, dblScalar) == 0))
+    {
+        res->addZeros(count);
+        if(dblOp(res->getDoubles(), lhs->getDoubles(), rhs ? rhs->getDoubles() : &dblScalar,
+                 count, !rhs))
+        {
+            pool.clearFlt(scalar);
+            return res;
+        }
+        res->toMPFR();
+    } else {
+        res->toMPFR();
+        res->addZeros(count);
+    }
+    mpfr_t a, b;
+    pool.initFlt(a, 53);
+    pool.initFlt(b, 53);
+    for(size_t i = 0; i < count; ++i) {
+        op(res->getPtr(i), lhs->get(i, a), rhs ? rhs->get(i, b) : scalar, rnd);
+    }
+    pool.clearFlt(a);
+    pool.clearFlt(b);
+    pool.clearFlt(scalar);
+    return res;
+}
+
+// Unlike std::isnormal(), rejects DBL_MIN too, since it might be the result of rounding up a value
+// in the subnormal range.
+static inline bool isNormalDbl(double x)
+{
+    return std::fabs(x) > DBL_MIN && std::fabs(x) <= DBL_MAX;
+}
+
+// `check` decides whether the result `r` of `a` and `b` is the same as what MPFR would give.
+// Sums and differences are exact whenever they underflow, so only overflows need to be caught,
+// whereas products and quotients must stay clear of the subnormal range, unless they are exactly 0.
+#define ARITHFA_FUNC(fn, name, sym, check)                                                         \
+    static bool fltArrayDbl##fn(double *res, const double *lhs, const double *rhs, size_t count,   \
+                                bool isScalar)                                                     \
+    {                                                                                              \
+        bool ok = true;                                                                            \
+        if(isScalar) {                                                                             \
+            const double b = *rhs;                                                                 \
+            for(size_t i = 0; i < count; ++i) {                                                    \
+                const double a = lhs[i];                                                           \
+                const double r = res[i] = a sym b;                                                 \
+                ok &= (check);                                                                     \
+            }                                                                                      \
+            return ok;                                                                             \
+        }                                                                                          \
+        for(size_t i = 0; i < count; ++i) {                                                        \
+            const double a = lhs[i], b = rhs[i];                                                   \
+            const double r = res[i] = a sym b;                                                     \
+            ok &= (check);                                                                         \
+        }                                                                                          \
+        return ok;                                                                                 \
+    }                                                                                              \
+    FERAL_FUNC(mpFltArray##fn, 1, false,                                                           \
+               "  var.fn(other) -> MPFltArray\n"                                                   \
+               "Applies arithmetic-" STRINGIFY(name) " between each element of `var` and `other` " \
+               "- an MPFltArray of the same length, or an Int / Flt / MPFlt - and returns a new "  \
+               "MPFltArray with the results.")                                                     \
+    {                                                                                              \
+        return fltArrayApply(vm, loc, args, mpfr_##name, fltArrayDbl##fn);                         \
+    }
+
+ARITHFA_FUNC(Add, add, +, std::isfinite(r))
+ARITHFA_FUNC(Sub, sub, -, std::isfinite(r))
+ARITHFA_FUNC(Mul, mul, *, isNormalDbl(r) || (r == 0 && (a == 0 || b == 0)))
+ARITHFA_FUNC(Div, div, /, isNormalDbl(r) || (r == 0 && (a == 0 || std::isinf(b))))
+
+// Applies `op` to each element of `var` and returns a new MPFltArray (of the same precision)
+// with the results. `dblOp`, if set, must give exactly the same results as MPFR does at 53 bits.
+#define MAPFA_FUNC(fn, name, dblOp)                                                               \
+    FERAL_FUNC(mpFltArray##fn, 0, false,                                                          \
+               "  var.fn() -> MPFltArray\n"                                                       \
+               "Returns a new MPFltArray with the " STRINGIFY(name) " of each element of `var`.") \
+    {                                                                                             \
+        VarMPFltArray *arr = as<VarMPFltArray>(args[0]);                                          \
+        VarMPFltArray *res = vm.makeVar<VarMPFltArray>(loc, arr->getPrec());                      \
+        size_t count       = arr->size();                                                         \
+        mpfr_rnd_t rnd     = mpfr_get_default_rounding_mode();                                    \
+        double (*dblFn)(double) = dblOp;                                                          \
+        if(dblFn && arr->isDouble() && rnd == MPFR_RNDN) {                                        \
+            res->addZeros(count);                                                                 \
+            const double *src = arr->getDoubles();                                                \
+            double *dst       = res->getDoubles();                                                \
+            for(size_t i = 0; i < count; ++i) dst[i] = dblFn(src[i]);                             \
+            return res;                                                                           \
+        }                                                                                         \
+        res->toMPFR();                                                                            \
+        res->addZeros(count);                                                                     \
+        mpfr_t tmp;                                                                               \
+        pool.initFlt(tmp, 53);                                                                    \
+        for(size_t i = 0; i < count; ++i) mpfr_##name(res->getPtr(i), arr->get(i, tmp), rnd);     \
+        pool.clearFlt(tmp);                                                                       \
+        return res;                                                                               \
+    }
+
+// sqrt() is correctly rounded by IEEE-754, and never overflows or underflows.
+MAPFA_FUNC(Sqrt, sqrt, [](double x) { return std::sqrt(x); })
+MAPFA_FUNC(Abs, abs, [](double x) { return std::fabs(x); })
+MAPFA_FUNC(Neg, neg, [](double x) { return -x; })
+// libm's exp() and log() are not correctly rounded.
+MAPFA_FUNC(Exp, exp, nullptr)
+MAPFA_FUNC(Log, log, nullptr)
+
+FERAL_FUNC(mpFltArraySum, 0, false,
+           "  var.fn() -> MPFlt\n"
+           "Returns the correctly rounded sum of all the elements in `var` as a new MPFlt.")
+{
+    VarMPFltArray *arr = as<VarMPFltArray>(args[0]);
+    Vector<mp_limb_t> limbs;
+    Vector<__mpfr_struct> vals;
+    arr->copyTo(limbs, vals);
+    Vector<mpfr_ptr> ptrs(vals.size());
+    for(size_t i = 0; i < vals.size(); ++i) ptrs[i] = &vals[i];
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, arr->getPrec());
+    mpfr_sum(res->getPtr(), ptrs.data(), ptrs.size(), mpfr_get_default_rounding_mode());
+    return res;
+}
+
+FERAL_FUNC(mpFltArrayDot, 1, false,
+           "  var.fn(other) -> MPFlt\n"
+           "Returns the correctly rounded dot product of `var` and the MPFltArray `other` (of the "
+           "same length) as a new MPFlt.")
+{
+    EXPECT(VarMPFltArray, args[1], "big float array");
+    VarMPFltArray *lhs = as<VarMPFltArray>(args[0]);
+    VarMPFltArray *rhs = as<VarMPFltArray>(args[1]);
+    if(lhs->size() != rhs->size()) {
+        vm.fail(loc, "big float array lengths must be equal, found: (", lhs->size(), ", ",
+                rhs->size(), ")");
+        return nullptr;
+    }
+    Vector<mp_limb_t> lhsLimbs, rhsLimbs;
+    Vector<__mpfr_struct> lhsVals, rhsVals;
+    lhs->copyTo(lhsLimbs, lhsVals);
+    rhs->copyTo(rhsLimbs, rhsVals);
+    size_t count  = lhsVals.size();
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, resultPrec(lhs->getPrec(), rhs->getPrec()));
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+#if MPFR_VERSION >= MPFR_VERSION_NUM(4, 1, 0)
+    Vector<mpfr_ptr> lhsPtrs(count), rhsPtrs(count);
+    for(size_t i = 0; i < count; ++i) {
+        lhsPtrs[i] = &lhsVals[i];
+        rhsPtrs[i] = &rhsVals[i];
+    }
+    mpfr_dot(res->getPtr(), lhsPtrs.data(), rhsPtrs.data(), count, rnd);
+#else
+    // The products are exact at the sum of the precisions, so only the sum rounds.
+    mpfr_prec_t prodPrec = lhs->getPrec() + rhs->getPrec();
+    Vector<__mpfr_struct> prods(count);
+    Vector<mpfr_ptr> ptrs(count);
+    for(size_t i = 0; i < count; ++i) {
+        mpfr_init2(&prods[i], prodPrec);
+        mpfr_mul(&prods[i], &lhsVals[i], &rhsVals[i], rnd);
+        ptrs[i] = &prods[i];
+    }
+    mpfr_sum(res->getPtr(), ptrs.data(), count, rnd);
+    for(auto &p : prods) mpfr_clear(&p);
+#endif // MPFR_VERSION
+    return res;
+}
+
+FERAL_FUNC(mpFltArrayLen, 0, false,
+           "  var.fn() -> Int\n"
+           "Returns the number of elements in `var`.")
+{
+    return vm.makeVar<VarInt>(loc, as<VarMPFltArray>(args[0])->size());
+}
+
+FERAL_FUNC(mpFltArrayGetPrec, 0, false,
+           "  var.fn() -> Int\n"
+           "Returns the precision (in bits) of the elements of `var`.")
+{
+    return vm.makeVar<VarInt>(loc, as<VarMPFltArray>(args[0])->getPrec());
+}
+
+// Fetches the index `arg` into `idx`, failing if it is out of the bounds of `size`.
+static bool getFltArrayIdx(VirtualMachine &vm, ModuleLoc loc, size_t size, Var *arg, size_t &idx)
+{
+    int64_t i = as<VarInt>(arg)->getVal();
+    if(i < 0 || (size_t)i >= size) {
+        vm.fail(loc, "index out of bounds - array size: ", size, ", index: ", i);
+        return false;
+    }
+    idx = i;
+    return true;
+}
+
+FERAL_FUNC(mpFltArrayAt, 1, false,
+           "  var.fn(idx) -> MPFlt\n"
+           "Returns the element at index `idx` in `var` as a new MPFlt.")
+{
+    EXPECT(VarInt, args[1], "index");
+    VarMPFltArray *arr = as<VarMPFltArray>(args[0]);
+    size_t idx;
+    if(!getFltArrayIdx(vm, loc, arr->size(), args[1], idx)) return nullptr;
+    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, arr->getPrec());
+    mpfr_set(res->getPtr(), arr->get(idx, res->getPtr()), MPFR_RNDN);
+    return res;
+}
+
+FERAL_FUNC(mpFltArraySet, 2, false,
+           "  var.fn(idx, value) -> var\n"
+           "Sets the element at index `idx` in `var` to `value` (Int / Flt / MPInt / MPFlt) and "
+           "returns `var`.")
+{
+    EXPECT(VarInt, args[1], "index");
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[2], "big float array value");
+    VarMPFltArray *arr = as<VarMPFltArray>(args[0]);
+    size_t idx;
+    if(!getFltArrayIdx(vm, loc, arr->size(), args[1], idx)) return nullptr;
+    mpfr_t tmp;
+    pool.initFlt(tmp, arr->getPrec());
+    getFltArrayElem(args[2], tmp);
+    arr->set(idx, tmp);
+    pool.clearFlt(tmp);
+    return args[0];
+}
+
+FERAL_FUNC(mpFltArrayPush, 1, false,
+           "  var.fn(value) -> var\n"
+           "Appends `value` (Int / Flt / MPInt / MPFlt) to `var` and returns `var`.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big float array value");
+    VarMPFltArray *arr = as<VarMPFltArray>(args[0]);
+    mpfr_t tmp;
+    pool.initFlt(tmp, arr->getPrec());
+    getFltArrayElem(args[1], tmp);
+    arr->push(tmp);
+    pool.clearFlt(tmp);
+    return args[0];
+}
+
+FERAL_FUNC(mpFltArrayToStr, 0, false,
+           "  var.fn() -> Str\n"
+           "Returns the string representation of `var`, with each element printed with enough "
+           "digits to represent it exactly.")
+{
+    VarMPFltArray *arr = as<VarMPFltArray>(args[0]);
+    VarStr *res        = vm.makeVar<VarStr>(loc, "[");
+    String &str        = res->getVal();
+    // Same as mpfr_get_str_ndigits(10, prec), which is only available since MPFR 4.1.
+    int digits = 1 + (int)std::ceil(arr->getPrec() * 0.30102999566398119521);
+    Vector<char> buf(digits + 32);
+    mpfr_t tmp;
+    pool.initFlt(tmp, 53);
+    for(size_t i = 0; i < arr->size(); ++i) {
+        mpfr_snprintf(buf.data(), buf.size(), "%.*Rg", digits, arr->get(i, tmp));
+        if(i > 0) str += ", ";
+        str += buf.data();
+    }
+    pool.clearFlt(tmp);
+    str += "]";
+    return res;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// Bytes Functions /////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Binary format of MP values, used by toBytes() / fromBytes() and MPWriter / MPReader.
+// Each value is its BytesKind (one byte) followed by its body. All numbers are little-endian,
+// whatever the host is, and big numbers are stored as 64 bit words, least significant first - so
+// on 64 bit little-endian hosts, they are copied to / from the limbs as is.
+//   Int:      i64 word count (negated for negative values), then the words of the magnitude.
+//   Flt:      u64 precision, u8 BytesFltClass, u8 sign (1 if negative), and for regular values,
+//             i64 exponent and the Int body of the significand (as an integer of up to
+//             `precision` bits), so that the value is significand * 2^exponent.
+//   Complex:  Flt bodies of the real and imaginary parts.
+//   IntArray: u64 count, then the Int body of each element.
+//   FltArray: u64 precision, u64 count, then the Flt body of each element.
+enum class BytesKind : uint8_t
+{
+    Int,
+    Flt,
+    Complex,
+    IntArray,
+    FltArray,
+};
+enum class BytesFltClass : uint8_t
+{
+    Zero,
+    Regular,
+    Inf,
+    NaN,
+};
+
+// Special values (zero, inf, nan) have no significand to check their precision against, so it is
+// bounded by this instead (as is the precision of arrays), so that corrupted data cannot make the
+// decoder allocate absurd amounts of memory.
+static constexpr uint64_t BYTES_MAX_SPECIAL_PREC = (uint64_t)1 << 32;
+// Size of the chunks in which an MPReader reads a value, so that a corrupted size cannot make it
+// allocate more than what the file actually holds.
+static constexpr size_t BYTES_READ_CHUNK = 1 << 20;
+
+static inline void bytesPutU64(String &out, uint64_t val)
+{
+    char buf[8];
+    for(int i = 0; i < 8; ++i) buf[i] = (char)(val >> (i * 8));
+    out.append(buf, 8);
+}
+
+static void bytesPutInt(String &out, mpz_srcptr val)
+{
+    size_t words = mpz_sgn(val) == 0 ? 0 : (mpz_sizeinbase(val, 2) + 63) / 64;
+    bytesPutU64(out, mpz_sgn(val) < 0 ? -(uint64_t)words : words);
+    if(words == 0) return;
+    size_t offset = out.size();
+    out.resize(offset + words * 8);
+    mpz_export(out.data() + offset, nullptr, -1, 8, -1, 0, val);
+}
+
+static void bytesPutFlt(String &out, mpfr_srcptr val, mpz_ptr scratch)
+{
+    BytesFltClass cls = mpfr_zero_p(val)  ? BytesFltClass::Zero
+                        : mpfr_inf_p(val) ? BytesFltClass::Inf
+                        : mpfr_nan_p(val) ? BytesFltClass::NaN
+                                          : BytesFltClass::Regular;
+    bytesPutU64(out, mpfr_get_prec(val));
+    out += (char)cls;
+    out += (char)(mpfr_signbit(val) != 0);
+    if(cls != BytesFltClass::Regular) return;
+    mpfr_exp_t expo = mpfr_get_z_2exp(scratch, val);
+    bytesPutU64(out, (uint64_t)(int64_t)expo);
+    mpz_abs(scratch, scratch);
+    bytesPutInt(out, scratch);
+}
+
+// Appends the encoding of the MPInt / MPFlt / MPComplex / MPIntArray / MPFltArray `var` to `out`,
+// returning false if it is of any other type.
+static bool bytesPutVar(String &out, Var *var)
+{
+    if(var->is<VarMPInt>()) {
+        out += (char)BytesKind::Int;
+        bytesPutInt(out, as<VarMPInt>(var)->getSrcPtr());
+        return true;
+    }
+    if(var->is<VarMPIntArray>()) {
+        VarMPIntArray *arr = as<VarMPIntArray>(var);
+        out += (char)BytesKind::IntArray;
+        bytesPutU64(out, arr->size());
+        out.reserve(out.size() + arr->size() * 8 + arr->getLimbCount() * sizeof(mp_limb_t));
+        mpz_t view;
+        for(size_t i = 0; i < arr->size(); ++i) bytesPutInt(out, arr->get(i, view));
+        return true;
+    }
+    mpz_t scratch;
+    if(var->is<VarMPFlt>()) {
+        pool.initInt(scratch);
+        out += (char)BytesKind::Flt;
+        bytesPutFlt(out, as<VarMPFlt>(var)->getSrcPtr(), scratch);
+    } else if(var->is<VarMPComplex>()) {
+        pool.initInt(scratch);
+        mpc_srcptr val = as<VarMPComplex>(var)->getSrcPtr();
+        out += (char)BytesKind::Complex;
+        bytesPutFlt(out, mpc_realref(val), scratch);
+        bytesPutFlt(out, mpc_imagref(val), scratch);
+    } else if(var->is<VarMPFltArray>()) {
+        pool.initInt(scratch);
+        VarMPFltArray *arr = as<VarMPFltArray>(var);
+        out += (char)BytesKind::FltArray;
+        bytesPutU64(out, arr->getPrec());
+        bytesPutU64(out, arr->size());
+        mpfr_t tmp;
+        pool.initFlt(tmp, std::max(arr->getPrec(), (mpfr_prec_t)53));
+        for(size_t i = 0; i < arr->size(); ++i) bytesPutFlt(out, arr->get(i, tmp), scratch);
+        pool.clearFlt(tmp);
+    } else {
+        return false;
+    }
+    pool.clearInt(scratch);
+    return true;
+}
+
+// Reads the binary format from a buffer - each function returns false (without ever reading past
+// the end of the buffer) if the data is truncated or malformed.
+struct BytesIn
+{
+    const unsigned char *curr;
+    const unsigned char *end;
+
+    BytesIn(StringRef data)
+        : curr((const unsigned char *)data.data()),
+          end((const unsigned char *)data.data() + data.size())
+    {}
+
+    inline size_t left() { return end - curr; }
+
+    inline bool getU8(uint8_t &val)
+    {
+        if(left() < 1) return false;
+        val = *curr++;
+        return true;
+    }
+    inline bool getU64(uint64_t &val)
+    {
+        if(left() < 8) return false;
+        val = 0;
+        for(int i = 0; i < 8; ++i) val |= (uint64_t)curr[i] << (i * 8);
+        curr += 8;
+        return true;
+    }
+
+    bool getInt(mpz_ptr val)
+    {
+        uint64_t size;
+        if(!getU64(size)) return false;
+        bool neg      = (int64_t)size < 0;
+        uint64_t words = neg ? -size : size;
+        if(words > left() / 8) return false;
+        mpz_import(val, words, -1, 8, -1, 0, curr);
+        if(neg) mpz_neg(val, val);
+        curr += words * 8;
+        return true;
+    }
+
+    // Sets the precision of `val` to the one of the encoded value.
+    bool getFlt(mpfr_ptr val, mpz_ptr scratch)
+    {
+        uint64_t prec, expo;
+        uint8_t cls, neg;
+        if(!getU64(prec) || !getU8(cls) || !getU8(neg)) return false;
+        if(prec < MPFR_PREC_MIN || prec > MPFR_PREC_MAX || cls > (uint8_t)BytesFltClass::NaN) {
+            return false;
+        }
+        if(cls == (uint8_t)BytesFltClass::Regular) {
+            // The exponent, the word count, and the words of the significand.
+            if((prec + 63) / 64 + 2 > left() / 8) return false;
+        } else if(prec > BYTES_MAX_SPECIAL_PREC) {
+            return false;
+        }
+        mpfr_set_prec(val, prec);
+        switch((BytesFltClass)cls) {
+        case BytesFltClass::Zero: mpfr_set_zero(val, neg ? -1 : 1); return true;
+        case BytesFltClass::Inf: mpfr_set_inf(val, neg ? -1 : 1); return true;
+        case BytesFltClass::NaN: mpfr_set_nan(val); return true;
+        case BytesFltClass::Regular: break;
+        }
+        if(!getU64(expo) || !getInt(scratch)) return false;
+        // The significand must fit in the precision, so that it is set exactly.
+        if(mpz_sgn(scratch) <= 0 || mpz_sizeinbase(scratch, 2) > prec) return false;
+        mpfr_set_z_2exp(val, scratch, (mpfr_exp_t)(int64_t)expo, MPFR_RNDN);
+        if(neg) mpfr_neg(val, val, MPFR_RNDN);
+        return true;
+    }
+};
+
+// Decodes the next value from `in` and returns it as a new Var, or nullptr if it is malformed.
+static Var *bytesGetVar(VirtualMachine &vm, ModuleLoc loc, BytesIn &in)
+{
+    uint8_t kind;
+    if(!in.getU8(kind)) return nullptr;
+    Var *res = nullptr;
+    bool ok  = false;
+    mpz_t scratch;
+    pool.initInt(scratch);
+    switch((BytesKind)kind) {
+    case BytesKind::Int: {
+        VarMPInt *val = vm.makeVar<VarMPInt>(loc, 0);
+        ok            = in.getInt(val->getPtr());
+        val->normalize();
+        res = val;
+        break;
+    }
+    case BytesKind::Flt: {
+        VarMPFlt *val = vm.makeVar<VarMPFlt>(loc, 0.0);
+        ok            = in.getFlt(val->getPtr(), scratch);
+        res           = val;
+        break;
+    }
+    case BytesKind::Complex: {
+        mpfr_t real, imag;
+        pool.initFlt(real, MPFR_PREC_MIN);
+        pool.initFlt(imag, MPFR_PREC_MIN);
+        ok = in.getFlt(real, scratch) && in.getFlt(imag, scratch);
+        if(ok) {
+            res = vm.makeVar<VarMPComplex>(loc, real, imag,
+                                           std::max(mpfr_get_prec(real), mpfr_get_prec(imag)));
+        }
+        pool.clearFlt(real);
+        pool.clearFlt(imag);
+        break;
+    }
+    case BytesKind::IntArray: {
+        uint64_t count;
+        if(!in.getU64(count) || count > in.left() / 8) break;
+        VarMPIntArray *arr = vm.makeVar<VarMPIntArray>(loc);
+        arr->reserve(count, in.left() / sizeof(mp_limb_t));
+        ok = true;
+        for(uint64_t i = 0; ok && i < count; ++i) {
+            ok = in.getInt(scratch);
+            if(ok) arr->push(scratch);
+        }
+        res = arr;
+        break;
+    }
+    case BytesKind::FltArray: {
+        uint64_t prec, count;
+        if(!in.getU64(prec) || !in.getU64(count)) break;
+        // Each element takes at least 10 bytes.
+        if(prec < MPFR_PREC_MIN || prec > BYTES_MAX_SPECIAL_PREC || count > in.left() / 10) break;
+        VarMPFltArray *arr = vm.makeVar<VarMPFltArray>(loc, prec);
+        mpfr_t tmp;
+        pool.initFlt(tmp, MPFR_PREC_MIN);
+        ok = true;
+        for(uint64_t i = 0; ok && i < count; ++i) {
+            ok = in.getFlt(tmp, scratch);
+            if(ok) arr->push(tmp);
+        }
+        pool.clearFlt(tmp);
+        res = arr;
+        break;
+    }
+    }
+    pool.clearInt(scratch);
+    if(!ok && res) {
+        vm.incVarRef(res);
+        vm.decVarRef(res);
+    }
+    return ok ? res : nullptr;
+}
+
+FERAL_FUNC(mpToBytes, 0, false,
+           "  var.fn() -> Str\n"
+           "Returns the exact binary encoding of `var` (which can be decoded by mp.fromBytes()) as "
+           "a Str of bytes.")
+{
+    VarStr *res = vm.makeVar<VarStr>(loc, "");
+    bytesPutVar(res->getVal(), args[0]);
+    return res;
+}
+
+FERAL_FUNC(mpFromBytes, 1, false,
+           "  fn(bytes) -> MPInt / MPFlt / MPComplex / MPIntArray / MPFltArray\n"
+           "Decodes the Str `bytes` (as returned by toBytes()) and returns the value.")
+{
+    EXPECT(VarStr, args[1], "bytes");
+    BytesIn in(as<VarStr>(args[1])->getVal());
+    Var *res = bytesGetVar(vm, loc, in);
+    if(res && in.left() > 0) {
+        vm.incVarRef(res);
+        vm.decVarRef(res);
+        res = nullptr;
+    }
+    if(!res) vm.fail(loc, "invalid or truncated MP bytes");
+    return res;
+}
+
+FERAL_FUNC(mpWriterNew, 1, false,
+           "  fn(path) -> MPWriter\n"
+           "Creates (or truncates) the file at `path`, and returns an MPWriter which writes MP "
+           "values to it.")
+{
+    EXPECT(VarStr, args[1], "file path");
+    const String &path = as<VarStr>(args[1])->getVal();
+    FILE *file         = fopen(path.c_str(), "wb");
+    if(!file) {
+        vm.fail(loc, "failed to open file for writing: ", path, " (", strerror(errno), ")");
+        return nullptr;
+    }
+    return vm.makeVar<VarMPWriter>(loc, file);
+}
+
+FERAL_FUNC(mpWriterWrite, 1, false,
+           "  var.fn(value) -> var\n"
+           "Writes the MPInt / MPFlt / MPComplex / MPIntArray / MPFltArray `value`, and returns "
+           "`var`.")
+{
+    VarMPWriter *writer = as<VarMPWriter>(args[0]);
+    if(!writer->getFile()) {
+        vm.fail(loc, "cannot write to a closed MPWriter");
+        return nullptr;
+    }
+    String &buf = writer->getBuf();
+    buf.clear();
+    // The size of the value, filled in once it is known.
+    bytesPutU64(buf, 0);
+    if(!bytesPutVar(buf, args[1])) {
+        vm.fail(loc, "expected an MPInt / MPFlt / MPComplex / MPIntArray / MPFltArray, found: ",
+                vm.getTypeName(args[1]));
+        return nullptr;
+    }
+    uint64_t size = buf.size() - 8;
+    for(int i = 0; i < 8; ++i) buf[i] = (char)(size >> (i * 8));
+    if(fwrite(buf.data(), 1, buf.size(), writer->getFile()) != buf.size()) {
+        vm.fail(loc, "failed to write to file (", strerror(errno), ")");
+        return nullptr;
+    }
+    return args[0];
+}
+
+FERAL_FUNC(mpWriterClose, 0, false,
+           "  var.fn() -> Nil\n"
+           "Flushes and closes the file of `var`.")
+{
+    if(!as<VarMPWriter>(args[0])->close()) {
+        vm.fail(loc, "failed to close file (", strerror(errno), ")");
+        return nullptr;
+    }
+    return vm.getNil();
+}
+
+FERAL_FUNC(mpReaderNew, 1, false,
+           "  fn(path) -> MPReader\n"
+           "Opens the file at `path`, and returns an MPReader which reads the MP values written to "
+           "it by an MPWriter.")
+{
+    EXPECT(VarStr, args[1], "file path");
+    const String &path = as<VarStr>(args[1])->getVal();
+    FILE *file         = fopen(path.c_str(), "rb");
+    if(!file) {
+        vm.fail(loc, "failed to open file for reading: ", path, " (", strerror(errno), ")");
+        return nullptr;
+    }
+    return vm.makeVar<VarMPReader>(loc, file);
+}
+
+FERAL_FUNC(mpReaderRead, 0, false,
+           "  var.fn() -> MPInt / MPFlt / MPComplex / MPIntArray / MPFltArray / Nil\n"
+           "Reads and returns the next value, or nil if there are no more.")
+{
+    VarMPReader *reader = as<VarMPReader>(args[0]);
+    FILE *file          = reader->getFile();
+    if(!file) {
+        vm.fail(loc, "cannot read from a closed MPReader");
+        return nullptr;
+    }
+    String &buf = reader->getBuf();
+    buf.resize(8);
+    size_t got = fread(buf.data(), 1, 8, file);
+    if(got == 0 && feof(file)) return vm.getNil();
+    uint64_t size = 0;
+    BytesIn header(buf);
+    if(got != 8 || !header.getU64(size)) {
+        vm.fail(loc, "truncated MP stream");
+        return nullptr;
+    }
+    for(size_t done = 0; done < size;) {
+        size_t chunk = std::min(size - done, (uint64_t)BYTES_READ_CHUNK);
+        buf.resize(done + chunk);
+        if(fread(buf.data() + done, 1, chunk, file) != chunk) {
+            vm.fail(loc, "truncated MP stream");
+            return nullptr;
+        }
+        done += chunk;
+    }
+    buf.resize(size);
+    BytesIn in(buf);
+    Var *res = bytesGetVar(vm, loc, in);
+    // As with fromBytes(), the value must take up the whole record.
+    if(res && in.left() > 0) {
+        vm.incVarRef(res);
+        vm.decVarRef(res);
+        res = nullptr;
+    }
+    if(!res) vm.fail(loc, "invalid MP value in stream");
+    return res;
+}
+
+FERAL_FUNC(mpReaderClose, 0, false,
+           "  var.fn() -> Nil\n"
+           "Closes the file of `var`.")
+{
+    as<VarMPReader>(args[0])->close();
+    return vm.getNil();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// IntStore Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Returns true if the `size` bytes at `data` hold a valid MPIntStore file (apart from the index
+// entries, which are checked when used, so that opening a store does not touch all of it).
+static bool isValidIntStore(const void *data, size_t size)
+{
+    if(size < sizeof(IntStoreHeader)) return false;
+    const IntStoreHeader *header = (const IntStoreHeader *)data;
+    if(memcmp(header->magic, INT_STORE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->limbBytes != sizeof(mp_limb_t) || header->byteOrder != INT_STORE_BYTE_ORDER)
+    {
+        return false;
+    }
+    size -= sizeof(IntStoreHeader);
+    if(header->limbCount > size / sizeof(mp_limb_t)) return false;
+    size -= header->limbCount * sizeof(mp_limb_t);
+    return header->count == size / sizeof(IntStoreElem) && size % sizeof(IntStoreElem) == 0;
+}
+
+FERAL_FUNC(mpIntStoreOpen, 1, false,
+           "  fn(path) -> MPIntStore\n"
+           "Memory-maps the MPIntStore file at `path` (written by an MPIntStoreWriter) and returns "
+           "the store.")
+{
+    EXPECT(VarStr, args[1], "file path");
+    const String &path = as<VarStr>(args[1])->getVal();
+    int fd             = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        vm.fail(loc, "failed to open file for reading: ", path, " (", strerror(errno), ")");
+        return nullptr;
+    }
+    struct stat st;
+    void *data  = MAP_FAILED;
+    size_t size = 0;
+    if(fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(IntStoreHeader)) {
+        size = st.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(data == MAP_FAILED || !isValidIntStore(data, size)) {
+        if(data != MAP_FAILED) munmap(data, size);
+        vm.fail(loc, "not a valid MPIntStore file: ", path);
+        return nullptr;
+    }
+    return vm.makeVar<VarMPIntStore>(loc, data, size);
+}
+
+FERAL_FUNC(mpIntStoreLen, 0, false,
+           "  var.fn() -> Int\n"
+           "Returns the number of elements in `var`.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)as<VarMPIntStore>(args[0])->size());
+}
+
+FERAL_FUNC(mpIntStoreAt, 1, false,
+           "  var.fn(idx) -> MPInt\n"
+           "Returns the element at index `idx` in `var` as a read-only view of it (which is only "
+           "copied if it is modified), which keeps `var` alive.")
+{
+    EXPECT(VarInt, args[1], "index");
+    VarMPIntStore *store = as<VarMPIntStore>(args[0]);
+    int64_t idx          = as<VarInt>(args[1])->getVal();
+    if(idx < 0 || (size_t)idx >= store->size()) {
+        vm.fail(loc, "index out of bounds - store size: ", store->size(), ", index: ", idx);
+        return nullptr;
+    }
+    const mp_limb_t *limbs;
+    mp_size_t size;
+    if(!store->get(idx, limbs, size)) {
+        vm.fail(loc, "corrupted MPIntStore index entry at index: ", idx);
+        return nullptr;
+    }
+    return vm.makeVar<VarMPInt>(loc, vm, store, limbs, size);
+}
+
+FERAL_FUNC(mpIntStoreWriterNew, 1, false,
+           "  fn(path) -> MPIntStoreWriter\n"
+           "Creates (or truncates) the file at `path`, and returns an MPIntStoreWriter which "
+           "writes an MPIntStore to it.")
 {
-    VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
-    mpfr_get_z(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(), MPFR_RNDN);
+    EXPECT(VarStr, args[1], "file path");
+    const String &path = as<VarStr>(args[1])->getVal();
+    FILE *file         = fopen(path.c_str(), "wb");
+    // Left empty until all the values are written.
+    IntStoreHeader header = {};
+    if(!file || fwrite(&header, sizeof(header), 1, file) != 1) {
+        vm.fail(loc, "failed to open file for writing: ", path, " (", strerror(errno), ")");
+        if(file) fclose(file);
+        return nullptr;
+    }
+    return vm.makeVar<VarMPIntStoreWriter>(loc, file);
+}
+
+FERAL_FUNC(mpIntStoreWriterPush, 1, false,
+           "  var.fn(value) -> var\n"
+           "Appends `value` (Int / MPInt), or all the elements of the MPIntArray `value`, to the "
+           "store and returns `var`.")
+{
+    EXPECT3(VarInt, VarMPInt, VarMPIntArray, args[1], "value");
+    VarMPIntStoreWriter *writer = as<VarMPIntStoreWriter>(args[0]);
+    if(!writer->isOpen()) {
+        vm.fail(loc, "cannot push to a closed MPIntStoreWriter");
+        return nullptr;
+    }
+    bool ok = true;
+    mpz_t view;
+    if(args[1]->is<VarInt>()) {
+        mp_limb_t limb;
+        int64_t val = as<VarInt>(args[1])->getVal();
+        limb        = val < 0 ? -(uint64_t)val : (uint64_t)val;
+        ok          = writer->push(mpz_roinit_n(view, &limb, val < 0 ? -1 : val > 0));
+    } else if(args[1]->is<VarMPInt>()) {
+        ok = writer->push(as<VarMPInt>(args[1])->getSrcPtr());
+    } else {
+        VarMPIntArray *arr = as<VarMPIntArray>(args[1]);
+        for(size_t i = 0; ok && i < arr->size(); ++i) ok = writer->push(arr->get(i, view));
+    }
+    if(!ok) {
+        vm.fail(loc, "failed to write to file (", strerror(errno), ")");
+        return nullptr;
+    }
+    return args[0];
+}
+
+FERAL_FUNC(mpIntStoreWriterClose, 0, false,
+           "  var.fn() -> Nil\n"
+           "Writes the index and the header of the store, and closes its file.")
+{
+    if(!as<VarMPIntStoreWriter>(args[0])->close()) {
+        vm.fail(loc, "failed to finish writing the MPIntStore file (", strerror(errno), ")");
+        return nullptr;
+    }
+    return vm.getNil();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////// ModContext Functions //////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+FERAL_FUNC(mpModContextNew, 1, false,
+           "  fn(mod) -> MPModContext\n"
+           "Creates and returns a new MPModContext for arithmetic modulo the positive Int / MPInt "
+           "`mod`.")
+{
+    EXPECT2(VarInt, VarMPInt, args[1], "modulus");
+    mpz_t mod;
+    pool.initInt(mod);
+    getIntArrayElem(args[1], mod);
+    if(mpz_sgn(mod) <= 0) {
+        pool.clearInt(mod);
+        vm.fail(loc, "modulus must be positive");
+        return nullptr;
+    }
+    VarMPModContext *res = vm.makeVar<VarMPModContext>(loc, mod);
+    pool.clearInt(mod);
     return res;
 }
 
-FERAL_FUNC(mpFltPow, 1, false,
-           "  var.fn(other) -> MPFlt\n"
-           "Raises `var` to the power of `other` and returns a new MPFlt with the result.")
+// Applies `op` (which returns false if the result does not exist) on `a` and `b` (nullptr for
+// unary operations) - each of which is an Int / MPInt, or an MPIntArray - and returns a new MPInt
+// with the result, or if either is an MPIntArray, a new MPIntArray with the results of `op` between
+// their elements (or the elements and a single value), in a single pass.
+// Unless `isAnyValue` is set, all the operands must be residues of `ctx`.
+template<typename Op>
+static Var *modApply(VirtualMachine &vm, ModuleLoc loc, VarMPModContext *ctx, Var *a, Var *b,
+                     bool isAnyValue, Op op)
+{
+    EXPECT3(VarInt, VarMPInt, VarMPIntArray, a, "residue");
+    if(b) {
+        EXPECT3(VarInt, VarMPInt, VarMPIntArray, b, "residue");
+    }
+    VarMPIntArray *aArr = a->is<VarMPIntArray>() ? as<VarMPIntArray>(a) : nullptr;
+    VarMPIntArray *bArr = b && b->is<VarMPIntArray>() ? as<VarMPIntArray>(b) : nullptr;
+    if(aArr && bArr && aArr->size() != bArr->size()) {
+        vm.fail(loc, "big int array lengths must be equal, found: (", aArr->size(), ", ",
+                bArr->size(), ")");
+        return nullptr;
+    }
+    mpz_t aVal, bVal, aView, bView;
+    pool.initInt(aVal);
+    pool.initInt(bVal);
+    if(!aArr) getIntArrayElem(a, aVal);
+    if(b && !bArr) getIntArrayElem(b, bVal);
+    size_t count   = aArr ? aArr->size() : bArr ? bArr->size() : 1;
+    bool isResidue = isAnyValue;
+    if(!isAnyValue) {
+        isResidue = (aArr || ctx->isResidue(aVal)) && (!b || bArr || ctx->isResidue(bVal));
+        for(size_t i = 0; aArr && isResidue && i < count; ++i) {
+            isResidue = ctx->isResidue(aArr->get(i, aView));
+        }
+        for(size_t i = 0; bArr && isResidue && i < count; ++i) {
+            isResidue = ctx->isResidue(bArr->get(i, bView));
+        }
+    }
+    if(!isResidue) {
+        pool.clearInt(aVal);
+        pool.clearInt(bVal);
+        vm.fail(loc, "expected residues of the context, in [0, modulus)");
+        return nullptr;
+    }
+    Var *res;
+    bool ok = true;
+    if(!aArr && !bArr) {
+        VarMPInt *val = vm.makeVar<VarMPInt>(loc, (int64_t)0);
+        ok            = op(val->getPtr(), aVal, bVal);
+        val->normalize();
+        res = val;
+    } else {
+        // Every result is a residue, so none needs more limbs than the modulus.
+        VarMPIntArray *arr = vm.makeVar<VarMPIntArray>(loc);
+        arr->addSlots(count, ctx->getLimbCount());
+        mpz_t tmp;
+        pool.initInt(tmp);
+        for(size_t i = 0; i < count && ok; ++i) {
+            ok = op(tmp, aArr ? aArr->get(i, aView) : aVal, bArr ? bArr->get(i, bView) : bVal);
+            arr->setInPlace(i, tmp);
+        }
+        pool.clearInt(tmp);
+        res = arr;
+    }
+    pool.clearInt(aVal);
+    pool.clearInt(bVal);
+    if(ok) return res;
+    vm.incVarRef(res);
+    vm.decVarRef(res);
+    vm.fail(loc, "value is not invertible modulo the modulus");
+    return nullptr;
+}
+
+FERAL_FUNC(mpModContextToResidue, 1, false,
+           "  var.fn(values) -> MPInt / MPIntArray\n"
+           "Returns the residue of `values` (an Int / MPInt, or an MPIntArray for a new "
+           "MPIntArray of residues).")
+{
+    VarMPModContext *ctx = as<VarMPModContext>(args[0]);
+    return modApply(vm, loc, ctx, args[1], nullptr, true,
+                    [ctx](mpz_ptr r, mpz_srcptr a, mpz_srcptr) {
+                        ctx->toResidue(r, a);
+                        return true;
+                    });
+}
+
+FERAL_FUNC(mpModContextFromResidue, 1, false,
+           "  var.fn(residues) -> MPInt / MPIntArray\n"
+           "Returns the value of `residues` (an MPInt, or an MPIntArray for a new MPIntArray of "
+           "values), in [0, modulus).")
+{
+    VarMPModContext *ctx = as<VarMPModContext>(args[0]);
+    return modApply(vm, loc, ctx, args[1], nullptr, false,
+                    [ctx](mpz_ptr r, mpz_srcptr a, mpz_srcptr) {
+                        ctx->fromResidue(r, a);
+                        return true;
+                    });
+}
+
+#define MODCTX_FUNC(fn, name, opname)                                                              \
+    FERAL_FUNC(mpModContext##fn, 2, false,                                                         \
+               "  var.fn(a, b) -> MPInt / MPIntArray\n"                                            \
+               "Returns the residue of the " opname " of the residues `a` and `b` - if either is " \
+               "an MPIntArray, a new MPIntArray with the results for each element (of both "       \
+               "arrays, which must have the same length) is returned instead.")                    \
+    {                                                                                              \
+        VarMPModContext *ctx = as<VarMPModContext>(args[0]);                                       \
+        return modApply(vm, loc, ctx, args[1], args[2], false,                                     \
+                        [ctx](mpz_ptr r, mpz_srcptr a, mpz_srcptr b) {                             \
+                            ctx->name(r, a, b);                                                    \
+                            return true;                                                           \
+                        });                                                                        \
+    }
+
+MODCTX_FUNC(Add, add, "sum")
+MODCTX_FUNC(Sub, sub, "difference")
+MODCTX_FUNC(Mul, mul, "product")
+
+FERAL_FUNC(mpModContextSqr, 1, false,
+           "  var.fn(a) -> MPInt / MPIntArray\n"
+           "Returns the residue of the square of the residue `a` - or a new MPIntArray with the "
+           "results for each element, if `a` is an MPIntArray.")
+{
+    VarMPModContext *ctx = as<VarMPModContext>(args[0]);
+    return modApply(vm, loc, ctx, args[1], nullptr, false,
+                    [ctx](mpz_ptr r, mpz_srcptr a, mpz_srcptr) {
+                        ctx->mul(r, a, a);
+                        return true;
+                    });
+}
+
+FERAL_FUNC(mpModContextPow, 2, false,
+           "  var.fn(a, exp) -> MPInt / MPIntArray\n"
+           "Returns the residue of the residue `a` raised to the power of the Int / MPInt `exp` - "
+           "or a new MPIntArray with the results for each element, if `a` is an MPIntArray.\n"
+           "A negative `exp` uses the inverse of `a`, failing if there is none.")
+{
+    EXPECT2(VarInt, VarMPInt, args[2], "exponent");
+    VarMPModContext *ctx = as<VarMPModContext>(args[0]);
+    mpz_t exp;
+    pool.initInt(exp);
+    getIntArrayElem(args[2], exp);
+    Var *res = modApply(vm, loc, ctx, args[1], nullptr, false,
+                        [ctx, &exp](mpz_ptr r, mpz_srcptr a, mpz_srcptr) {
+                            return ctx->pow(r, a, exp);
+                        });
+    pool.clearInt(exp);
+    return res;
+}
+
+FERAL_FUNC(mpModContextGetMod, 0, false,
+           "  var.fn() -> MPInt\n"
+           "Returns the modulus of `var` as a new MPInt.")
+{
+    return vm.makeVar<VarMPInt>(loc, as<VarMPModContext>(args[0])->getMod());
+}
+
+FERAL_FUNC(mpModContextIsMontgomery, 0, false,
+           "  var.fn() -> Bool\n"
+           "Returns true if the residues of `var` are in Montgomery form (as opposed to the "
+           "reduced values themselves).")
+{
+    return vm.getBool(as<VarMPModContext>(args[0])->isMontgomery());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////// Parallel Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Operations which parallelMap() / parallelReduce() can apply.
+enum class ParallelOp
+{
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Pow,
+    Root,
+    Powm,
+    Gcd,
+    Lcm,
+    Min,
+    Max,
+    Sqr,
+    Sqrt,
+    Neg,
+    Abs,
+    NextPrime,
+    IsProbablePrime,
+    Exp,
+    Log,
+    Sin,
+    Cos,
+};
+
+// Kinds of values that a parallel operation applies to.
+enum ParallelKind : unsigned
+{
+    PARALLEL_NONE    = 0,
+    PARALLEL_INT     = 1 << 0,
+    PARALLEL_FLT     = 1 << 1,
+    PARALLEL_COMPLEX = 1 << 2,
+    PARALLEL_ALL     = PARALLEL_INT | PARALLEL_FLT | PARALLEL_COMPLEX,
+};
+
+struct ParallelOpInfo
+{
+    const char *name;
+    ParallelOp op;
+    ArithOp arith;
+    unsigned mapKinds;    // kinds of values it can be mapped over
+    unsigned reduceKinds; // kinds of values it can reduce
+    size_t minArgs;       // number of operands (besides the value) when mapped
+    size_t maxArgs;
+};
+
+static const ParallelOpInfo parallelOps[] = {
+    {"add", ParallelOp::Add, ArithOp::Add, PARALLEL_ALL, PARALLEL_ALL, 1, 1},
+    {"sub", ParallelOp::Sub, ArithOp::Sub, PARALLEL_ALL, 0, 1, 1},
+    {"mul", ParallelOp::Mul, ArithOp::Mul, PARALLEL_ALL, PARALLEL_ALL, 1, 1},
+    {"div", ParallelOp::Div, ArithOp::Div, PARALLEL_ALL, 0, 1, 1},
+    {"mod", ParallelOp::Mod, ArithOp::None, PARALLEL_INT, 0, 1, 1},
+    {"pow", ParallelOp::Pow, ArithOp::None, PARALLEL_ALL, 0, 1, 1},
+    {"root", ParallelOp::Root, ArithOp::None, PARALLEL_INT, 0, 1, 1},
+    {"powm", ParallelOp::Powm, ArithOp::None, PARALLEL_INT, 0, 2, 2},
+    {"gcd", ParallelOp::Gcd, ArithOp::None, PARALLEL_INT, PARALLEL_INT, 1, 1},
+    {"lcm", ParallelOp::Lcm, ArithOp::None, PARALLEL_INT, PARALLEL_INT, 1, 1},
+    {"min", ParallelOp::Min, ArithOp::None, 0, PARALLEL_INT | PARALLEL_FLT, 0, 0},
+    {"max", ParallelOp::Max, ArithOp::None, 0, PARALLEL_INT | PARALLEL_FLT, 0, 0},
+    {"sqr", ParallelOp::Sqr, ArithOp::None, PARALLEL_ALL, 0, 0, 0},
+    {"sqrt", ParallelOp::Sqrt, ArithOp::None, PARALLEL_ALL, 0, 0, 0},
+    {"neg", ParallelOp::Neg, ArithOp::None, PARALLEL_ALL, 0, 0, 0},
+    {"abs", ParallelOp::Abs, ArithOp::None, PARALLEL_INT | PARALLEL_FLT, 0, 0, 0},
+    {"nextPrime", ParallelOp::NextPrime, ArithOp::None, PARALLEL_INT, 0, 0, 0},
+    {"isProbablePrime", ParallelOp::IsProbablePrime, ArithOp::None, PARALLEL_INT, 0, 0, 1},
+    {"exp", ParallelOp::Exp, ArithOp::None, PARALLEL_FLT | PARALLEL_COMPLEX, 0, 0, 0},
+    {"log", ParallelOp::Log, ArithOp::None, PARALLEL_FLT | PARALLEL_COMPLEX, 0, 0, 0},
+    {"sin", ParallelOp::Sin, ArithOp::None, PARALLEL_FLT | PARALLEL_COMPLEX, 0, 0, 0},
+    {"cos", ParallelOp::Cos, ArithOp::None, PARALLEL_FLT | PARALLEL_COMPLEX, 0, 0, 0},
+};
+
+// Number of chunks a reduction is split into (at most) - fixed, so that the grouping of the
+// operations (which matters for rounding) only depends on the number of values.
+static constexpr size_t PARALLEL_REDUCE_CHUNKS = 64;
+// Number of chunks per worker thread a map is split into, so that uneven chunks can be balanced
+// out by stealing.
+static constexpr size_t PARALLEL_MAP_CHUNKS_PER_THREAD = 4;
+
+static const ParallelOpInfo *findParallelOp(StringRef name)
+{
+    for(auto &info : parallelOps) {
+        if(name == info.name) return &info;
+    }
+    return nullptr;
+}
+
+// Fetches the kind of the MPInt / MPFlt / MPComplex `values`, which must all be of the same type,
+// into `kind` (PARALLEL_NONE if there are none).
+static bool getParallelKind(VirtualMachine &vm, ModuleLoc loc, Vector<Var *> &values,
+                            unsigned &kind)
+{
+    kind = PARALLEL_NONE;
+    for(size_t i = 0; i < values.size(); ++i) {
+        unsigned elemKind = values[i]->is<VarMPInt>()       ? PARALLEL_INT
+                            : values[i]->is<VarMPFlt>()     ? PARALLEL_FLT
+                            : values[i]->is<VarMPComplex>() ? PARALLEL_COMPLEX
+                                                            : PARALLEL_NONE;
+        if(i == 0) kind = elemKind;
+        if(elemKind == PARALLEL_NONE || elemKind != kind) {
+            vm.fail(loc, "expected MPInt / MPFlt / MPComplex values all of the same type, found: ",
+                    vm.getTypeName(values[i]), " at index ", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char *parallelKindName(unsigned kind)
+{
+    return kind == PARALLEL_INT ? "MPInt" : kind == PARALLEL_FLT ? "MPFlt" : "MPComplex";
+}
+
+// Operands of a mapped operation, fetched on the VM thread so that the workers only ever read
+// them.
+// Int operands are kept as IntOperands, and small MPInts are replaced by Ints for the others, as
+// reading them through getSrcPtr() writes their view.
+class ParallelArgs
+{
+    VirtualMachine &vm;
+    std::unique_ptr<IntOperand> intOps[2];
+    Var *owned[2];
+
+public:
+    Var *vals[2];
+    mpz_srcptr ints[2];
+    unsigned long ui;
+    int reps;
+
+    ParallelArgs(VirtualMachine &vm) : vm(vm), owned{}, vals{}, ints{}, ui(0), reps(25) {}
+    ~ParallelArgs()
+    {
+        for(Var *var : owned) {
+            if(var) vm.decVarRef(var);
+        }
+    }
+
+    void setVal(ModuleLoc loc, size_t idx, Var *arg)
+    {
+        vals[idx] = arg;
+        if(!arg->is<VarMPInt>() || !as<VarMPInt>(arg)->isSmall()) return;
+        owned[idx] = vm.makeVar<VarInt>(loc, as<VarMPInt>(arg)->getSmall());
+        vm.incVarRef(owned[idx]);
+        vals[idx] = owned[idx];
+    }
+    void setInt(size_t idx, Var *arg)
+    {
+        intOps[idx].reset(new IntOperand(arg));
+        ints[idx] = intOps[idx]->get();
+    }
+};
+
+// Fetches the operands `args` of the mapped operation `info` over the `values` of `kind` into
+// `res`, failing if they (or the values) are not valid for it.
+static bool getParallelArgs(VirtualMachine &vm, ModuleLoc loc, const ParallelOpInfo &info,
+                            unsigned kind, Vector<Var *> &values, Vector<Var *> &args,
+                            ParallelArgs &res)
+{
+    if(args.size() < info.minArgs || args.size() > info.maxArgs) {
+        vm.fail(loc, "operation '", info.name, "' takes ", info.minArgs, " to ", info.maxArgs,
+                " operands, found: ", args.size());
+        return false;
+    }
+    for(size_t i = 0; i < args.size(); ++i) {
+        Var *arg = args[i];
+        bool isIntOnly = kind == PARALLEL_INT && info.arith == ArithOp::None &&
+                         info.op != ParallelOp::Mod;
+        bool isValid   = arg->is<VarInt>() || arg->is<VarMPInt>() ||
+                       (!isIntOnly && (arg->is<VarFlt>() || arg->is<VarMPFlt>())) ||
+                       (kind == PARALLEL_COMPLEX && arg->is<VarMPComplex>());
+        if(!isValid) {
+            vm.fail(loc, "invalid operand for operation '", info.name, "' over ",
+                    parallelKindName(kind), " values, found: ", vm.getTypeName(arg));
+            return false;
+        }
+        if(kind != PARALLEL_INT) res.setVal(loc, i, arg);
+        else if(info.op != ParallelOp::IsProbablePrime) res.setInt(i, arg);
+    }
+    if(kind != PARALLEL_INT) return true;
+    switch(info.op) {
+    case ParallelOp::Div:
+    case ParallelOp::Mod:
+        if(mpz_sgn(res.ints[0]) == 0) {
+            vm.fail(loc, "division by zero");
+            return false;
+        }
+        break;
+    case ParallelOp::Pow: return getUiArg(vm, loc, args[0], "power", res.ui);
+    case ParallelOp::Root:
+        if(!getUiArg(vm, loc, args[0], "root", res.ui)) return false;
+        if(res.ui == 0) {
+            vm.fail(loc, "root must be positive");
+            return false;
+        }
+        if(res.ui % 2 == 1) break;
+        // fallthrough
+    case ParallelOp::Sqrt:
+        for(Var *val : values) {
+            if(mpz_sgn(as<VarMPInt>(val)->getSrcPtr()) >= 0) continue;
+            vm.fail(loc, "cannot take an even root of a negative value");
+            return false;
+        }
+        break;
+    case ParallelOp::Powm:
+        if(mpz_sgn(res.ints[0]) < 0) {
+            vm.fail(loc, "exponent cannot be negative for a parallel powm");
+            return false;
+        }
+        if(mpz_sgn(res.ints[1]) == 0) {
+            vm.fail(loc, "modulus cannot be zero");
+            return false;
+        }
+        break;
+    case ParallelOp::IsProbablePrime:
+        if(args.empty()) break;
+        if(!args[0]->is<VarInt>()) {
+            vm.fail(loc, "expected an Int for the repetition count, found: ",
+                    vm.getTypeName(args[0]));
+            return false;
+        }
+        if(as<VarInt>(args[0])->getVal() < 1 || as<VarInt>(args[0])->getVal() > INT_MAX) {
+            vm.fail(loc, "repetition count must be positive, found: ",
+                    as<VarInt>(args[0])->getVal());
+            return false;
+        }
+        res.reps = as<VarInt>(args[0])->getVal();
+        break;
+    default: break;
+    }
+    return true;
+}
+
+// Applies the mapped operation `op` on `val` (with the operands `args`) into `res`.
+// The MPInt one returns the result of IsProbablePrime (which leaves `res` untouched).
+static int intParallelApply(ParallelOp op, mpz_ptr res, mpz_srcptr val, const ParallelArgs &args)
+{
+    switch(op) {
+    case ParallelOp::Add: mpz_add(res, val, args.ints[0]); break;
+    case ParallelOp::Sub: mpz_sub(res, val, args.ints[0]); break;
+    case ParallelOp::Mul: mpz_mul(res, val, args.ints[0]); break;
+    case ParallelOp::Div: mpz_fdiv_q(res, val, args.ints[0]); break;
+    case ParallelOp::Mod: mpz_mod(res, val, args.ints[0]); break;
+    case ParallelOp::Pow: mpz_pow_ui(res, val, args.ui); break;
+    case ParallelOp::Root: mpz_root(res, val, args.ui); break;
+    case ParallelOp::Powm: mpz_powm(res, val, args.ints[0], args.ints[1]); break;
+    case ParallelOp::Gcd: mpz_gcd(res, val, args.ints[0]); break;
+    case ParallelOp::Lcm: mpz_lcm(res, val, args.ints[0]); break;
+    case ParallelOp::Sqr: mpz_mul(res, val, val); break;
+    case ParallelOp::Sqrt: mpz_sqrt(res, val); break;
+    case ParallelOp::Neg: mpz_neg(res, val); break;
+    case ParallelOp::Abs: mpz_abs(res, val); break;
+    case ParallelOp::NextPrime: mpz_nextprime(res, val); break;
+    case ParallelOp::IsProbablePrime: return mpz_probab_prime_p(val, args.reps);
+    default: break;
+    }
+    return 0;
+}
+static void fltParallelApply(const ParallelOpInfo &info, mpfr_ptr res, mpfr_srcptr val,
+                             const ParallelArgs &args)
+{
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    switch(info.op) {
+    case ParallelOp::Add:
+    case ParallelOp::Sub:
+    case ParallelOp::Mul:
+    case ParallelOp::Div: fltArith(res, val, args.vals[0], info.arith); break;
+    case ParallelOp::Pow: fltPow(res, val, args.vals[0]); break;
+    case ParallelOp::Sqr: mpfr_sqr(res, val, rnd); break;
+    case ParallelOp::Sqrt: mpfr_sqrt(res, val, rnd); break;
+    case ParallelOp::Neg: mpfr_neg(res, val, rnd); break;
+    case ParallelOp::Abs: mpfr_abs(res, val, rnd); break;
+    case ParallelOp::Exp: mpfr_exp(res, val, rnd); break;
+    case ParallelOp::Log: mpfr_log(res, val, rnd); break;
+    case ParallelOp::Sin: mpfr_sin(res, val, rnd); break;
+    case ParallelOp::Cos: mpfr_cos(res, val, rnd); break;
+    default: break;
+    }
+}
+static void complexParallelApply(const ParallelOpInfo &info, mpc_ptr res, mpc_srcptr val,
+                                 const ParallelArgs &args)
+{
+    mpc_rnd_t rnd = mpc_get_default_rounding_mode();
+    switch(info.op) {
+    case ParallelOp::Add:
+    case ParallelOp::Sub:
+    case ParallelOp::Mul:
+    case ParallelOp::Div: complexArith(res, val, args.vals[0], info.arith, false); break;
+    case ParallelOp::Pow: complexPow(res, val, args.vals[0]); break;
+    case ParallelOp::Sqr: mpc_sqr(res, val, rnd); break;
+    case ParallelOp::Sqrt: mpc_sqrt(res, val, rnd); break;
+    case ParallelOp::Neg: mpc_neg(res, val, rnd); break;
+    case ParallelOp::Exp: mpc_exp(res, val, rnd); break;
+    case ParallelOp::Log: mpc_log(res, val, rnd); break;
+    case ParallelOp::Sin: mpc_sin(res, val, rnd); break;
+    case ParallelOp::Cos: mpc_cos(res, val, rnd); break;
+    default: break;
+    }
+}
+
+// Reduces the `count` (> 0) `vals` with `op` into `res`.
+static void intParallelReduce(ParallelOp op, mpz_ptr res, const mpz_srcptr *vals, size_t count,
+                              size_t threads)
+{
+    if(op == ParallelOp::Mul) {
+        intProduct(res, vals, count, threads);
+        return;
+    }
+    if(op == ParallelOp::Min || op == ParallelOp::Max) {
+        mpz_srcptr best = vals[0];
+        for(size_t i = 1; i < count; ++i) {
+            int cmp = mpz_cmp(vals[i], best);
+            if(op == ParallelOp::Min ? cmp < 0 : cmp > 0) best = vals[i];
+        }
+        mpz_set(res, best);
+        return;
+    }
+    mpz_set(res, vals[0]);
+    for(size_t i = 1; i < count; ++i) {
+        if(op == ParallelOp::Add) mpz_add(res, res, vals[i]);
+        else if(op == ParallelOp::Gcd) mpz_gcd(res, res, vals[i]);
+        else mpz_lcm(res, res, vals[i]);
+    }
+}
+static void fltParallelReduce(ParallelOp op, mpfr_ptr res, const mpfr_srcptr *vals, size_t count)
+{
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    mpfr_set(res, vals[0], rnd);
+    for(size_t i = 1; i < count; ++i) {
+        switch(op) {
+        case ParallelOp::Add: mpfr_add(res, res, vals[i], rnd); break;
+        case ParallelOp::Mul: mpfr_mul(res, res, vals[i], rnd); break;
+        case ParallelOp::Min: mpfr_min(res, res, vals[i], rnd); break;
+        case ParallelOp::Max: mpfr_max(res, res, vals[i], rnd); break;
+        default: break;
+        }
+    }
+}
+static void complexParallelReduce(ParallelOp op, mpc_ptr res, const mpc_srcptr *vals,
+                                  size_t count)
+{
+    mpc_rnd_t rnd = mpc_get_default_rounding_mode();
+    mpc_set(res, vals[0], rnd);
+    for(size_t i = 1; i < count; ++i) {
+        if(op == ParallelOp::Add) mpc_add(res, res, vals[i], rnd);
+        else mpc_mul(res, res, vals[i], rnd);
+    }
+}
+
+// Returns a new Vec holding the `results`.
+static VarVec *makeResultVec(VirtualMachine &vm, ModuleLoc loc, Vector<Var *> &results)
+{
+    VarVec *res = vm.makeVar<VarVec>(loc, results.size(), false);
+    for(Var *e : results) {
+        vm.incVarRef(e);
+        res->getVal().push_back(e);
+    }
+    return res;
+}
+
+FERAL_FUNC(mpParallelMapNative, 3, false,
+           "  fn(values, op, args) -> Vec\n"
+           "Applies the operation named `op` (like 'powm' or 'sqrt') to each of the MPInt / MPFlt "
+           "/ MPComplex `values` (which must all be of the same type), with the other operands "
+           "`args`, on the library's worker threads, and returns a Vec of the results.")
+{
+    EXPECT(VarVec, args[1], "values");
+    EXPECT(VarStr, args[2], "operation name");
+    EXPECT(VarVec, args[3], "operation operands");
+    Vector<Var *> &values     = as<VarVec>(args[1])->getVal();
+    const ParallelOpInfo *info = findParallelOp(as<VarStr>(args[2])->getVal());
+    unsigned kind;
+    if(!getParallelKind(vm, loc, values, kind)) return nullptr;
+    if(values.empty()) return vm.makeVar<VarVec>(loc, 0, false);
+    if(!info || !(info->mapKinds & kind)) {
+        vm.fail(loc, "no parallel map operation '", as<VarStr>(args[2])->getVal(), "' for ",
+                parallelKindName(kind), " values");
+        return nullptr;
+    }
+    ParallelArgs opArgs(vm);
+    if(!getParallelArgs(vm, loc, *info, kind, values, as<VarVec>(args[3])->getVal(), opArgs)) {
+        return nullptr;
+    }
+
+    // The results are made here, and the workers only fill them in.
+    size_t count = values.size();
+    Vector<Var *> results(count);
+    Vector<int> primality;
+    std::function<void(size_t)> apply;
+    if(kind == PARALLEL_INT) {
+        Vector<mpz_srcptr> vals(count);
+        Vector<mpz_ptr> ptrs(count);
+        for(size_t i = 0; i < count; ++i) vals[i] = as<VarMPInt>(values[i])->getSrcPtr();
+        if(info->op == ParallelOp::IsProbablePrime) {
+            primality.resize(count);
+        } else {
+            for(size_t i = 0; i < count; ++i) {
+                VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+                results[i]    = res;
+                ptrs[i]       = res->getPtr();
+            }
+        }
+        apply = [&, vals = std::move(vals), ptrs = std::move(ptrs)](size_t i) {
+            int prime = intParallelApply(info->op, ptrs[i], vals[i], opArgs);
+            if(!primality.empty()) primality[i] = prime;
+        };
+    } else if(kind == PARALLEL_FLT) {
+        mpfr_prec_t argPrec = opArgs.vals[0] && opArgs.vals[0]->is<VarMPFlt>()
+                                  ? as<VarMPFlt>(opArgs.vals[0])->getPrec()
+                                  : MPFR_PREC_MIN;
+        for(size_t i = 0; i < count; ++i) {
+            mpfr_prec_t prec = resultPrec(as<VarMPFlt>(values[i])->getPrec(), argPrec);
+            results[i]       = vm.makeVar<VarMPFlt>(loc, 0.0, prec);
+        }
+        apply = [&](size_t i) {
+            fltParallelApply(*info, as<VarMPFlt>(results[i])->getPtr(),
+                             as<VarMPFlt>(values[i])->getSrcPtr(), opArgs);
+        };
+    } else {
+        for(size_t i = 0; i < count; ++i) {
+            Var *arg = opArgs.vals[0];
+            results[i] =
+                vm.makeVar<VarMPComplex>(loc, arg ? complexResultPrec(values[i], arg)
+                                                  : as<VarMPComplex>(values[i])->getPrec());
+        }
+        apply = [&](size_t i) {
+            complexParallelApply(*info, as<VarMPComplex>(results[i])->getPtr(),
+                                 as<VarMPComplex>(values[i])->getSrcPtr(), opArgs);
+        };
+    }
+
+    // The default rounding mode is per thread in MPFR.
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    workerPool.run(count, workerPool.getThreadCount() * PARALLEL_MAP_CHUNKS_PER_THREAD,
+                   [&](size_t, size_t begin, size_t end) {
+                       mpfr_set_default_rounding_mode(rnd);
+                       for(size_t i = begin; i < end; ++i) apply(i);
+                   });
+
+    if(!primality.empty()) {
+        for(size_t i = 0; i < count; ++i) {
+            results[i] = vm.getBool(primality[i] > 0);
+        }
+    } else if(kind == PARALLEL_INT) {
+        for(Var *res : results) as<VarMPInt>(res)->normalize();
+    }
+    return makeResultVec(vm, loc, results);
+}
+
+FERAL_FUNC(mpParallelReduceNative, 2, false,
+           "  fn(values, op) -> MPInt / MPFlt / MPComplex\n"
+           "Reduces the MPInt / MPFlt / MPComplex `values` (which must all be of the same type) "
+           "with the operation named `op` (one of 'add', 'mul', 'min', 'max', 'gcd' and 'lcm'), "
+           "on the library's worker threads, and returns the result.\n"
+           "The values are split into up to 64 chunks which are reduced in parallel, and then "
+           "their results are reduced - the grouping only depends on the number of values.")
+{
+    EXPECT(VarVec, args[1], "values");
+    EXPECT(VarStr, args[2], "operation name");
+    Vector<Var *> &values     = as<VarVec>(args[1])->getVal();
+    const ParallelOpInfo *info = findParallelOp(as<VarStr>(args[2])->getVal());
+    unsigned kind;
+    if(!getParallelKind(vm, loc, values, kind)) return nullptr;
+    if(values.empty()) {
+        vm.fail(loc, "cannot reduce an empty list of values");
+        return nullptr;
+    }
+    if(!info || !(info->reduceKinds & kind)) {
+        vm.fail(loc, "no parallel reduce operation '", as<VarStr>(args[2])->getVal(), "' for ",
+                parallelKindName(kind), " values");
+        return nullptr;
+    }
+
+    size_t count   = values.size();
+    size_t chunks  = std::min(count, PARALLEL_REDUCE_CHUNKS);
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    ParallelOp op  = info->op;
+    // Each chunk is reduced into a partial result, and the partial results are then reduced on
+    // this thread.
+    if(kind == PARALLEL_INT) {
+        Vector<mpz_srcptr> vals(count);
+        for(size_t i = 0; i < count; ++i) vals[i] = as<VarMPInt>(values[i])->getSrcPtr();
+        Vector<__mpz_struct> partials(chunks);
+        Vector<mpz_srcptr> partialPtrs(chunks);
+        for(size_t i = 0; i < chunks; ++i) {
+            pool.initInt(&partials[i]);
+            partialPtrs[i] = &partials[i];
+        }
+        workerPool.run(count, chunks, [&](size_t chunk, size_t begin, size_t end) {
+            intParallelReduce(op, &partials[chunk], &vals[begin], end - begin, 1);
+        });
+        VarMPInt *res = vm.makeVar<VarMPInt>(loc, 0);
+        intParallelReduce(op, res->getPtr(), partialPtrs.data(), chunks, getMulThreads());
+        res->normalize();
+        for(auto &partial : partials) pool.clearInt(&partial);
+        return res;
+    }
+    if(kind == PARALLEL_FLT) {
+        Vector<mpfr_srcptr> vals(count);
+        mpfr_prec_t prec = MPFR_PREC_MIN;
+        for(size_t i = 0; i < count; ++i) {
+            vals[i] = as<VarMPFlt>(values[i])->getSrcPtr();
+            prec    = resultPrec(prec, as<VarMPFlt>(values[i])->getPrec());
+        }
+        Vector<__mpfr_struct> partials(chunks);
+        Vector<mpfr_srcptr> partialPtrs(chunks);
+        for(size_t i = 0; i < chunks; ++i) {
+            pool.initFlt(&partials[i], prec);
+            partialPtrs[i] = &partials[i];
+        }
+        workerPool.run(count, chunks, [&](size_t chunk, size_t begin, size_t end) {
+            mpfr_set_default_rounding_mode(rnd);
+            fltParallelReduce(op, &partials[chunk], &vals[begin], end - begin);
+        });
+        VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0, prec);
+        fltParallelReduce(op, res->getPtr(), partialPtrs.data(), chunks);
+        for(auto &partial : partials) pool.clearFlt(&partial);
+        return res;
+    }
+    Vector<mpc_srcptr> vals(count);
+    mpfr_prec_t prec = MPFR_PREC_MIN;
+    for(size_t i = 0; i < count; ++i) {
+        vals[i] = as<VarMPComplex>(values[i])->getSrcPtr();
+        prec    = resultPrec(prec, as<VarMPComplex>(values[i])->getPrec());
+    }
+    Vector<__mpc_struct> partials(chunks);
+    Vector<mpc_srcptr> partialPtrs(chunks);
+    for(size_t i = 0; i < chunks; ++i) {
+        pool.initComplex(&partials[i], prec);
+        partialPtrs[i] = &partials[i];
+    }
+    workerPool.run(count, chunks, [&](size_t chunk, size_t begin, size_t end) {
+        complexParallelReduce(op, &partials[chunk], &vals[begin], end - begin);
+    });
+    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, prec);
+    complexParallelReduce(op, res->getPtr(), partialPtrs.data(), chunks);
+    for(auto &partial : partials) pool.clearComplex(&partial);
+    return res;
+}
+
+FERAL_FUNC(workerGetThreads, 0, false,
+           "  fn() -> Int\n"
+           "Returns the number of worker threads that the parallel operations run on.")
+{
+    return vm.makeVar<VarInt>(loc, (int64_t)workerPool.getThreadCount());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// Future Functions ////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Future operation with an MPInt result.
+struct IntFutureOp : VarMPFuture::Op
+{
+    mpz_t res;
+
+    IntFutureOp() { mpz_init(res); }
+    ~IntFutureOp() { mpz_clear(res); }
+
+    Var *getResult(VirtualMachine &vm, ModuleLoc loc) override
+    {
+        return vm.makeVar<VarMPInt>(loc, res);
+    }
+};
+
+// Future operation with an MPFlt result, of precision `prec`.
+struct FltFutureOp : VarMPFuture::Op
+{
+    mpfr_t res;
+
+    FltFutureOp(mpfr_prec_t prec) { mpfr_init2(res, prec); }
+    ~FltFutureOp() { mpfr_clear(res); }
+
+    Var *getResult(VirtualMachine &vm, ModuleLoc loc) override
+    {
+        return vm.makeVar<VarMPFlt>(loc, res);
+    }
+};
+
+// Future operation with a Str result.
+struct StrFutureOp : VarMPFuture::Op
+{
+    String res;
+
+    Var *getResult(VirtualMachine &vm, ModuleLoc loc) override
+    {
+        return vm.makeVar<VarStr>(loc, res);
+    }
+};
+
+struct IntPowFutureOp : IntFutureOp
+{
+    mpz_t base;
+    unsigned long exp;
+
+    IntPowFutureOp(mpz_srcptr _base, unsigned long _exp) : exp(_exp) { mpz_init_set(base, _base); }
+    ~IntPowFutureOp() { mpz_clear(base); }
+
+    void run() override { intPowUi(res, base, exp); }
+};
+
+struct IntMulFutureOp : IntFutureOp
+{
+    mpz_t lhs;
+    mpz_t rhs;
+
+    IntMulFutureOp(mpz_srcptr _lhs, mpz_srcptr _rhs)
+    {
+        mpz_init_set(lhs, _lhs);
+        mpz_init_set(rhs, _rhs);
+    }
+    ~IntMulFutureOp()
+    {
+        mpz_clear(lhs);
+        mpz_clear(rhs);
+    }
+
+    void run() override { intMul(res, lhs, rhs, getMulThreads()); }
+};
+
+struct IntRootFutureOp : IntFutureOp
+{
+    mpz_t val;
+    unsigned long n;
+
+    IntRootFutureOp(mpz_srcptr _val, unsigned long _n) : n(_n) { mpz_init_set(val, _val); }
+    ~IntRootFutureOp() { mpz_clear(val); }
+
+    void run() override { mpz_root(res, val, n); }
+};
+
+struct IntStrFutureOp : StrFutureOp
+{
+    mpz_t val;
+    int base;
+
+    IntStrFutureOp(mpz_srcptr _val, int _base) : base(_base) { mpz_init_set(val, _val); }
+    ~IntStrFutureOp() { mpz_clear(val); }
+
+    void run() override { intToStr(val, base, res); }
+};
+
+// Initializes `res` to the exact value of the Int / Flt / MPInt / MPFlt `val` - with just enough
+// precision for it, so that operations on the copy round the same as those on `val` itself.
+static void initFltExact(mpfr_ptr res, Var *val)
+{
+    if(val->is<VarMPFlt>()) {
+        mpfr_init2(res, as<VarMPFlt>(val)->getPrec());
+        mpfr_set(res, as<VarMPFlt>(val)->getSrcPtr(), MPFR_RNDN);
+    } else if(val->is<VarFlt>()) {
+        mpfr_init2(res, DBL_MANT_DIG);
+        mpfr_set_d(res, as<VarFlt>(val)->getVal(), MPFR_RNDN);
+    } else if(val->is<VarInt>()) {
+        mpfr_init2(res, 64);
+        mpfr_set_si(res, as<VarInt>(val)->getVal(), MPFR_RNDN);
+    } else {
+        mpz_srcptr z     = as<VarMPInt>(val)->getSrcPtr();
+        mpfr_prec_t bits = mpz_sizeinbase(z, 2);
+        mpfr_init2(res, std::max(bits, (mpfr_prec_t)MPFR_PREC_MIN));
+        mpfr_set_z(res, z, MPFR_RNDN);
+    }
+}
+
+struct FltPowFutureOp : FltFutureOp
+{
+    mpfr_t base;
+    // Int / MPInt exponents are kept as integers, as mpFltPow() does.
+    mpz_t intExp;
+    mpfr_t fltExp;
+    bool isIntExp;
+
+    FltPowFutureOp(mpfr_prec_t prec, mpfr_srcptr _base, Var *exp)
+        : FltFutureOp(prec), isIntExp(exp->is<VarInt>() || exp->is<VarMPInt>())
+    {
+        mpfr_init2(base, mpfr_get_prec(_base));
+        mpfr_set(base, _base, MPFR_RNDN);
+        if(isIntExp) mpz_init_set(intExp, IntOperand(exp).get());
+        else initFltExact(fltExp, exp);
+    }
+    ~FltPowFutureOp()
+    {
+        mpfr_clear(base);
+        if(isIntExp) mpz_clear(intExp);
+        else mpfr_clear(fltExp);
+    }
+
+    void run() override
+    {
+        if(isIntExp) mpfr_pow_z(res, base, intExp, MPFR_RNDN);
+        else mpfr_pow(res, base, fltExp, MPFR_RNDN);
+    }
+};
+
+struct FltMulFutureOp : FltFutureOp
 {
-    EXPECT(VarMPInt, args[1], "power");
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0);
-    mpfr_pow_si(res->getPtr(), as<VarMPFlt>(args[0])->getSrcPtr(),
-                mpz_get_si(as<VarMPInt>(args[1])->getPtr()), MPFR_RNDN);
-    return res;
-}
+    mpfr_t lhs;
+    mpfr_t rhs;
+    // The default rounding mode is per thread, so it is taken from the VM thread.
+    mpfr_rnd_t rnd;
+
+    FltMulFutureOp(mpfr_prec_t prec, mpfr_srcptr _lhs, Var *_rhs)
+        : FltFutureOp(prec), rnd(mpfr_get_default_rounding_mode())
+    {
+        mpfr_init2(lhs, mpfr_get_prec(_lhs));
+        mpfr_set(lhs, _lhs, MPFR_RNDN);
+        initFltExact(rhs, _rhs);
+    }
+    ~FltMulFutureOp()
+    {
+        mpfr_clear(lhs);
+        mpfr_clear(rhs);
+    }
 
-FERAL_FUNC(mpFltRoot, 1, false,
-           "  var.fn(other) -> MPFlt\n"
-           "Lowers `var` to the root of `other` and returns a new MPFlt with the result.")
+    void run() override { mpfr_mul(res, lhs, rhs, rnd); }
+};
+
+struct FltRootFutureOp : FltFutureOp
 {
-    EXPECT(VarMPInt, args[1], "root");
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0);
+    mpfr_t val;
+    unsigned long n;
+
+    FltRootFutureOp(mpfr_srcptr _val, unsigned long _n) : FltFutureOp(mpfr_get_prec(_val)), n(_n)
+    {
+        mpfr_init2(val, mpfr_get_prec(_val));
+        mpfr_set(val, _val, MPFR_RNDN);
+    }
+    ~FltRootFutureOp() { mpfr_clear(val); }
+
+    void run() override
+    {
 #if MPFR_VERSION_MAJOR >= 4
-    mpfr_rootn_ui(res->getPtr(), as<VarMPFlt>(args[0])->getPtr(),
-                  mpz_get_ui(as<VarMPInt>(args[1])->getPtr()), MPFR_RNDN);
+        mpfr_rootn_ui(res, val, n, MPFR_RNDN);
 #else
-    mpfr_root(res->getPtr(), as<VarMPFlt>(args[0])->getPtr(), mpz_get_ui(INT(args[1])->getPtr()),
-              MPFR_RNDN);
+        mpfr_root(res, val, n, MPFR_RNDN);
 #endif // MPFR_VERSION_MAJOR
-    return res;
-}
+    }
+};
 
-FERAL_FUNC(mpFltToFlt, 0, false,
-           "  var.fn() -> Flt\n"
-           "Converts `var` from MPInt to Flt and returns the value.")
+struct FltStrFutureOp : StrFutureOp
 {
-    return vm.makeVar<VarFlt>(loc, mpfr_get_d(as<VarMPFlt>(args[0])->getPtr(), MPFR_RNDN));
-}
+    mpfr_t val;
+    mpfr_rnd_t rnd;
 
-FERAL_FUNC(mpFltToStr, 0, false,
-           "  var.fn() -> Str\n"
-           "Converts `var` from MPFlt to Str and returns the value.")
-{
-    mpfr_exp_t expo;
-    char *_res  = mpfr_get_str(NULL, &expo, 10, 0, as<VarMPFlt>(args[0])->getSrcPtr(),
-                               mpfr_get_default_rounding_mode());
-    VarStr *res = vm.makeVar<VarStr>(loc, _res);
-    mpfr_free_str(_res);
-    if(res->getVal().empty() || expo == 0 || expo > 25) return res;
-    auto last_zero_from_end = res->getVal().find_last_of("123456789");
-    if(last_zero_from_end != String::npos) res->getVal().erase(last_zero_from_end + 1);
-    if(expo > 0) {
-        size_t sz = res->getVal().size();
-        while(expo > sz) { res->getVal() += '0'; }
-        if(res->getVal()[0] == '-') ++expo;
-        res->getVal().insert(expo, ".");
-    } else {
-        String pre_zero(-expo, '0');
-        pre_zero.insert(pre_zero.begin(), '.');
-        pre_zero.insert(pre_zero.begin(), '0');
-        pre_zero += res->getVal();
-        using namespace std;
-        swap(res->getVal(), pre_zero);
+    FltStrFutureOp(mpfr_srcptr _val) : rnd(mpfr_get_default_rounding_mode())
+    {
+        mpfr_init2(val, mpfr_get_prec(_val));
+        mpfr_set(val, _val, MPFR_RNDN);
     }
-    return res;
-}
+    ~FltStrFutureOp() { mpfr_clear(val); }
 
-// RNG
+    void run() override { fltToStr(val, rnd, res); }
+};
 
-FERAL_FUNC(mpFltRngGet, 1, false,
-           "  fn(upto) -> MPFlt\n"
-           "Returns a random number between [0.0, `upto`].")
+FERAL_FUNC(mpIntPowAsync, 1, false,
+           "  var.fn(other) -> MPFuture\n"
+           "Starts raising `var` to the power of the non-negative Int / MPInt `other` in the "
+           "background, and returns an MPFuture for the resulting MPInt.")
 {
-    EXPECT(VarMPFlt, args[1], "upper bound");
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0);
-    mpfr_urandom(res->getPtr(), rngstate, MPFR_RNDN);
-    mpfr_mul(res->getPtr(), res->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(), MPFR_RNDN);
-    return res;
+    unsigned long exp;
+    if(!getUiArg(vm, loc, args[1], "exponent", exp)) return nullptr;
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<IntPowFutureOp>(as<VarMPInt>(args[0])->getSrcPtr(), exp));
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////// Complex Functions ///////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////
+FERAL_FUNC(mpIntMulAsync, 1, false,
+           "  var.fn(other) -> MPFuture\n"
+           "Starts multiplying `var` by `other` in the background, and returns an MPFuture for the "
+           "resulting MPInt.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "big int multiplier");
+    IntOperand rhs(args[1]);
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<IntMulFutureOp>(as<VarMPInt>(args[0])->getSrcPtr(), rhs.get()));
+}
 
-FERAL_FUNC(mpComplexNewNative, 2, false,
-           "  fn(real, virtual) -> MPComplex\n"
-           "Creates and returns a new MPFlt using `real` and `virtual` value.\n"
-           "Here `real` and `virtual` can be either of MPInt / MPFlt")
+FERAL_FUNC(mpIntRootAsync, 1, false,
+           "  var.fn(other) -> MPFuture\n"
+           "Starts lowering `var` to the root of the positive Int / MPInt `other` in the "
+           "background, and returns an MPFuture for the resulting (truncated) MPInt.")
 {
-    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "real value");
-    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[2], "virtual value");
-    if(args[1]->getType() != args[2]->getType()) {
-        vm.fail(loc, "the real and imaginary arguments must be of same time, found: (",
-                vm.getTypeName(args[1]), ", ", vm.getTypeName(args[1]), ")");
+    unsigned long n;
+    if(!getUiArg(vm, loc, args[1], "root", n)) return nullptr;
+    mpz_srcptr val = as<VarMPInt>(args[0])->getSrcPtr();
+    // mpz_root() aborts on these, and would do so on a worker.
+    if(n == 0) {
+        vm.fail(loc, "root must be positive");
         return nullptr;
     }
-
-    Var *a1           = args[1];
-    Var *a2           = args[2];
-    VarMPComplex *res = nullptr;
-
-    if(a1->is<VarInt>()) {
-        res = vm.makeVar<VarMPComplex>(loc, as<VarInt>(a1)->getVal(), as<VarInt>(a2)->getVal());
-    } else if(a1->is<VarFlt>()) {
-        res = vm.makeVar<VarMPComplex>(loc, as<VarFlt>(a1)->getVal(), as<VarFlt>(a2)->getVal());
-    } else if(a1->is<VarMPInt>()) {
-        res = vm.makeVar<VarMPComplex>(loc, as<VarMPInt>(a1)->getSrcPtr(),
-                                       as<VarMPInt>(a2)->getSrcPtr());
-    } else if(a1->is<VarMPFlt>()) {
-        res = vm.makeVar<VarMPComplex>(loc, as<VarMPFlt>(a1)->getSrcPtr(),
-                                       as<VarMPFlt>(a2)->getSrcPtr());
+    if(n % 2 == 0 && mpz_sgn(val) < 0) {
+        vm.fail(loc, "even root of a negative number");
+        return nullptr;
     }
-
-    return res;
+    return vm.makeVar<VarMPFuture>(loc, std::make_shared<IntRootFutureOp>(val, n));
 }
 
-FERAL_FUNC(mpComplexCopy, 1, false,
-           "  var.fn() -> MPComplex\n"
-           "Creates a new instance of `var` and returns it.")
+FERAL_FUNC(mpIntToStrAsync, 0, true,
+           "  var.fn(base = 10) -> MPFuture\n"
+           "Starts converting `var` to a Str in `base` (between 2 and 62) in the background, and "
+           "returns an MPFuture for the Str.")
 {
-    return vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
-}
-
-#define LOGICC_FUNC(fn, name, sym)                                                      \
-    FERAL_FUNC(mpComplex##fn, 1, false,                                                 \
-               "  var.fn(other) -> Bool\n"                                              \
-               "Applies logical '" STRINGIFY(                                           \
-                   name) "' between `var` and `other` and returns the resulting Bool.") \
-    {                                                                                   \
-        if(args[1]->is<VarMPComplex>()) {                                               \
-            return mpc_cmp(as<VarMPComplex>(args[0])->getSrcPtr(),                      \
-                           as<VarMPComplex>(args[1])->getSrcPtr()) sym 0                \
-                       ? vm.getTrue()                                                   \
-                       : vm.getFalse();                                                 \
-        }                                                                               \
-        return vm.getFalse();                                                           \
+    int64_t base = 10;
+    if(args.size() > 1) {
+        EXPECT(VarInt, args[1], "base");
+        base = as<VarInt>(args[1])->getVal();
+        if(!isValidBase(base)) {
+            vm.fail(loc, "base must be between 2 and 62, found: ", base);
+            return nullptr;
+        }
     }
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<IntStrFutureOp>(as<VarMPInt>(args[0])->getSrcPtr(), base));
+}
 
-LOGICC_FUNC(LT, lt, <)
-LOGICC_FUNC(GT, gt, >)
-LOGICC_FUNC(LE, le, <=)
-LOGICC_FUNC(GE, ge, >=)
+FERAL_FUNC(mpFltPowAsync, 1, false,
+           "  var.fn(other) -> MPFuture\n"
+           "Starts raising `var` to the power of `other` in the background, and returns an "
+           "MPFuture for the resulting MPFlt.")
+{
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "power");
+    VarMPFlt *lhs    = as<VarMPFlt>(args[0]);
+    mpfr_prec_t prec = lhs->getPrec();
+    if(args[1]->is<VarMPFlt>()) prec = resultPrec(prec, as<VarMPFlt>(args[1])->getPrec());
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<FltPowFutureOp>(prec, lhs->getSrcPtr(), args[1]));
+}
 
-FERAL_FUNC(
-    mpComplexAdd, 1, false,
-    "  var.fn(other) -> MPComplex\n"
-    "Applies arithmetic-add on `var` and `other` and returns a new MPComplex with the result.")
+FERAL_FUNC(mpFltMulAsync, 1, false,
+           "  var.fn(other) -> MPFuture\n"
+           "Starts multiplying `var` by `other` in the background, and returns an MPFuture for the "
+           "resulting MPFlt.")
 {
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex addition");
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc);
-    if(args[1]->is<VarInt>()) {
-        mpc_add_si(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarInt>(args[1])->getVal(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_add_fr(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarMPFlt>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_add(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                as<VarMPComplex>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    }
-    return res;
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "multiplier");
+    VarMPFlt *lhs    = as<VarMPFlt>(args[0]);
+    mpfr_prec_t prec = lhs->getPrec();
+    if(args[1]->is<VarMPFlt>()) prec = resultPrec(prec, as<VarMPFlt>(args[1])->getPrec());
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<FltMulFutureOp>(prec, lhs->getSrcPtr(), args[1]));
 }
 
-FERAL_FUNC(
-    mpComplexSub, 1, false,
-    "  var.fn(other) -> MPComplex\n"
-    "Applies arithmetic-sub on `var` and `other` and returns a new MPComplex with the result.")
+FERAL_FUNC(mpFltRootAsync, 1, false,
+           "  var.fn(other) -> MPFuture\n"
+           "Starts lowering `var` to the root of the non-negative Int / MPInt `other` in the "
+           "background, and returns an MPFuture for the resulting MPFlt.")
 {
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex subtraction");
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc);
-    if(args[1]->is<VarInt>()) {
-        mpc_sub_ui(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarInt>(args[1])->getVal(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_sub_fr(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarMPFlt>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_sub(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                as<VarMPComplex>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    }
-    return res;
+    unsigned long n;
+    if(!getUiArg(vm, loc, args[1], "root", n)) return nullptr;
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<FltRootFutureOp>(as<VarMPFlt>(args[0])->getSrcPtr(), n));
 }
 
-FERAL_FUNC(
-    mpComplexMul, 1, false,
-    "  var.fn(other) -> MPComplex\n"
-    "Applies arithmetic-mul on `var` and `other` and returns a new MPComplex with the result.")
+FERAL_FUNC(mpFltToStrAsync, 0, false,
+           "  var.fn() -> MPFuture\n"
+           "Starts converting `var` to a Str in the background, and returns an MPFuture for the "
+           "Str.")
 {
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex multiplication");
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc);
-    if(args[1]->is<VarInt>()) {
-        mpc_mul_si(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarInt>(args[1])->getVal(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_mul_fr(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarMPFlt>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_mul(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                as<VarMPComplex>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    }
-    return res;
+    return vm.makeVar<VarMPFuture>(
+        loc, std::make_shared<FltStrFutureOp>(as<VarMPFlt>(args[0])->getSrcPtr()));
 }
 
-FERAL_FUNC(
-    mpComplexDiv, 1, false,
-    "  var.fn(other) -> MPComplex\n"
-    "Applies arithmetic-div on `var` and `other` and returns a new MPComplex with the result.")
+FERAL_FUNC(mpFutureReady, 0, false,
+           "  var.fn() -> Bool\n"
+           "Returns true if the operation of `var` is done (or cancelled), so wait() would not "
+           "block.")
 {
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex division");
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc);
-    if(args[1]->is<VarInt>()) {
-        mpc_div_ui(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarInt>(args[1])->getVal(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_div_fr(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarMPFlt>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_div(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                as<VarMPComplex>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    }
-    return res;
+    return vm.getBool(as<VarMPFuture>(args[0])->isReady());
 }
 
-FERAL_FUNC(mpComplexAssnAdd, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies arithmetic-add on `var` with `other` and returns the updated `var`.")
+FERAL_FUNC(mpFutureWait, 0, true,
+           "  var.fn(timeoutMs = -1) -> MPInt / MPFlt / Str / Nil\n"
+           "Waits for the operation of `var` to be done and returns its result - or nil if it is "
+           "not done within `timeoutMs` milliseconds (if it is not negative). Fails if the "
+           "operation was cancelled.")
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex addition-assn");
-    VarMPComplex *base = as<VarMPComplex>(args[0]);
-    if(args[1]->is<VarInt>()) {
-        mpc_add_si(base->getPtr(), base->getSrcPtr(), as<VarInt>(args[1])->getVal(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_add_fr(base->getPtr(), base->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_add(base->getPtr(), base->getSrcPtr(), as<VarMPComplex>(args[1])->getSrcPtr(),
-                mpc_get_default_rounding_mode());
+    int64_t timeoutMs = -1;
+    if(args.size() > 1) {
+        EXPECT(VarInt, args[1], "timeout");
+        timeoutMs = as<VarInt>(args[1])->getVal();
     }
-    return base;
+    VarMPFuture *future        = as<VarMPFuture>(args[0]);
+    VarMPFuture::Status status = future->wait(timeoutMs);
+    if(status == VarMPFuture::Status::Cancelled) {
+        vm.fail(loc, "the operation was cancelled");
+        return nullptr;
+    }
+    if(status != VarMPFuture::Status::Done) return vm.getNil();
+    return future->getOp()->getResult(vm, loc);
 }
 
-FERAL_FUNC(mpComplexAssnSub, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies arithmetic-sub on `var` with `other` and returns the updated `var`.")
+FERAL_FUNC(mpFutureCancel, 0, false,
+           "  var.fn() -> Bool\n"
+           "Cancels the operation of `var` and returns true, or returns false if it is already "
+           "done. An operation which is already running keeps running until it is done (GMP / "
+           "MPFR calls cannot be interrupted), but its result is dropped.")
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex subtraction-assn");
-    VarMPComplex *base = as<VarMPComplex>(args[0]);
-    if(args[1]->is<VarInt>()) {
-        mpc_sub_ui(base->getPtr(), base->getSrcPtr(), as<VarInt>(args[1])->getVal(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_sub_fr(base->getPtr(), base->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_sub(base->getPtr(), base->getSrcPtr(), as<VarMPComplex>(args[1])->getSrcPtr(),
-                mpc_get_default_rounding_mode());
-    }
-    return base;
+    return vm.getBool(as<VarMPFuture>(args[0])->cancel());
 }
 
-FERAL_FUNC(mpComplexAssnMul, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies arithmetic-mul on `var` with `other` and returns the updated `var`.")
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////// Random Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A value which did not fit in a double, to be stored after switching the array to MPFR.
+struct RandomFltMiss
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex multiplication-assn");
-    VarMPComplex *base = as<VarMPComplex>(args[0]);
-    if(args[1]->is<VarInt>()) {
-        mpc_mul_si(base->getPtr(), base->getSrcPtr(), as<VarInt>(args[1])->getVal(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_mul_fr(base->getPtr(), base->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_mul(base->getPtr(), base->getSrcPtr(), as<VarMPComplex>(args[1])->getSrcPtr(),
-                mpc_get_default_rounding_mode());
+    size_t idx;
+    mpfr_t val;
+};
+
+// Parameters of a bulk random generation call, shared by all its threads.
+struct RandomFill
+{
+    // Fills the elements in [begin, end) using `state`, as the `chunk`th thread.
+    void (*fill)(RandomFill &job, size_t chunk, __gmp_randstate_struct *state, size_t begin,
+                 size_t end);
+    // randomInts(): [lo, lo + range), randomBits(): [0, 2^bits).
+    mpz_srcptr lo, range;
+    mp_bitcnt_t bits;
+    VarMPIntArray *ints;
+    // randomFlts(): [flo, flo + frange], rounded with `rnd` (the default rounding mode is
+    // per thread in MPFR).
+    mpfr_srcptr flo, frange;
+    mpfr_rnd_t rnd;
+    VarMPFltArray *flts;
+    // Values which did not fit in a double, for each thread.
+    Vector<Vector<RandomFltMiss>> misses;
+};
+
+static void randomFillInts(RandomFill &job, size_t chunk, __gmp_randstate_struct *state,
+                           size_t begin, size_t end)
+{
+    mpz_t tmp;
+    mpz_init(tmp);
+    for(size_t i = begin; i < end; ++i) {
+        mpz_urandomm(tmp, state, job.range);
+        mpz_add(tmp, tmp, job.lo);
+        job.ints->setInPlace(i, tmp);
     }
-    return base;
+    mpz_clear(tmp);
 }
 
-FERAL_FUNC(mpComplexAssnDiv, 1, false,
-           "  var.fn(other) -> var\n"
-           "Applies arithmetic-div on `var` with `other` and returns the updated `var`.")
+static void randomFillBits(RandomFill &job, size_t chunk, __gmp_randstate_struct *state,
+                           size_t begin, size_t end)
 {
-    EXPECT_NO_CONST(args[0], "var");
-    EXPECT3(VarInt, VarMPFlt, VarMPComplex, args[1], "complex division-assn");
-    VarMPComplex *base = as<VarMPComplex>(args[0]);
-    if(args[1]->is<VarInt>()) {
-        mpc_div_ui(base->getPtr(), base->getSrcPtr(), as<VarInt>(args[1])->getVal(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPFlt>()) {
-        mpc_div_fr(base->getPtr(), base->getSrcPtr(), as<VarMPFlt>(args[1])->getSrcPtr(),
-                   mpc_get_default_rounding_mode());
-    } else if(args[1]->is<VarMPComplex>()) {
-        mpc_div(base->getPtr(), base->getSrcPtr(), as<VarMPComplex>(args[1])->getSrcPtr(),
-                mpc_get_default_rounding_mode());
+    mpz_t tmp;
+    mpz_init(tmp);
+    for(size_t i = begin; i < end; ++i) {
+        mpz_urandomb(tmp, state, job.bits);
+        job.ints->setInPlace(i, tmp);
     }
-    return base;
+    mpz_clear(tmp);
 }
 
-FERAL_FUNC(mpComplexEQ, 1, false,
-           "  var.fn(other) -> Bool\n"
-           "Returns `true` if `var` and `other` are equal.")
+// Writes to doubles directly when the array stores them, and otherwise to the MPFR storage.
+static void randomFillFlts(RandomFill &job, size_t chunk, __gmp_randstate_struct *state,
+                           size_t begin, size_t end)
 {
-    if(args[1]->is<VarMPComplex>()) {
-        return mpc_cmp(as<VarMPComplex>(args[0])->getSrcPtr(),
-                       as<VarMPComplex>(args[1])->getSrcPtr()) == 0
-                   ? vm.getTrue()
-                   : vm.getFalse();
+    mpfr_rnd_t rnd = job.rnd;
+    bool isDbl     = job.flts->isDouble();
+    mpfr_t tmp;
+    mpfr_init2(tmp, job.flts->getPrec());
+    for(size_t i = begin; i < end; ++i) {
+        mpfr_ptr res = isDbl ? tmp : job.flts->getPtr(i);
+        mpfr_urandom(res, state, rnd);
+        mpfr_mul(res, res, job.frange, rnd);
+        mpfr_add(res, res, job.flo, rnd);
+        if(!isDbl || fltToDouble(tmp, job.flts->getDoubles()[i])) continue;
+        job.misses[chunk].push_back({i, {}});
+        mpfr_init2(job.misses[chunk].back().val, job.flts->getPrec());
+        mpfr_set(job.misses[chunk].back().val, tmp, MPFR_RNDN);
     }
-    return vm.getFalse();
+    mpfr_clear(tmp);
 }
 
-FERAL_FUNC(mpComplexNE, 1, false,
-           "  var.fn(other) -> Bool\n"
-           "Returns `true` if `var` and `other` are not equal.")
+// Runs `job` over [0, count), either directly with the RandState (or nil) `stateArg` when
+// `threadCount` is 1, or split into `threadCount` substreams (0 means one per core), each of which
+// gets its own state split from `stateArg`, so that the results only depend on the seed and the
+// thread count. The substreams are filled on the worker pool, so no more than one thread per core
+// works on them, however many were requested.
+static void runRandomFill(RandomFill &job, Var *stateArg, size_t count, size_t threadCount)
 {
-    if(args[1]->is<VarMPComplex>()) {
-        return mpc_cmp(as<VarMPComplex>(args[0])->getSrcPtr(),
-                       as<VarMPComplex>(args[1])->getSrcPtr()) != 0
-                   ? vm.getTrue()
-                   : vm.getFalse();
+    __gmp_randstate_struct *parent = getRandStateArg(stateArg);
+    if(threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    threadCount = std::max<size_t>(1, std::min(threadCount, count));
+    job.misses.resize(threadCount);
+    if(threadCount == 1) {
+        job.fill(job, 0, parent, 0, count);
+        return;
     }
-    return vm.getTrue();
+    VarRandState::Algo algo = stateArg->is<VarRandState>() ? as<VarRandState>(stateArg)->getAlgo()
+                                                          : VarRandState::Algo::MT;
+    // The seeds are drawn from the parent in order up front (like randSplit() would), and each
+    // state is only created when its substream is filled.
+    Vector<__mpz_struct> seeds(threadCount);
+    for(auto &seed : seeds) {
+        mpz_init(&seed);
+        mpz_urandomb(&seed, parent, RAND_SPLIT_SEED_BITS);
+    }
+    size_t workers = std::min(threadCount, workerPool.getThreadCount());
+    workerPool.run(threadCount, workers, [&](size_t, size_t begin, size_t end) {
+        gmp_randstate_t state;
+        for(size_t i = begin; i < end; ++i) {
+            randInit(state, algo);
+            gmp_randseed(state, &seeds[i]);
+            job.fill(job, i, state, i * count / threadCount, (i + 1) * count / threadCount);
+            gmp_randclear(state);
+        }
+    });
+    for(auto &seed : seeds) mpz_clear(&seed);
 }
 
-FERAL_FUNC(mpComplexPreInc, 0, false,
-           "  var.fn() -> var\n"
-           "Applies pre-increment on `var` and returns `var` itself.")
+// Fetches the count and thread count of a bulk random generation call, failing if either is
+// negative.
+static bool getRandomCounts(VirtualMachine &vm, ModuleLoc loc, Var *countArg, Var *threadsArg,
+                            size_t &count, size_t &threadCount)
 {
-    mpc_add_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
-               mpc_get_default_rounding_mode());
-    return args[0];
+    int64_t n = as<VarInt>(countArg)->getVal(), t = as<VarInt>(threadsArg)->getVal();
+    if(n < 0 || t < 0) {
+        vm.fail(loc, "count and thread count cannot be negative, found: (", n, ", ", t, ")");
+        return false;
+    }
+    count       = n;
+    threadCount = t;
+    return true;
 }
 
-FERAL_FUNC(
-    mpComplexPostInc, 0, false,
-    "  var.fn() -> MPComplex\n"
-    "Applies post-increment on `var` and returns a new MPComplex with `var` - 1 as the result.")
+FERAL_FUNC(mpRandomIntsNative, 5, false,
+           "  fn(n, from, to, state, threads) -> MPIntArray\n"
+           "Returns an MPIntArray of `n` random numbers between [`from`, `to`], generated using "
+           "the RandState `state` (nil means the default state of the thread), on `threads` "
+           "threads (0 means one per core).\n"
+           "Here `from` and `to` can be any of Int / Str / MPInt.")
 {
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
-    mpc_add_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
-               mpc_get_default_rounding_mode());
+    EXPECT(VarInt, args[1], "count");
+    EXPECT3(VarInt, VarStr, VarMPInt, args[2], "lower bound");
+    EXPECT3(VarInt, VarStr, VarMPInt, args[3], "upper bound");
+    EXPECT2(VarNil, VarRandState, args[4], "random state");
+    EXPECT(VarInt, args[5], "thread count");
+    size_t count, threadCount;
+    if(!getRandomCounts(vm, loc, args[1], args[5], count, threadCount)) return nullptr;
+    mpz_t lo, range;
+    pool.initInt(lo);
+    pool.initInt(range);
+    getIntArrayElem(args[2], lo);
+    getIntArrayElem(args[3], range);
+    if(mpz_cmp(lo, range) > 0) {
+        pool.clearInt(lo);
+        pool.clearInt(range);
+        vm.fail(loc, "LHS should be less or equal to RHS for random number generation");
+        return nullptr;
+    }
+    // Every value lies in [from, to], so neither needs more limbs than the larger of the two.
+    size_t limbCount = std::max(mpz_size(lo), mpz_size(range));
+    mpz_sub(range, range, lo);
+    mpz_add_ui(range, range, 1);
+
+    VarMPIntArray *res = vm.makeVar<VarMPIntArray>(loc);
+    res->addSlots(count, limbCount);
+    RandomFill job{randomFillInts, lo, range, 0, res, nullptr, nullptr, MPFR_RNDN, nullptr, {}};
+    runRandomFill(job, args[4], count, threadCount);
+    pool.clearInt(lo);
+    pool.clearInt(range);
     return res;
 }
 
-FERAL_FUNC(mpComplexPreDec, 0, false,
-           "  var.fn() -> var\n"
-           "Applies pre-decrement on `var` and returns `var` itself.")
+FERAL_FUNC(mpRandomBitsNative, 4, false,
+           "  fn(n, bits, state, threads) -> MPIntArray\n"
+           "Returns an MPIntArray of `n` random numbers between [0, 2^`bits`), generated using the "
+           "RandState `state` (nil means the default state of the thread), on `threads` threads "
+           "(0 means one per core).")
 {
-    mpc_sub_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
-               mpc_get_default_rounding_mode());
-    return args[0];
+    EXPECT(VarInt, args[1], "count");
+    EXPECT(VarInt, args[2], "bit count");
+    EXPECT2(VarNil, VarRandState, args[3], "random state");
+    EXPECT(VarInt, args[4], "thread count");
+    size_t count, threadCount;
+    if(!getRandomCounts(vm, loc, args[1], args[4], count, threadCount)) return nullptr;
+    int64_t bits = as<VarInt>(args[2])->getVal();
+    if(bits < 0) {
+        vm.fail(loc, "bit count cannot be negative, found: ", bits);
+        return nullptr;
+    }
+
+    VarMPIntArray *res = vm.makeVar<VarMPIntArray>(loc);
+    res->addSlots(count, (bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS);
+    RandomFill job{randomFillBits, nullptr, nullptr, (mp_bitcnt_t)bits, res, nullptr, nullptr,
+                   MPFR_RNDN,      nullptr, {}};
+    runRandomFill(job, args[3], count, threadCount);
+    return res;
 }
 
-FERAL_FUNC(
-    mpComplexPostDec, 0, false,
-    "  var.fn() -> MPComplex\n"
-    "Applies post-decrement on `var` and returns a new MPComplex with `var` + 1 as the result.")
+FERAL_FUNC(mpRandomFltsNative, 6, false,
+           "  fn(n, from, to, precision, state, threads) -> MPFltArray\n"
+           "Returns an MPFltArray of `precision` bits (0 means the default precision) with `n` "
+           "random numbers between [`from`, `to`], generated using the RandState `state` (nil "
+           "means the default state of the thread), on `threads` threads (0 means one per core).\n"
+           "Here `from` and `to` can be any of Int / Flt / MPInt / MPFlt.")
 {
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
-    mpc_sub_ui(as<VarMPComplex>(args[0])->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), 1,
-               mpc_get_default_rounding_mode());
+    EXPECT(VarInt, args[1], "count");
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[2], "lower bound");
+    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[3], "upper bound");
+    EXPECT(VarInt, args[4], "precision");
+    EXPECT2(VarNil, VarRandState, args[5], "random state");
+    EXPECT(VarInt, args[6], "thread count");
+    size_t count, threadCount;
+    if(!getRandomCounts(vm, loc, args[1], args[6], count, threadCount)) return nullptr;
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[4], true, prec)) return nullptr;
+    if(prec == 0) prec = mpfr_get_default_prec();
+    mpfr_t lo, range;
+    pool.initFlt(lo, prec);
+    pool.initFlt(range, prec);
+    getFltArrayElem(args[2], lo);
+    getFltArrayElem(args[3], range);
+    if(mpfr_cmp(lo, range) > 0) {
+        pool.clearFlt(lo);
+        pool.clearFlt(range);
+        vm.fail(loc, "LHS should be less or equal to RHS for random number generation");
+        return nullptr;
+    }
+    mpfr_rnd_t rnd = mpfr_get_default_rounding_mode();
+    mpfr_sub(range, range, lo, rnd);
+
+    VarMPFltArray *res = vm.makeVar<VarMPFltArray>(loc, prec);
+    res->addZeros(count);
+    RandomFill job{randomFillFlts, nullptr, nullptr, 0, nullptr, lo, range, rnd, res, {}};
+    runRandomFill(job, args[5], count, threadCount);
+    for(auto &misses : job.misses) {
+        for(auto &miss : misses) {
+            res->set(miss.idx, miss.val);
+            mpfr_clear(miss.val);
+        }
+    }
+    pool.clearFlt(lo);
+    pool.clearFlt(range);
     return res;
 }
 
-FERAL_FUNC(mpComplexUSub, 0, false,
-           "  var.fn() -> MPComplex\n"
-           "Returns the negative equivalent of `var` as a new MPComplex.")
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////// Fractal Functions ///////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Max number of points (w x h) in a mandelbrotGrid() call - each takes a limb and an element (24
+// bytes in all) of the resulting MPIntArray, so that is at most 384 MiB.
+static constexpr int64_t MANDELBROT_MAX_POINTS = (int64_t)1 << 24;
+
+// Parameters of a mandelbrotGrid() call, shared by all its workers.
+struct MandelbrotGrid
 {
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
-    mpc_neg(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(), mpc_get_default_rounding_mode());
-    return res;
+    mpfr_srcptr x0, y0, dx, dy;
+    size_t w, h;
+    uint64_t maxIter;
+    mpfr_prec_t prec;
+    // Iteration counts, row by row - a slot of one limb per point, filled in place.
+    VarMPIntArray *counts;
+    // Next row to be computed.
+    std::atomic<size_t> nextRow;
+};
+
+// Stores `iter` as the count of the point at `idx`.
+static inline void setMandelbrotCount(MandelbrotGrid &grid, size_t idx, uint64_t iter)
+{
+    mpz_t view;
+    mp_limb_t limb = iter;
+    grid.counts->setInPlace(idx, mpz_roinit_n(view, &limb, iter != 0));
 }
 
-FERAL_FUNC(mpComplexPow, 1, false,
-           "  var.fn(other) -> MPComplex\n"
-           "Raises `var` to the power of `other` and returns a new MPComplex with the result.")
+// Computes rows with doubles - used when the precision fits in one.
+static void mandelbrotRowsDbl(MandelbrotGrid &grid)
 {
-    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "complex power");
-    VarMPComplex *res = vm.makeVar<VarMPComplex>(loc, as<VarMPComplex>(args[0])->getSrcPtr());
-    if(args[1]->is<VarInt>())
-        mpc_pow_si(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarInt>(args[1])->getVal(), mpc_get_default_rounding_mode());
-    if(args[1]->is<VarFlt>())
-        mpc_pow_ld(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarFlt>(args[1])->getVal(), mpc_get_default_rounding_mode());
-    if(args[1]->is<VarMPInt>())
-        mpc_pow_z(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                  as<VarMPInt>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    else if(args[1]->is<VarMPFlt>())
-        mpc_pow_fr(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-                   as<VarMPFlt>(args[1])->getSrcPtr(), mpc_get_default_rounding_mode());
-    return res;
+    double x0 = mpfr_get_d(grid.x0, MPFR_RNDN), y0 = mpfr_get_d(grid.y0, MPFR_RNDN);
+    double dx = mpfr_get_d(grid.dx, MPFR_RNDN), dy = mpfr_get_d(grid.dy, MPFR_RNDN);
+    for(size_t row = grid.nextRow++; row < grid.h; row = grid.nextRow++) {
+        double ci = y0 + row * dy;
+        for(size_t col = 0; col < grid.w; ++col) {
+            double cr = x0 + col * dx;
+            double zr = 0.0, zi = 0.0, zr2 = 0.0, zi2 = 0.0;
+            uint64_t iter = 0;
+            for(; iter < grid.maxIter && zr2 + zi2 <= 4.0; ++iter) {
+                zi  = 2.0 * zr * zi + ci;
+                zr  = zr2 - zi2 + cr;
+                zr2 = zr * zr;
+                zi2 = zi * zi;
+            }
+            setMandelbrotCount(grid, row * grid.w + col, iter);
+        }
+    }
 }
 
-FERAL_FUNC(mpComplexAbs, 0, false,
-           "  var.fn() -> MPFlt\n"
-           "Returns the absolute float value of `var` as a new MPFlt.")
+// Computes rows with MPFR, using the same scratch values for all the pixels of the thread.
+// z is kept as its real and imaginary parts, along with their squares, so that each iteration is
+// 3 multiplications (instead of the 4 of a complex multiplication), and |z|^2 comes for free.
+static void mandelbrotRowsMP(MandelbrotGrid &grid)
 {
-    VarMPFlt *res = vm.makeVar<VarMPFlt>(loc, 0.0);
-    mpc_abs(res->getPtr(), as<VarMPComplex>(args[0])->getSrcPtr(),
-            mpfr_get_default_rounding_mode());
-    return res;
+    mpfr_rnd_t rnd = MPFR_RNDN;
+    mpfr_t cr, ci, zr, zi, zr2, zi2, mag;
+    mpfr_inits2(grid.prec, cr, ci, zr, zi, zr2, zi2, mag, NULL);
+    for(size_t row = grid.nextRow++; row < grid.h; row = grid.nextRow++) {
+        mpfr_mul_ui(ci, grid.dy, row, rnd);
+        mpfr_add(ci, ci, grid.y0, rnd);
+        for(size_t col = 0; col < grid.w; ++col) {
+            mpfr_mul_ui(cr, grid.dx, col, rnd);
+            mpfr_add(cr, cr, grid.x0, rnd);
+            mpfr_set_zero(zr, 1);
+            mpfr_set_zero(zi, 1);
+            mpfr_set_zero(zr2, 1);
+            mpfr_set_zero(zi2, 1);
+            uint64_t iter = 0;
+            for(; iter < grid.maxIter; ++iter) {
+                mpfr_add(mag, zr2, zi2, rnd);
+                if(mpfr_cmp_ui(mag, 4) > 0) break;
+                mpfr_mul(zi, zr, zi, rnd);
+                mpfr_mul_2ui(zi, zi, 1, rnd);
+                mpfr_add(zi, zi, ci, rnd);
+                mpfr_sub(zr, zr2, zi2, rnd);
+                mpfr_add(zr, zr, cr, rnd);
+                mpfr_sqr(zr2, zr, rnd);
+                mpfr_sqr(zi2, zi, rnd);
+            }
+            setMandelbrotCount(grid, row * grid.w + col, iter);
+        }
+    }
+    mpfr_clears(cr, ci, zr, zi, zr2, zi2, mag, NULL);
 }
 
-FERAL_FUNC(mpComplexSet, 2, false,
-           "  var.fn(real, virtual) -> var\n"
-           "Updates the `real` and `virtual` parts of the MPComplex `var` and returns itself.")
+FERAL_FUNC(mpMandelbrotGrid, 8, false,
+           "  fn(x0, y0, dx, dy, w, h, maxIter, precision) -> MPIntArray\n"
+           "Computes the Mandelbrot set escape time for each point of the `w` x `h` grid which "
+           "starts at (`x0`, `y0`) and steps by (`dx`, `dy`), with `precision` bits (0 means the "
+           "default complex precision), and returns the iteration counts as an MPIntArray, row by "
+           "row. Points which do not escape within `maxIter` iterations get `maxIter`.\n"
+           "Here `x0`, `y0`, `dx`, and `dy` can be any of Int / Flt / MPInt / MPFlt.\n"
+           "Precisions of up to 53 bits are computed with doubles, and the rows are split across "
+           "all the cores. The grid can have at most 2^24 points.")
 {
-    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[1], "real value");
-    EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[2], "virtual value");
-    if(args[1]->getType() != args[2]->getType()) {
-        vm.fail(loc, "the real and imaginary arguments must be of same time, found: (",
-                vm.getTypeName(args[1]), ", ", vm.getTypeName(args[1]), ")");
+    for(size_t i = 1; i <= 4; ++i) {
+        EXPECT4(VarInt, VarFlt, VarMPInt, VarMPFlt, args[i], "grid coordinate");
+    }
+    EXPECT(VarInt, args[5], "grid width");
+    EXPECT(VarInt, args[6], "grid height");
+    EXPECT(VarInt, args[7], "max iterations");
+    EXPECT(VarInt, args[8], "precision");
+    int64_t w = as<VarInt>(args[5])->getVal(), h = as<VarInt>(args[6])->getVal();
+    int64_t maxIter = as<VarInt>(args[7])->getVal();
+    if(w < 0 || h < 0 || maxIter < 0) {
+        vm.fail(loc, "grid size and max iterations cannot be negative, found: (", w, ", ", h,
+                ", ", maxIter, ")");
         return nullptr;
     }
-
-    Var *a1           = args[1];
-    Var *a2           = args[2];
-    VarMPComplex *res = as<VarMPComplex>(args[0]);
-
-    if(a1->is<VarInt>()) {
-        mpc_set_si_si(res->getPtr(), as<VarInt>(a1)->getVal(), as<VarInt>(a2)->getVal(),
-                      mpc_get_default_rounding_mode());
-    } else if(a1->is<VarFlt>()) {
-        mpc_set_ld_ld(res->getPtr(), as<VarFlt>(a1)->getVal(), as<VarFlt>(a2)->getVal(),
-                      mpc_get_default_rounding_mode());
-    } else if(a1->is<VarMPInt>()) {
-        mpc_set_z_z(res->getPtr(), as<VarMPInt>(a1)->getSrcPtr(), as<VarMPInt>(a2)->getSrcPtr(),
-                    mpc_get_default_rounding_mode());
-    } else if(a1->is<VarMPFlt>()) {
-        mpc_set_fr_fr(res->getPtr(), as<VarMPFlt>(a1)->getSrcPtr(), as<VarMPFlt>(a2)->getSrcPtr(),
-                      mpc_get_default_rounding_mode());
+    if(w != 0 && h > MANDELBROT_MAX_POINTS / w) {
+        vm.fail(loc, "grid size cannot exceed ", MANDELBROT_MAX_POINTS, " points, found: (", w,
+                ", ", h, ")");
+        return nullptr;
     }
-
+    mpfr_prec_t prec;
+    if(!getPrecArg(vm, loc, args[8], true, prec)) return nullptr;
+    if(prec == 0) prec = mpc_get_default_prec();
+
+    mpfr_t coords[4];
+    for(size_t i = 0; i < 4; ++i) {
+        pool.initFlt(coords[i], prec);
+        getFltArrayElem(args[i + 1], coords[i]);
+    }
+    VarMPIntArray *res = vm.makeVar<VarMPIntArray>(loc);
+    res->addSlots((size_t)(w * h), 1);
+    MandelbrotGrid grid{coords[0], coords[1], coords[2], coords[3], (size_t)w, (size_t)h,
+                        (uint64_t)maxIter, prec, res, {0}};
+    void (*rows)(MandelbrotGrid &) = prec <= 53 ? mandelbrotRowsDbl : mandelbrotRowsMP;
+    // Each chunk takes rows from grid.nextRow until there are none left, so that the (very
+    // uneven) rows stay balanced across the workers.
+    size_t chunks = std::min(workerPool.getThreadCount(), grid.h);
+    workerPool.run(chunks, chunks, [&](size_t, size_t, size_t) { rows(grid); });
+    for(size_t i = 0; i < 4; ++i) pool.clearFlt(coords[i]);
     return res;
 }
 
-INIT_DLL(MP)
-{
-    gmp_randinit_default(rngstate);
+// Profiler slot of each registered function - one per registration (`id`), so that a function
+// registered under several names is profiled separately for each.
+template<MPNativeFn fn, size_t id> static MPProfiler::Op *profiledOp = nullptr;
 
-    vm.addLocal(loc, "seed", rngSeed);
+template<MPNativeFn fn, size_t id>
+static Var *profiledFn(VirtualMachine &vm, ModuleLoc loc, Span<Var *> args,
+                       const Map<String, size_t> &assnArgs)
+{
+    if(!profiler.isEnabled()) return fn(vm, loc, args, assnArgs);
+    return profiler.call(*profiledOp<fn, id>, fn, vm, loc, args, assnArgs);
+}
 
-    vm.addLocal(loc, "newIntNative", mpIntNewNative);
-    vm.addLocal(loc, "newFltNative", mpFltNewNative);
-    vm.addLocal(loc, "newComplexNative", mpComplexNewNative);
+// Returns the profiling trampoline of `fn`, which is registered as `name` (of `type`, if any).
+template<MPNativeFn fn, size_t id> static MPNativeFn profiled(const char *type, const char *name)
+{
+    // The module may be initialized by more than one VM.
+    if(!profiledOp<fn, id>) {
+        profiledOp<fn, id> = profiler.addOp(type ? String(type) + "." + name : String(name));
+    }
+    return profiledFn<fn, id>;
+}
 
-    vm.addLocal(loc, "irange", mpIntRange);
-    vm.addLocal(loc, "getRandomIntNative", mpIntRngGet);
-    vm.addLocal(loc, "getRandomFltNative", mpFltRngGet);
+// Register `fn` as `name` in the module / in the type Var`type`, through the profiler.
+#define ADD_LOCAL(name, fn) vm.addLocal(loc, name, profiled<fn, __COUNTER__>(nullptr, name))
+#define ADD_TYPE_FN(type, name, fn) \
+    vm.addTypeFn<Var##type>(loc, name, profiled<fn, __COUNTER__>(#type, name))
 
-    // Register the MPInt, MPFlt, MPComplex, and MPIntIterator types
+INIT_DLL(MP)
+{
+    // Must happen before anything is allocated by GMP.
+    if(getenv("FERAL_MP_ARENA")) arena.install();
+    if(getenv("FERAL_MP_PROFILE")) profiler.setEnabled(true);
+
+    ADD_LOCAL("seed", rngSeed);
+    ADD_LOCAL("poolHits", poolHits);
+    ADD_LOCAL("poolMisses", poolMisses);
+    ADD_LOCAL("poolClear", poolClear);
+    ADD_LOCAL("arenaEnabled", arenaEnabled);
+    ADD_LOCAL("arenaBytesInUse", arenaBytesInUse);
+    ADD_LOCAL("arenaPeakBytes", arenaPeakBytes);
+    ADD_LOCAL("arenaResetPeak", arenaResetPeak);
+
+    // Not profiled themselves.
+    vm.addLocal(loc, "profilingEnabled", profilingEnabled);
+    vm.addLocal(loc, "setProfiling", profilingSet);
+    vm.addLocal(loc, "stats", profilingStats);
+    vm.addLocal(loc, "resetStats", profilingReset);
+    vm.addLocal(loc, "statsJson", profilingToJson);
+
+    ADD_LOCAL("setDefaultPrecision", precSetDefault);
+    ADD_LOCAL("getDefaultPrecision", precGetDefault);
+    ADD_LOCAL("setDefaultComplexPrecision", precSetDefaultComplex);
+    ADD_LOCAL("getDefaultComplexPrecision", precGetDefaultComplex);
+    ADD_LOCAL("setMulParallelLimbs", mulSetParallelLimbs);
+    ADD_LOCAL("getMulParallelLimbs", mulGetParallelLimbs);
+    ADD_LOCAL("setMulThreads", mulSetThreads);
+    ADD_LOCAL("getMulThreads", mulGetThreads);
+    ADD_LOCAL("getWorkerThreads", workerGetThreads);
+
+    ADD_LOCAL("newIntNative", mpIntNewNative);
+    ADD_LOCAL("intFromStrNative", mpIntFromStrNative);
+    ADD_LOCAL("newFltNative", mpFltNewNative);
+    ADD_LOCAL("newComplexNative", mpComplexNewNative);
+
+    ADD_LOCAL("newIntArrayNative", mpIntArrayNewNative);
+    ADD_LOCAL("newFltArrayNative", mpFltArrayNewNative);
+
+    ADD_LOCAL("newRandStateNative", randStateNewNative);
+
+    ADD_LOCAL("fromBytes", mpFromBytes);
+    ADD_LOCAL("newWriter", mpWriterNew);
+    ADD_LOCAL("newReader", mpReaderNew);
+    ADD_LOCAL("openIntStore", mpIntStoreOpen);
+    ADD_LOCAL("newIntStoreWriter", mpIntStoreWriterNew);
+    ADD_LOCAL("newModContext", mpModContextNew);
+
+    ADD_LOCAL("lazy", mpLazy);
+    ADD_LOCAL("irange", mpIntRange);
+    ADD_LOCAL("factorial", mpFactorial);
+    ADD_LOCAL("binomial", mpBinomial);
+    ADD_LOCAL("primorial", mpPrimorial);
+    ADD_LOCAL("fib", mpFib);
+    ADD_LOCAL("lucas", mpLucas);
+    ADD_LOCAL("productOf", mpProductOf);
+    ADD_LOCAL("parallelMapNative", mpParallelMapNative);
+    ADD_LOCAL("parallelReduceNative", mpParallelReduceNative);
+    ADD_LOCAL("mandelbrotGrid", mpMandelbrotGrid);
+    ADD_LOCAL("getRandomIntNative", mpIntRngGet);
+    ADD_LOCAL("getRandomFltNative", mpFltRngGet);
+    ADD_LOCAL("randomIntsNative", mpRandomIntsNative);
+    ADD_LOCAL("randomFltsNative", mpRandomFltsNative);
+    ADD_LOCAL("randomBitsNative", mpRandomBitsNative);
+
+    // Register the MPInt, MPFlt, MPComplex, MPIntIterator, MPIntArray, MPFltArray, RandState,
+    // MPExpr, MPWriter, MPReader, MPIntStore, MPIntStoreWriter, MPModContext, and MPFuture types
 
     vm.addLocalType<VarMPInt>(loc, "MPInt", "GNU Multiprecision - Big Int type.");
     vm.addLocalType<VarMPFlt>(loc, "MPFlt", "GNU Multiprecision - Big Flt type.");
     vm.addLocalType<VarMPComplex>(loc, "MPComplex", "GNU Multiprecision - Complex type.");
     vm.addLocalType<VarMPIntIterator>(loc, "MPIntIterator", "Iterator for Big Int.");
+    vm.addLocalType<VarMPIntArray>(loc, "MPIntArray", "GNU Multiprecision - Big Int array type.");
+    vm.addLocalType<VarMPFltArray>(loc, "MPFltArray", "GNU Multiprecision - Big Flt array type.");
+    vm.addLocalType<VarRandState>(loc, "RandState", "GNU Multiprecision - Random state type.");
+    vm.addLocalType<VarMPExpr>(loc, "MPExpr", "GNU Multiprecision - Lazy expression type.");
+    vm.addLocalType<VarMPWriter>(loc, "MPWriter", "GNU Multiprecision - Binary stream writer.");
+    vm.addLocalType<VarMPReader>(loc, "MPReader", "GNU Multiprecision - Binary stream reader.");
+    vm.addLocalType<VarMPIntStore>(loc, "MPIntStore",
+                                   "GNU Multiprecision - Memory-mapped Big Int store type.");
+    vm.addLocalType<VarMPIntStoreWriter>(loc, "MPIntStoreWriter",
+                                         "GNU Multiprecision - Big Int store writer type.");
+    vm.addLocalType<VarMPModContext>(loc, "MPModContext",
+                                     "GNU Multiprecision - Modular arithmetic context type.");
+    vm.addLocalType<VarMPFuture>(loc, "MPFuture",
+                                 "GNU Multiprecision - Background operation result type.");
 
     // MPInt functions
 
-    vm.addTypeFn<VarMPInt>(loc, "_copy_", mpIntCopy);
-    vm.addTypeFn<VarMPInt>(loc, "+", mpIntAdd);
-    vm.addTypeFn<VarMPInt>(loc, "-", mpIntSub);
-    vm.addTypeFn<VarMPInt>(loc, "*", mpIntMul);
-    vm.addTypeFn<VarMPInt>(loc, "/", mpIntDiv);
-    vm.addTypeFn<VarMPInt>(loc, "%", mpIntMod);
-    vm.addTypeFn<VarMPInt>(loc, "<<", mpIntLShift);
-    vm.addTypeFn<VarMPInt>(loc, ">>", mpIntRShift);
-
-    vm.addTypeFn<VarMPInt>(loc, "+=", mpIntAssnAdd);
-    vm.addTypeFn<VarMPInt>(loc, "-=", mpIntAssnSub);
-    vm.addTypeFn<VarMPInt>(loc, "*=", mpIntAssnMul);
-    vm.addTypeFn<VarMPInt>(loc, "/=", mpIntAssnDiv);
-    vm.addTypeFn<VarMPInt>(loc, "%=", mpIntAssnMod);
-    vm.addTypeFn<VarMPInt>(loc, "<<=", mpIntAssnLShift);
-    vm.addTypeFn<VarMPInt>(loc, ">>=", mpIntAssnRShift);
-
-    vm.addTypeFn<VarMPInt>(loc, "**", mpIntPow);
-    vm.addTypeFn<VarMPInt>(loc, "//", mpIntRoot);
-    vm.addTypeFn<VarMPInt>(loc, "++x", mpIntPreInc);
-    vm.addTypeFn<VarMPInt>(loc, "x++", mpIntPostInc);
-    vm.addTypeFn<VarMPInt>(loc, "--x", mpIntPreDec);
-    vm.addTypeFn<VarMPInt>(loc, "x--", mpIntPostDec);
-
-    vm.addTypeFn<VarMPInt>(loc, "u-", mpIntUSub);
-
-    vm.addTypeFn<VarMPInt>(loc, "<", mpIntLT);
-    vm.addTypeFn<VarMPInt>(loc, ">", mpIntGT);
-    vm.addTypeFn<VarMPInt>(loc, "<=", mpIntLE);
-    vm.addTypeFn<VarMPInt>(loc, ">=", mpIntGE);
-    vm.addTypeFn<VarMPInt>(loc, "==", mpIntEQ);
-    vm.addTypeFn<VarMPInt>(loc, "!=", mpIntNE);
-
-    vm.addTypeFn<VarMPInt>(loc, "&", mpIntBAnd);
-    vm.addTypeFn<VarMPInt>(loc, "|", mpIntBOr);
-    vm.addTypeFn<VarMPInt>(loc, "^", mpIntBXOr);
-    vm.addTypeFn<VarMPInt>(loc, "~", mpIntBNot);
-
-    vm.addTypeFn<VarMPInt>(loc, "&=", mpIntAssnBAnd);
-    vm.addTypeFn<VarMPInt>(loc, "|=", mpIntAssnBOr);
-    vm.addTypeFn<VarMPInt>(loc, "^=", mpIntAssnBXOr);
-
-    vm.addTypeFn<VarMPInt>(loc, "popcnt", mpIntPopCnt);
-
-    vm.addTypeFn<VarMPInt>(loc, "int", mpIntToInt);
-    vm.addTypeFn<VarMPInt>(loc, "str", mpIntToStr);
-    vm.addTypeFn<VarMPIntIterator>(loc, "next", getMPIntIteratorNext);
+    ADD_TYPE_FN(MPInt, "_copy_", mpIntCopy);
+    ADD_TYPE_FN(MPInt, "+", mpIntAdd);
+    ADD_TYPE_FN(MPInt, "-", mpIntSub);
+    ADD_TYPE_FN(MPInt, "*", mpIntMul);
+    ADD_TYPE_FN(MPInt, "/", mpIntDiv);
+    ADD_TYPE_FN(MPInt, "%", mpIntMod);
+    ADD_TYPE_FN(MPInt, "<<", mpIntLShift);
+    ADD_TYPE_FN(MPInt, ">>", mpIntRShift);
+
+    ADD_TYPE_FN(MPInt, "+=", mpIntAssnAdd);
+    ADD_TYPE_FN(MPInt, "-=", mpIntAssnSub);
+    ADD_TYPE_FN(MPInt, "*=", mpIntAssnMul);
+    ADD_TYPE_FN(MPInt, "/=", mpIntAssnDiv);
+    ADD_TYPE_FN(MPInt, "%=", mpIntAssnMod);
+    ADD_TYPE_FN(MPInt, "<<=", mpIntAssnLShift);
+    ADD_TYPE_FN(MPInt, ">>=", mpIntAssnRShift);
+
+    ADD_TYPE_FN(MPInt, "**", mpIntPow);
+    ADD_TYPE_FN(MPInt, "//", mpIntRoot);
+    ADD_TYPE_FN(MPInt, "++x", mpIntPreInc);
+    ADD_TYPE_FN(MPInt, "x++", mpIntPostInc);
+    ADD_TYPE_FN(MPInt, "--x", mpIntPreDec);
+    ADD_TYPE_FN(MPInt, "x--", mpIntPostDec);
+
+    ADD_TYPE_FN(MPInt, "u-", mpIntUSub);
+
+    ADD_TYPE_FN(MPInt, "<", mpIntLT);
+    ADD_TYPE_FN(MPInt, ">", mpIntGT);
+    ADD_TYPE_FN(MPInt, "<=", mpIntLE);
+    ADD_TYPE_FN(MPInt, ">=", mpIntGE);
+    ADD_TYPE_FN(MPInt, "==", mpIntEQ);
+    ADD_TYPE_FN(MPInt, "!=", mpIntNE);
+
+    ADD_TYPE_FN(MPInt, "&", mpIntBAnd);
+    ADD_TYPE_FN(MPInt, "|", mpIntBOr);
+    ADD_TYPE_FN(MPInt, "^", mpIntBXOr);
+    ADD_TYPE_FN(MPInt, "~", mpIntBNot);
+
+    ADD_TYPE_FN(MPInt, "&=", mpIntAssnBAnd);
+    ADD_TYPE_FN(MPInt, "|=", mpIntAssnBOr);
+    ADD_TYPE_FN(MPInt, "^=", mpIntAssnBXOr);
+
+    ADD_TYPE_FN(MPInt, "popcnt", mpIntPopCnt);
+
+    ADD_TYPE_FN(MPInt, "addmul", mpIntAddMul);
+    ADD_TYPE_FN(MPInt, "submul", mpIntSubMul);
+    ADD_TYPE_FN(MPInt, "sqr", mpIntSqr);
+
+    ADD_TYPE_FN(MPInt, "powm", mpIntPowm);
+    ADD_TYPE_FN(MPInt, "powmInto", mpIntPowmInto);
+    ADD_TYPE_FN(MPInt, "powmSec", mpIntPowmSec);
+    ADD_TYPE_FN(MPInt, "powmSecInto", mpIntPowmSecInto);
+    ADD_TYPE_FN(MPInt, "invert", mpIntInvert);
+    ADD_TYPE_FN(MPInt, "invertInto", mpIntInvertInto);
+    ADD_TYPE_FN(MPInt, "gcd", mpIntGcd);
+    ADD_TYPE_FN(MPInt, "gcdInto", mpIntGcdInto);
+    ADD_TYPE_FN(MPInt, "gcdext", mpIntGcdExt);
+    ADD_TYPE_FN(MPInt, "gcdextInto", mpIntGcdExtInto);
+    ADD_TYPE_FN(MPInt, "lcm", mpIntLcm);
+    ADD_TYPE_FN(MPInt, "lcmInto", mpIntLcmInto);
+    ADD_TYPE_FN(MPInt, "nextPrime", mpIntNextPrime);
+    ADD_TYPE_FN(MPInt, "nextPrimeInto", mpIntNextPrimeInto);
+    ADD_TYPE_FN(MPInt, "sqrtrem", mpIntSqrtRem);
+    ADD_TYPE_FN(MPInt, "sqrtremInto", mpIntSqrtRemInto);
+    ADD_TYPE_FN(MPInt, "divexact", mpIntDivExact);
+    ADD_TYPE_FN(MPInt, "divexactInto", mpIntDivExactInto);
+    ADD_TYPE_FN(MPInt, "isProbablePrime", mpIntIsProbablePrime);
+    ADD_TYPE_FN(MPInt, "jacobi", mpIntJacobi);
+
+    ADD_TYPE_FN(MPInt, "int", mpIntToInt);
+    ADD_TYPE_FN(MPInt, "str", mpIntToStr);
+    ADD_TYPE_FN(MPInt, "hex", mpIntToHex);
+    ADD_TYPE_FN(MPInt, "toBytes", mpToBytes);
+
+    ADD_TYPE_FN(MPInt, "powAsync", mpIntPowAsync);
+    ADD_TYPE_FN(MPInt, "mulAsync", mpIntMulAsync);
+    ADD_TYPE_FN(MPInt, "rootAsync", mpIntRootAsync);
+    ADD_TYPE_FN(MPInt, "strAsync", mpIntToStrAsync);
+
+    ADD_TYPE_FN(MPIntIterator, "next", getMPIntIteratorNext);
+    ADD_TYPE_FN(MPIntIterator, "inPlace", mpIntIteratorInPlace);
 
     // MPFloat functions
 
-    vm.addTypeFn<VarMPFlt>(loc, "_copy_", mpFltCopy);
-    vm.addTypeFn<VarMPFlt>(loc, "+", mpFltAdd);
-    vm.addTypeFn<VarMPFlt>(loc, "-", mpFltSub);
-    vm.addTypeFn<VarMPFlt>(loc, "*", mpFltMul);
-    vm.addTypeFn<VarMPFlt>(loc, "/", mpFltDiv);
-
-    vm.addTypeFn<VarMPFlt>(loc, "+=", mpFltAssnAdd);
-    vm.addTypeFn<VarMPFlt>(loc, "-=", mpFltAssnSub);
-    vm.addTypeFn<VarMPFlt>(loc, "*=", mpFltAssnMul);
-    vm.addTypeFn<VarMPFlt>(loc, "/=", mpFltAssnDiv);
+    ADD_TYPE_FN(MPFlt, "_copy_", mpFltCopy);
+    ADD_TYPE_FN(MPFlt, "+", mpFltAdd);
+    ADD_TYPE_FN(MPFlt, "-", mpFltSub);
+    ADD_TYPE_FN(MPFlt, "*", mpFltMul);
+    ADD_TYPE_FN(MPFlt, "/", mpFltDiv);
 
-    vm.addTypeFn<VarMPFlt>(loc, "++x", mpFltPreInc);
-    vm.addTypeFn<VarMPFlt>(loc, "x++", mpFltPostInc);
-    vm.addTypeFn<VarMPFlt>(loc, "--x", mpFltPreDec);
-    vm.addTypeFn<VarMPFlt>(loc, "x--", mpFltPostDec);
+    ADD_TYPE_FN(MPFlt, "+=", mpFltAssnAdd);
+    ADD_TYPE_FN(MPFlt, "-=", mpFltAssnSub);
+    ADD_TYPE_FN(MPFlt, "*=", mpFltAssnMul);
+    ADD_TYPE_FN(MPFlt, "/=", mpFltAssnDiv);
 
-    vm.addTypeFn<VarMPFlt>(loc, "u-", mpFltUSub);
+    ADD_TYPE_FN(MPFlt, "++x", mpFltPreInc);
+    ADD_TYPE_FN(MPFlt, "x++", mpFltPostInc);
+    ADD_TYPE_FN(MPFlt, "--x", mpFltPreDec);
+    ADD_TYPE_FN(MPFlt, "x--", mpFltPostDec);
 
-    vm.addTypeFn<VarMPFlt>(loc, "round", mpFltRound);
+    ADD_TYPE_FN(MPFlt, "u-", mpFltUSub);
 
-    vm.addTypeFn<VarMPFlt>(loc, "**", mpFltPow);
-    vm.addTypeFn<VarMPFlt>(loc, "//", mpFltRoot);
+    ADD_TYPE_FN(MPFlt, "round", mpFltRound);
 
-    vm.addTypeFn<VarMPFlt>(loc, "<", mpFltLT);
-    vm.addTypeFn<VarMPFlt>(loc, ">", mpFltGT);
-    vm.addTypeFn<VarMPFlt>(loc, "<=", mpFltLE);
-    vm.addTypeFn<VarMPFlt>(loc, ">=", mpFltGE);
-    vm.addTypeFn<VarMPFlt>(loc, "==", mpFltEQ);
-    vm.addTypeFn<VarMPFlt>(loc, "!=", mpFltNE);
+    ADD_TYPE_FN(MPFlt, "**", mpFltPow);
+    ADD_TYPE_FN(MPFlt, "//", mpFltRoot);
 
-    vm.addTypeFn<VarMPFlt>(loc, "flt", mpFltToFlt);
-    vm.addTypeFn<VarMPFlt>(loc, "str", mpFltToStr);
+    ADD_TYPE_FN(MPFlt, "addmul", mpFltAddMul);
+    ADD_TYPE_FN(MPFlt, "submul", mpFltSubMul);
+    ADD_TYPE_FN(MPFlt, "fma", mpFltFMA);
+    ADD_TYPE_FN(MPFlt, "fms", mpFltFMS);
+    ADD_TYPE_FN(MPFlt, "sqr", mpFltSqr);
 
-    // MPComplex functions
-
-    vm.addTypeFn<VarMPComplex>(loc, "_copy_", mpComplexCopy);
-    vm.addTypeFn<VarMPComplex>(loc, "+", mpComplexAdd);
-    vm.addTypeFn<VarMPComplex>(loc, "-", mpComplexSub);
-    vm.addTypeFn<VarMPComplex>(loc, "*", mpComplexMul);
-    vm.addTypeFn<VarMPComplex>(loc, "/", mpComplexDiv);
+    ADD_TYPE_FN(MPFlt, "<", mpFltLT);
+    ADD_TYPE_FN(MPFlt, ">", mpFltGT);
+    ADD_TYPE_FN(MPFlt, "<=", mpFltLE);
+    ADD_TYPE_FN(MPFlt, ">=", mpFltGE);
+    ADD_TYPE_FN(MPFlt, "==", mpFltEQ);
+    ADD_TYPE_FN(MPFlt, "!=", mpFltNE);
 
-    vm.addTypeFn<VarMPComplex>(loc, "+=", mpComplexAssnAdd);
-    vm.addTypeFn<VarMPComplex>(loc, "-=", mpComplexAssnSub);
-    vm.addTypeFn<VarMPComplex>(loc, "*=", mpComplexAssnMul);
-    vm.addTypeFn<VarMPComplex>(loc, "/=", mpComplexAssnDiv);
+    ADD_TYPE_FN(MPFlt, "getPrecision", mpFltGetPrec);
+    ADD_TYPE_FN(MPFlt, "withPrecision", mpFltWithPrec);
 
-    vm.addTypeFn<VarMPComplex>(loc, "==", mpComplexEQ);
-    vm.addTypeFn<VarMPComplex>(loc, "!=", mpComplexNE);
-    vm.addTypeFn<VarMPComplex>(loc, "<", mpComplexLT);
-    vm.addTypeFn<VarMPComplex>(loc, "<=", mpComplexLE);
-    vm.addTypeFn<VarMPComplex>(loc, ">", mpComplexGT);
-    vm.addTypeFn<VarMPComplex>(loc, ">=", mpComplexGE);
+    ADD_TYPE_FN(MPFlt, "flt", mpFltToFlt);
+    ADD_TYPE_FN(MPFlt, "str", mpFltToStr);
+    ADD_TYPE_FN(MPFlt, "toBytes", mpToBytes);
 
-    vm.addTypeFn<VarMPComplex>(loc, "++x", mpComplexPreInc);
-    vm.addTypeFn<VarMPComplex>(loc, "x++", mpComplexPostInc);
-    vm.addTypeFn<VarMPComplex>(loc, "--x", mpComplexPreDec);
-    vm.addTypeFn<VarMPComplex>(loc, "x--", mpComplexPostDec);
+    ADD_TYPE_FN(MPFlt, "powAsync", mpFltPowAsync);
+    ADD_TYPE_FN(MPFlt, "mulAsync", mpFltMulAsync);
+    ADD_TYPE_FN(MPFlt, "rootAsync", mpFltRootAsync);
+    ADD_TYPE_FN(MPFlt, "strAsync", mpFltToStrAsync);
 
-    vm.addTypeFn<VarMPComplex>(loc, "u-", mpComplexUSub);
-
-    vm.addTypeFn<VarMPComplex>(loc, "**", mpComplexPow);
+    // MPComplex functions
 
-    vm.addTypeFn<VarMPComplex>(loc, "abs", mpComplexAbs);
-    vm.addTypeFn<VarMPComplex>(loc, "set", mpComplexSet);
+    ADD_TYPE_FN(MPComplex, "_copy_", mpComplexCopy);
+    ADD_TYPE_FN(MPComplex, "+", mpComplexAdd);
+    ADD_TYPE_FN(MPComplex, "-", mpComplexSub);
+    ADD_TYPE_FN(MPComplex, "*", mpComplexMul);
+    ADD_TYPE_FN(MPComplex, "/", mpComplexDiv);
+
+    ADD_TYPE_FN(MPComplex, "+=", mpComplexAssnAdd);
+    ADD_TYPE_FN(MPComplex, "-=", mpComplexAssnSub);
+    ADD_TYPE_FN(MPComplex, "*=", mpComplexAssnMul);
+    ADD_TYPE_FN(MPComplex, "/=", mpComplexAssnDiv);
+
+    ADD_TYPE_FN(MPComplex, "==", mpComplexEQ);
+    ADD_TYPE_FN(MPComplex, "!=", mpComplexNE);
+    ADD_TYPE_FN(MPComplex, "<", mpComplexLT);
+    ADD_TYPE_FN(MPComplex, "<=", mpComplexLE);
+    ADD_TYPE_FN(MPComplex, ">", mpComplexGT);
+    ADD_TYPE_FN(MPComplex, ">=", mpComplexGE);
+
+    ADD_TYPE_FN(MPComplex, "++x", mpComplexPreInc);
+    ADD_TYPE_FN(MPComplex, "x++", mpComplexPostInc);
+    ADD_TYPE_FN(MPComplex, "--x", mpComplexPreDec);
+    ADD_TYPE_FN(MPComplex, "x--", mpComplexPostDec);
+
+    ADD_TYPE_FN(MPComplex, "u-", mpComplexUSub);
+
+    ADD_TYPE_FN(MPComplex, "**", mpComplexPow);
+
+    ADD_TYPE_FN(MPComplex, "fma", mpComplexFMA);
+    ADD_TYPE_FN(MPComplex, "sqr", mpComplexSqr);
+
+    ADD_TYPE_FN(MPComplex, "abs", mpComplexAbs);
+    ADD_TYPE_FN(MPComplex, "set", mpComplexSet);
+    ADD_TYPE_FN(MPComplex, "getPrecision", mpComplexGetPrec);
+    ADD_TYPE_FN(MPComplex, "withPrecision", mpComplexWithPrec);
+    ADD_TYPE_FN(MPComplex, "toBytes", mpToBytes);
+
+    // MPIntArray functions
+
+    ADD_TYPE_FN(MPIntArray, "_copy_", mpIntArrayCopy);
+    ADD_TYPE_FN(MPIntArray, "+", mpIntArrayAdd);
+    ADD_TYPE_FN(MPIntArray, "-", mpIntArraySub);
+    ADD_TYPE_FN(MPIntArray, "*", mpIntArrayMul);
+    ADD_TYPE_FN(MPIntArray, "%", mpIntArrayMod);
+    ADD_TYPE_FN(MPIntArray, "&", mpIntArrayBAnd);
+    ADD_TYPE_FN(MPIntArray, "|", mpIntArrayBOr);
+    ADD_TYPE_FN(MPIntArray, "^", mpIntArrayBXOr);
+
+    ADD_TYPE_FN(MPIntArray, "len", mpIntArrayLen);
+    ADD_TYPE_FN(MPIntArray, "[]", mpIntArrayAt);
+    ADD_TYPE_FN(MPIntArray, "at", mpIntArrayAt);
+    ADD_TYPE_FN(MPIntArray, "set", mpIntArraySet);
+    ADD_TYPE_FN(MPIntArray, "push", mpIntArrayPush);
+
+    ADD_TYPE_FN(MPIntArray, "sum", mpIntArraySum);
+    ADD_TYPE_FN(MPIntArray, "product", mpIntArrayProduct);
+    ADD_TYPE_FN(MPIntArray, "min", mpIntArrayMin);
+    ADD_TYPE_FN(MPIntArray, "max", mpIntArrayMax);
+    ADD_TYPE_FN(MPIntArray, "sort", mpIntArraySort);
+
+    ADD_TYPE_FN(MPIntArray, "str", mpIntArrayToStr);
+    ADD_TYPE_FN(MPIntArray, "toBytes", mpToBytes);
+
+    // MPFltArray functions
+
+    ADD_TYPE_FN(MPFltArray, "_copy_", mpFltArrayCopy);
+    ADD_TYPE_FN(MPFltArray, "+", mpFltArrayAdd);
+    ADD_TYPE_FN(MPFltArray, "-", mpFltArraySub);
+    ADD_TYPE_FN(MPFltArray, "*", mpFltArrayMul);
+    ADD_TYPE_FN(MPFltArray, "/", mpFltArrayDiv);
+    ADD_TYPE_FN(MPFltArray, "u-", mpFltArrayNeg);
+
+    ADD_TYPE_FN(MPFltArray, "len", mpFltArrayLen);
+    ADD_TYPE_FN(MPFltArray, "[]", mpFltArrayAt);
+    ADD_TYPE_FN(MPFltArray, "at", mpFltArrayAt);
+    ADD_TYPE_FN(MPFltArray, "set", mpFltArraySet);
+    ADD_TYPE_FN(MPFltArray, "push", mpFltArrayPush);
+
+    ADD_TYPE_FN(MPFltArray, "sum", mpFltArraySum);
+    ADD_TYPE_FN(MPFltArray, "dot", mpFltArrayDot);
+    ADD_TYPE_FN(MPFltArray, "sqrt", mpFltArraySqrt);
+    ADD_TYPE_FN(MPFltArray, "exp", mpFltArrayExp);
+    ADD_TYPE_FN(MPFltArray, "log", mpFltArrayLog);
+    ADD_TYPE_FN(MPFltArray, "abs", mpFltArrayAbs);
+
+    ADD_TYPE_FN(MPFltArray, "getPrecision", mpFltArrayGetPrec);
+    ADD_TYPE_FN(MPFltArray, "str", mpFltArrayToStr);
+    ADD_TYPE_FN(MPFltArray, "toBytes", mpToBytes);
+
+    // RandState functions
+
+    ADD_TYPE_FN(RandState, "_copy_", randStateCopy);
+    ADD_TYPE_FN(RandState, "clone", randStateCopy);
+    ADD_TYPE_FN(RandState, "seed", randStateSeed);
+    ADD_TYPE_FN(RandState, "split", randStateSplit);
+
+    // MPExpr functions
+
+    ADD_TYPE_FN(MPExpr, "+", mpExprAdd);
+    ADD_TYPE_FN(MPExpr, "-", mpExprSub);
+    ADD_TYPE_FN(MPExpr, "*", mpExprMul);
+    ADD_TYPE_FN(MPExpr, "/", mpExprDiv);
+    ADD_TYPE_FN(MPExpr, "u-", mpExprUSub);
+
+    ADD_TYPE_FN(MPExpr, "<", mpExprLT);
+    ADD_TYPE_FN(MPExpr, ">", mpExprGT);
+    ADD_TYPE_FN(MPExpr, "<=", mpExprLE);
+    ADD_TYPE_FN(MPExpr, ">=", mpExprGE);
+    ADD_TYPE_FN(MPExpr, "==", mpExprEQ);
+    ADD_TYPE_FN(MPExpr, "!=", mpExprNE);
+
+    ADD_TYPE_FN(MPExpr, "eval", mpExprEval);
+    ADD_TYPE_FN(MPExpr, "into", mpExprInto);
+    ADD_TYPE_FN(MPExpr, "str", mpExprToStr);
+    ADD_TYPE_FN(MPExpr, "int", mpExprToInt);
+    ADD_TYPE_FN(MPExpr, "flt", mpExprToFlt);
+
+    // MPWriter / MPReader functions
+
+    ADD_TYPE_FN(MPWriter, "write", mpWriterWrite);
+    ADD_TYPE_FN(MPWriter, "close", mpWriterClose);
+    ADD_TYPE_FN(MPReader, "read", mpReaderRead);
+    ADD_TYPE_FN(MPReader, "close", mpReaderClose);
+
+    // MPIntStore / MPIntStoreWriter functions
+
+    ADD_TYPE_FN(MPIntStore, "len", mpIntStoreLen);
+    ADD_TYPE_FN(MPIntStore, "[]", mpIntStoreAt);
+    ADD_TYPE_FN(MPIntStore, "at", mpIntStoreAt);
+    ADD_TYPE_FN(MPIntStoreWriter, "push", mpIntStoreWriterPush);
+    ADD_TYPE_FN(MPIntStoreWriter, "close", mpIntStoreWriterClose);
+
+    // MPModContext functions
+    ADD_TYPE_FN(MPModContext, "to", mpModContextToResidue);
+    ADD_TYPE_FN(MPModContext, "from", mpModContextFromResidue);
+    ADD_TYPE_FN(MPModContext, "add", mpModContextAdd);
+    ADD_TYPE_FN(MPModContext, "sub", mpModContextSub);
+    ADD_TYPE_FN(MPModContext, "mul", mpModContextMul);
+    ADD_TYPE_FN(MPModContext, "sqr", mpModContextSqr);
+    ADD_TYPE_FN(MPModContext, "pow", mpModContextPow);
+    ADD_TYPE_FN(MPModContext, "mod", mpModContextGetMod);
+    ADD_TYPE_FN(MPModContext, "isMontgomery", mpModContextIsMontgomery);
+
+    // MPFuture functions
+    ADD_TYPE_FN(MPFuture, "ready", mpFutureReady);
+    ADD_TYPE_FN(MPFuture, "wait", mpFutureWait);
+    ADD_TYPE_FN(MPFuture, "cancel", mpFutureCancel);
 
     return true;
 }
 
-DEINIT_DLL(MP) { gmp_randclear(rngstate); }
+#undef ADD_TYPE_FN
+#undef ADD_LOCAL
+
+DEINIT_DLL(MP)
+{
+    // Everything that holds on to GMP allocations is released first (the workers free theirs at
+    // thread exit), so that the arena can be uninstalled.
+    workerPool.stop();
+    pool.clear();
+    defaultRandState.clear();
+    if(arena.isInstalled()) {
+        mpfr_free_cache();
+        arena.uninstall();
+    }
+}
 
 } // namespace fer
\ No newline at end of file